@@ -0,0 +1,115 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <skiboot.h>
+#include <cpu.h>
+#include <lock.h>
+#include <timebase.h>
+#include <opal-internal.h>
+#include <boot-phase.h>
+
+/*
+ * Records live in the skiboot image rather than the heap so that the
+ * phases before mem_region_init() get recorded too, and so that the
+ * exported area stays valid after boot. They're in the BSS, the header
+ * is filled in by the first boot_phase_begin().
+ */
+static struct {
+	struct boot_phase_header	hdr;
+	struct boot_phase_record	rec[BOOT_PHASE_MAX_RECORDS];
+} boot_phases;
+
+static struct lock boot_phase_lock = LOCK_UNLOCKED;
+static uint32_t boot_phase_nr;
+static uint32_t boot_phase_dropped;
+static bool boot_phase_over;
+
+/* Current top level phase of the boot CPU, see boot_phase() */
+static int boot_phase_current = -1;
+
+int boot_phase_begin(const char *name, u16 flags)
+{
+	struct cpu_thread *cpu = this_cpu();
+	struct boot_phase_record *r;
+	uint64_t now = mftb();
+	int handle;
+
+	/* Only a flag test once booted, jobs keep calling us */
+	if (boot_phase_over)
+		return -1;
+
+	lock(&boot_phase_lock);
+	if (!boot_phases.hdr.magic) {
+		boot_phases.hdr.magic = cpu_to_be32(BOOT_PHASE_MAGIC);
+		boot_phases.hdr.version = cpu_to_be16(BOOT_PHASE_VERSION);
+		boot_phases.hdr.record_size =
+			cpu_to_be16(sizeof(struct boot_phase_record));
+		boot_phases.hdr.max_records =
+			cpu_to_be32(BOOT_PHASE_MAX_RECORDS);
+	}
+	if (boot_phase_nr >= BOOT_PHASE_MAX_RECORDS) {
+		boot_phases.hdr.dropped = cpu_to_be32(++boot_phase_dropped);
+		unlock(&boot_phase_lock);
+		return -1;
+	}
+	handle = boot_phase_nr++;
+	boot_phases.hdr.nr_records = cpu_to_be32(boot_phase_nr);
+	unlock(&boot_phase_lock);
+
+	/* The record is ours from now on, no need for the lock */
+	r = &boot_phases.rec[handle];
+	r->start_tb = cpu_to_be64(now);
+	r->pir = cpu_to_be32(cpu->pir);
+	r->depth = cpu_to_be16(cpu->boot_phase_depth++);
+	r->flags = cpu_to_be16(flags);
+	strncpy(r->name, name ? name : "?", BOOT_PHASE_NAME_LEN - 1);
+
+	return handle;
+}
+
+void boot_phase_end(int handle)
+{
+	if (handle < 0)
+		return;
+
+	boot_phases.rec[handle].end_tb = cpu_to_be64(mftb());
+	this_cpu()->boot_phase_depth--;
+}
+
+void boot_phase(const char *name)
+{
+	boot_phase_end(boot_phase_current);
+	boot_phase_current = boot_phase_begin(name, 0);
+}
+
+void boot_phase_done(void)
+{
+	boot_phase_end(boot_phase_current);
+	boot_phase_current = -1;
+
+	lock(&boot_phase_lock);
+	boot_phase_over = true;
+	unlock(&boot_phase_lock);
+
+	prlog(PR_DEBUG, "BOOT: %u phases and jobs recorded, %u dropped\n",
+	      boot_phase_nr, boot_phase_dropped);
+}
+
+void boot_phase_init(void)
+{
+	boot_phases.hdr.tb_hz = cpu_to_be64(tb_hz);
+	opal_add_export("boot_phases", &boot_phases, sizeof(boot_phases));
+}
@@ -0,0 +1,244 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define pr_fmt(fmt)	"ARENA: " fmt
+
+#include <skiboot.h>
+#include <lock.h>
+#include <mem_region.h>
+#include <chip-arena.h>
+#include <ccan/list/list.h>
+
+struct chip_table {
+	struct list_node	link;
+	const char		*name;
+	uint64_t		addr;
+	uint64_t		size;
+	int			mem_chip_id;
+};
+
+struct chip_arena {
+	struct list_node	link;
+	uint32_t		chip_id;
+
+	/* Chunk the small tables are currently packed in */
+	void			*chunk;
+	uint64_t		cur;
+	uint64_t		end;
+
+	uint64_t		used;		/* By the tables */
+	uint64_t		reserved;	/* By the chunks */
+	struct list_head	tables;
+};
+
+static LIST_HEAD(chip_arenas);
+static struct lock chip_arena_lock = LOCK_UNLOCKED;
+static bool chip_arena_finished;
+
+static uint64_t chip_arena_page(size_t size)
+{
+	if (size <= CHIP_ARENA_PAGE_64K)
+		return CHIP_ARENA_PAGE_64K;
+	if (size <= CHIP_ARENA_PAGE_2M)
+		return CHIP_ARENA_PAGE_2M;
+	return CHIP_ARENA_PAGE_1G;
+}
+
+/* First address from @cur where the table doesn't cross a @page */
+static uint64_t chip_arena_place(uint64_t cur, size_t size, size_t align,
+				 uint64_t page)
+{
+	uint64_t p = ALIGN_UP(cur, align);
+
+	if ((p & ~(page - 1)) != ((p + size - 1) & ~(page - 1)))
+		p = ALIGN_UP(p, page);
+	return p;
+}
+
+static struct chip_arena *chip_arena_get(uint32_t chip_id)
+{
+	struct chip_arena *a;
+
+	list_for_each(&chip_arenas, a, link) {
+		if (a->chip_id == chip_id)
+			return a;
+	}
+
+	a = zalloc(sizeof(*a));
+	if (!a)
+		return NULL;
+	a->chip_id = chip_id;
+	list_head_init(&a->tables);
+	list_add_tail(&chip_arenas, &a->link);
+
+	return a;
+}
+
+/* Give the end of the current chunk back to the chip's memory */
+static void chip_arena_trim(struct chip_arena *a)
+{
+	if (!a->chunk)
+		return;
+
+	local_shrink(a->chunk, a->cur - (uint64_t)a->chunk);
+	a->reserved -= a->end - a->cur;
+	a->chunk = NULL;
+}
+
+static void *chip_arena_pack(struct chip_arena *a, size_t size, size_t align,
+			     uint64_t page, const char *location)
+{
+	uint64_t addr = 0;
+	void *chunk;
+
+	if (a->chunk)
+		addr = chip_arena_place(a->cur, size, align, page);
+
+	if (!a->chunk || addr + size > a->end) {
+		chip_arena_trim(a);
+
+		/* 2M aligned, so that the pages of the tables line up */
+		chunk = __local_alloc(a->chip_id, CHIP_ARENA_CHUNK_SIZE,
+				      CHIP_ARENA_PAGE_2M, location);
+		if (!chunk)
+			return NULL;
+
+		a->chunk = chunk;
+		a->cur = (uint64_t)chunk;
+		a->end = a->cur + CHIP_ARENA_CHUNK_SIZE;
+		a->reserved += CHIP_ARENA_CHUNK_SIZE;
+		addr = chip_arena_place(a->cur, size, align, page);
+	}
+	a->cur = addr + size;
+
+	return (void *)addr;
+}
+
+void *__chip_arena_alloc(uint32_t chip_id, const char *name, size_t size,
+			 size_t align, const char *location)
+{
+	struct chip_table *t;
+	struct chip_arena *a;
+	uint64_t page;
+	size_t al;
+	void *p = NULL;
+
+	if (align < sizeof(long))
+		align = sizeof(long);
+	assert(!(align & (align - 1)));
+
+	if (!size || size > CHIP_ARENA_PAGE_1G)
+		return NULL;
+	page = chip_arena_page(size);
+
+	t = zalloc(sizeof(*t));
+	if (!t)
+		return NULL;
+
+	lock(&chip_arena_lock);
+	a = chip_arena_get(chip_id);
+	if (!a)
+		goto out;
+
+	if (page == CHIP_ARENA_PAGE_1G || align > CHIP_ARENA_PAGE_2M ||
+	    chip_arena_finished) {
+		/*
+		 * Big tables, and those allocated once the chunks were
+		 * trimmed, get memory of their own, naturally aligned so
+		 * that they don't cross a page.
+		 */
+		for (al = align; al < size; al <<= 1)
+			;
+		p = __local_alloc(chip_id, size, al, location);
+		if (p)
+			a->reserved += size;
+	} else {
+		p = chip_arena_pack(a, size, align, page, location);
+	}
+	if (!p)
+		goto out;
+
+	t->name = name;
+	t->addr = (uint64_t)p;
+	t->size = size;
+	t->mem_chip_id = mem_chip_id(p);
+	list_add_tail(&a->tables, &t->link);
+	a->used += size;
+out:
+	unlock(&chip_arena_lock);
+
+	if (!p) {
+		prerror("Failed to allocate %s (0x%zx) for chip %d\n",
+			name, size, chip_id);
+		free(t);
+		return NULL;
+	}
+
+	/* local_alloc() falls back to any memory when the chip has none */
+	if (t->mem_chip_id != (int)chip_id)
+		prlog(PR_WARNING, "%s of chip %d is in memory of chip %d\n",
+		      name, chip_id, t->mem_chip_id);
+
+	return p;
+}
+
+static void chip_arena_report(struct chip_arena *a)
+{
+	struct chip_table *t, *u;
+	unsigned int count, remote;
+	uint64_t size;
+
+	prlog(PR_INFO, "Chip %d: %lluKB of tables in %lluKB\n",
+	      a->chip_id, (unsigned long long)a->used >> 10,
+	      (unsigned long long)a->reserved >> 10);
+
+	/* One line per kind of table, in allocation order */
+	list_for_each(&a->tables, t, link) {
+		count = remote = 0;
+		size = 0;
+		list_for_each(&a->tables, u, link) {
+			if (!streq(u->name, t->name))
+				continue;
+			if (u != t && !count)
+				break;
+			count++;
+			size += u->size;
+			if (u->mem_chip_id != (int)a->chip_id)
+				remote++;
+		}
+		if (!count)
+			continue;
+
+		prlog(PR_INFO, "  %-16s %4u %8lluKB from 0x%016llx%s\n",
+		      t->name, count, (unsigned long long)size >> 10,
+		      (unsigned long long)t->addr,
+		      remote ? " (REMOTE)" : "");
+	}
+}
+
+void chip_arena_finish(void)
+{
+	struct chip_arena *a;
+
+	lock(&chip_arena_lock);
+	chip_arena_finished = true;
+	list_for_each(&chip_arenas, a, link)
+		chip_arena_trim(a);
+	unlock(&chip_arena_lock);
+
+	list_for_each(&chip_arenas, a, link)
+		chip_arena_report(a);
+}
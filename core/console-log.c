@@ -28,6 +28,47 @@
 #include "timebase.h"
 #include <debug_descriptor.h>
 
+/*
+ * Format the "[%5lu.%09lu,%d] " message prefix by hand, as it is the
+ * same for every message and doesn't need the generic formatter.
+ * The buffer must be able to hold at least 36 characters.
+ */
+static int format_prefix(char *buf, unsigned long tb, int log_level)
+{
+	unsigned long secs = tb_to_secs(tb);
+	unsigned long nsecs = tb_remaining_nsecs(tb);
+	char digits[20];
+	int i, n = 0, len = 0;
+
+	buf[len++] = '[';
+
+	do {
+		digits[n++] = '0' + secs % 10;
+		secs /= 10;
+	} while (secs);
+	for (i = n; i < 5; i++)
+		buf[len++] = ' ';
+	while (n)
+		buf[len++] = digits[--n];
+
+	buf[len++] = '.';
+	for (i = 8; i >= 0; i--) {
+		buf[len + i] = '0' + nsecs % 10;
+		nsecs /= 10;
+	}
+	len += 9;
+
+	buf[len++] = ',';
+	if (log_level >= 10)
+		buf[len++] = '0' + log_level / 10;
+	buf[len++] = '0' + log_level % 10;
+	buf[len++] = ']';
+	buf[len++] = ' ';
+	buf[len] = '\0';
+
+	return len;
+}
+
 static int vprlog(int log_level, const char *fmt, va_list ap)
 {
 	int count;
@@ -45,8 +86,7 @@ static int vprlog(int log_level, const char *fmt, va_list ap)
 	if (log_level > (debug_descriptor.console_log_levels >> 4))
 		return 0;
 
-	count = snprintf(buffer, sizeof(buffer), "[%5lu.%09lu,%d] ",
-			 tb_to_secs(tb), tb_remaining_nsecs(tb), log_level);
+	count = format_prefix(buffer, tb, log_level);
 	count+= vsnprintf(buffer+count, sizeof(buffer)-count, fmt, ap);
 
 	if (log_level > (debug_descriptor.console_log_levels & 0x0f))
@@ -29,6 +29,7 @@
 #include <chip.h>
 #include <timebase.h>
 #include <interrupts.h>
+#include <boot-phase.h>
 #include <ccan/str/str.h>
 #include <ccan/container_of/container_of.h>
 #include <xscom.h>
@@ -290,20 +291,28 @@ bool cpu_poll_job(struct cpu_job *job)
 
 void cpu_wait_job(struct cpu_job *job, bool free_it)
 {
-	unsigned long time_waited = 0;
+	unsigned long start = mftb(), time_waited = 0, next_report = 30000;
 
 	if (!job)
 		return;
 
 	while (!job->complete) {
-		/* This will call OPAL pollers for us */
-		time_wait_ms(10);
-		time_waited += 10;
+		/*
+		 * This will call OPAL pollers for us. Most jobs are
+		 * short, so poll finely for the first millisecond before
+		 * backing off to 10ms at a time.
+		 */
+		if (time_waited < 1)
+			time_wait_us(10);
+		else
+			time_wait_ms(10);
+		time_waited = tb_to_msecs(mftb() - start);
 		lwsync();
-		if ((time_waited % 30000) == 0) {
+		if (time_waited >= next_report) {
 			prlog(PR_INFO, "cpu_wait_job(%s) for %lums\n",
 			      job->name, time_waited);
 			backtrace();
+			next_report += 30000;
 		}
 	}
 	lwsync();
@@ -335,6 +344,7 @@ void cpu_process_jobs(void)
 	lock(&cpu->job_lock);
 	while (true) {
 		bool no_return;
+		int phase;
 
 		job = list_pop(&cpu->job_queue, struct cpu_job, link);
 		if (!job)
@@ -345,9 +355,11 @@ void cpu_process_jobs(void)
 		no_return = job->no_return;
 		unlock(&cpu->job_lock);
 		prlog(PR_TRACE, "running job %s on %x\n", job->name, cpu->pir);
+		phase = boot_phase_begin(job->name, BOOT_PHASE_JOB);
 		if (no_return)
 			free(job);
 		func(data);
+		boot_phase_end(phase);
 		if (!list_empty(&cpu->locks_held)) {
 			prlog(PR_ERR, "OPAL job %s returning with locks held\n",
 			      job->name);
@@ -1180,6 +1192,7 @@ void init_all_cpus(void)
 #endif
 		t->core_hmi_state = 0;
 		t->core_hmi_state_ptr = &t->core_hmi_state;
+		t->core_hmi_release = 0;
 
 		/* Add associativity properties */
 		add_core_associativity(t);
@@ -1368,12 +1381,22 @@ static void cpu_change_hid0(void *__req)
 	set_hid0(new_hid0);
 }
 
+/* Wait for and free jobs queued by PIR, and the array holding them */
+static void cpu_wait_all_jobs(struct cpu_job **jobs)
+{
+	struct cpu_thread *cpu;
+
+	for_each_available_cpu(cpu)
+		cpu_wait_job(jobs[cpu->pir], true);
+	free(jobs);
+}
+
 static int64_t cpu_change_all_hid0(struct hid0_change_req *req)
 {
 	struct cpu_thread *cpu;
 	struct cpu_job **jobs;
 
-	jobs = zalloc(sizeof(struct cpu_job *) * cpu_max_pir + 1);
+	jobs = zalloc(sizeof(struct cpu_job *) * (cpu_max_pir + 1));
 	assert(jobs);
 
 	for_each_available_cpu(cpu) {
@@ -1388,12 +1411,7 @@ static int64_t cpu_change_all_hid0(struct hid0_change_req *req)
 	/* this cpu */
 	cpu_change_hid0(req);
 
-	for_each_available_cpu(cpu) {
-		if (jobs[cpu->pir])
-			cpu_wait_job(jobs[cpu->pir], true);
-	}
-
-	free(jobs);
+	cpu_wait_all_jobs(jobs);
 
 	return OPAL_SUCCESS;
 }
@@ -1419,12 +1437,16 @@ static void cpu_cleanup_one(void *param __unused)
 	mtspr(SPR_PCR, 0);
 }
 
-static int64_t cpu_cleanup_all(void)
+/*
+ * Queue the cleanup on all the other CPUs and return the jobs, to wait
+ * for with cpu_wait_all_jobs() once the caller has done its own work.
+ */
+static struct cpu_job **cpu_start_cleanup_all(void)
 {
 	struct cpu_thread *cpu;
 	struct cpu_job **jobs;
 
-	jobs = zalloc(sizeof(struct cpu_job *) * cpu_max_pir + 1);
+	jobs = zalloc(sizeof(struct cpu_job *) * (cpu_max_pir + 1));
 	assert(jobs);
 
 	for_each_available_cpu(cpu) {
@@ -1437,15 +1459,7 @@ static int64_t cpu_cleanup_all(void)
 	/* this cpu */
 	cpu_cleanup_one(NULL);
 
-	for_each_available_cpu(cpu) {
-		if (jobs[cpu->pir])
-			cpu_wait_job(jobs[cpu->pir], true);
-	}
-
-	free(jobs);
-
-
-	return OPAL_SUCCESS;
+	return jobs;
 }
 
 void cpu_fast_reboot_complete(void)
@@ -1461,6 +1475,7 @@ static int64_t opal_reinit_cpus(uint64_t flags)
 {
 	struct hid0_change_req req = { 0, 0 };
 	struct cpu_thread *cpu;
+	struct cpu_job **cleanup_jobs;
 	int64_t rc = OPAL_SUCCESS;
 	int i;
 
@@ -1471,6 +1486,9 @@ static int64_t opal_reinit_cpus(uint64_t flags)
 	else if (flags & OPAL_REINIT_CPUS_HILE_BE)
 		prlog(PR_NOTICE, "OPAL: Switch to big-endian OS\n");
 
+	/* A new OS, or a kexec: what the previous one reported is stale */
+	mem_clean_ranges_reset();
+
  again:
 	lock(&reinit_lock);
 
@@ -1508,8 +1526,11 @@ static int64_t opal_reinit_cpus(uint64_t flags)
 	 * that can cause problems in cases such as radix->hash
 	 * transitions. Ideally Linux should do it but doing it
 	 * here works around existing broken kernels.
+	 *
+	 * The other CPUs do it while we clean up the TLB below, the
+	 * HID0 changes are queued behind it on their CPUs.
 	 */
-	cpu_cleanup_all();
+	cleanup_jobs = cpu_start_cleanup_all();
 
 	/* If HILE change via HID0 is supported ... */
 	if (hile_supported &&
@@ -1559,6 +1580,9 @@ static int64_t opal_reinit_cpus(uint64_t flags)
 	if (req.set_bits || req.clr_bits)
 		cpu_change_all_hid0(&req);
 
+	/* SLW reinit below winkles the other CPUs, they must be done */
+	cpu_wait_all_jobs(cleanup_jobs);
+
 	/* If we have a P7, error out for LE switch, do nothing for BE */
 	if (proc_gen < proc_gen_p8) {
 		if (flags & OPAL_REINIT_CPUS_HILE_LE)
@@ -906,6 +906,92 @@ int dt_expand_node(struct dt_node *node, const void *fdt, int fdt_node)
 	return nextoffset;
 }
 
+/* Returns the offset following the subtree starting at "offset" */
+static int fdt_skip_subtree(const void *fdt, int offset)
+{
+	int depth = 0, nextoffset;
+	uint32_t tag;
+
+	do {
+		tag = fdt_next_tag(fdt, offset, &nextoffset);
+		if (tag == FDT_BEGIN_NODE)
+			depth++;
+		else if (tag == FDT_END_NODE)
+			depth--;
+		else if (tag == FDT_END)
+			return -1;
+		offset = nextoffset;
+	} while (depth);
+
+	return nextoffset;
+}
+
+/*
+ * Like dt_expand_node(), but only expands the direct children of
+ * "fdt_node" for which filter() returns true. The properties of
+ * "fdt_node" are always copied. The skipped subtrees are never
+ * unflattened, which is much cheaper than expanding them and freeing
+ * them afterwards.
+ */
+int dt_expand_node_filtered(struct dt_node *node, const void *fdt,
+			    int fdt_node,
+			    bool (*filter)(const void *fdt, int offset,
+					   void *data),
+			    void *data)
+{
+	const struct fdt_property *prop;
+	int offset, nextoffset, err;
+	struct dt_node *child;
+	const char *name;
+	uint32_t tag;
+
+	if (((err = fdt_check_header(fdt)) != 0)
+	    || ((err = _fdt_check_node_offset(fdt, fdt_node)) < 0)) {
+		prerror("FDT: Error %d parsing node 0x%x\n", err, fdt_node);
+		return -1;
+	}
+
+	nextoffset = err;
+	do {
+		offset = nextoffset;
+
+		tag = fdt_next_tag(fdt, offset, &nextoffset);
+		switch (tag) {
+		case FDT_PROP:
+			prop = _fdt_offset_ptr(fdt, offset);
+			name = fdt_string(fdt, fdt32_to_cpu(prop->nameoff));
+			dt_add_property(node, name, prop->data,
+					fdt32_to_cpu(prop->len));
+			break;
+		case FDT_BEGIN_NODE:
+			if (!filter(fdt, offset, data)) {
+				nextoffset = fdt_skip_subtree(fdt, offset);
+				if (nextoffset < 0)
+					return -1;
+				break;
+			}
+
+			name = fdt_get_name(fdt, offset, NULL);
+			child = dt_new_root(name);
+			assert(child);
+			nextoffset = dt_expand_node(child, fdt, offset);
+			if (nextoffset < 0) {
+				dt_free(child);
+				return -1;
+			}
+
+			if (!dt_attach_root(node, child))
+				prlog(PR_ERR, "DT: Found duplicate node: %s\n",
+				      child->name);
+			break;
+		case FDT_END:
+			return -1;
+		}
+	} while (tag != FDT_END_NODE);
+
+	return nextoffset;
+}
+
 void dt_expand(const void *fdt)
 {
 	prlog(PR_DEBUG, "FDT: Parsing fdt @%p\n", fdt);
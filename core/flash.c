@@ -28,6 +28,7 @@
 #include <libstb/secureboot.h>
 #include <libstb/trustedboot.h>
 #include <elf.h>
+#include <timebase.h>
 
 struct flash {
 	struct list_node	list;
@@ -610,9 +611,14 @@ static size_t sizeof_elf_from_hdr(void *buf)
  * For trusted boot, the whole partition containing the subpart is measured.
  *
  * Additionally, the logic to work out how much to read from flash is insane.
+ *
+ * This only reads the partition: *len is what has to be verified and
+ * measured, by flash_verify_resource(), and content/content_len the
+ * subpartition to move in place afterwards.
  */
 static int flash_load_resource(enum resource_id id, uint32_t subid,
-			       void *buf, size_t *len)
+			       void *buf, size_t *len, void **content,
+			       size_t *content_len)
 {
 	int i;
 	int rc = OPAL_RESOURCE;
@@ -819,19 +825,8 @@ static int flash_load_resource(enum resource_id id, uint32_t subid,
 	}
 
 done_reading:
-	/*
-	 * Verify and measure the retrieved PNOR partition as part of the
-	 * secure boot and trusted boot requirements
-	 */
-	secureboot_verify(id, buf, *len);
-	trustedboot_measure(id, buf, *len);
-
-	/* Find subpartition */
-	if (subid != RESOURCE_SUBID_NONE) {
-		memmove(buf, bufp, content_size);
-		*len = content_size;
-	}
-
+	*content = bufp;
+	*content_len = content_size;
 	status = true;
 
 out_free_ffs:
@@ -848,13 +843,32 @@ struct flash_load_resource_item {
 	int result;
 	void *buf;
 	size_t *len;
+	void *content;
+	size_t content_len;
+	uint64_t read_tb;
 	struct list_node link;
 };
 
+/*
+ * Loading is a two stage pipeline: flash_load_resources() reads the
+ * resources from flash one after the other, and hands them over to
+ * flash_verify_resources() which verifies and measures them in the same
+ * order, on another CPU, while the next one is being read.
+ *
+ * The verify job exits as soon as its queue is empty, it must not wait
+ * for the load job: both may be queued on the same CPU. The boot CPU
+ * starts a new one when there is something to verify, as it queues
+ * resources and polls for them. Only the boot CPU touches the jobs.
+ */
 static LIST_HEAD(flash_load_resource_queue);
+static LIST_HEAD(flash_verify_resource_queue);
 static LIST_HEAD(flash_loaded_resources);
 static struct lock flash_load_resource_lock = LOCK_UNLOCKED;
 static struct cpu_job *flash_load_job = NULL;
+static struct cpu_job *flash_verify_job = NULL;
+static bool flash_verify_running;
+
+static void start_flash_verify_job(void);
 
 int flash_resource_loaded(enum resource_id id, uint32_t subid)
 {
@@ -881,14 +895,24 @@ int flash_resource_loaded(enum resource_id id, uint32_t subid)
 		flash_load_job = NULL;
 	}
 
+	if (!flash_verify_running && flash_verify_job) {
+		cpu_wait_job(flash_verify_job, true);
+		flash_verify_job = NULL;
+	}
+
 	unlock(&flash_load_resource_lock);
 
+	/* Resources read since we last looked */
+	if (rc == OPAL_BUSY)
+		start_flash_verify_job();
+
 	return rc;
 }
 
 static void flash_load_resources(void *data __unused)
 {
 	struct flash_load_resource_item *r;
+	uint64_t start;
 	int result;
 
 	lock(&flash_load_resource_lock);
@@ -904,17 +928,98 @@ static void flash_load_resources(void *data __unused)
 		r->result = OPAL_BUSY;
 		unlock(&flash_load_resource_lock);
 
-		result = flash_load_resource(r->id, r->subid, r->buf, r->len);
+		start = mftb();
+		result = flash_load_resource(r->id, r->subid, r->buf, r->len,
+					     &r->content, &r->content_len);
+		r->read_tb = mftb() - start;
 
 		lock(&flash_load_resource_lock);
 		r = list_pop(&flash_load_resource_queue,
 			     struct flash_load_resource_item, link);
-		r->result = result;
-		list_add_tail(&flash_loaded_resources, &r->link);
+		if (result == OPAL_SUCCESS) {
+			/* Still busy until verified */
+			list_add_tail(&flash_verify_resource_queue, &r->link);
+		} else {
+			r->result = result;
+			list_add_tail(&flash_loaded_resources, &r->link);
+		}
 	} while(true);
 	unlock(&flash_load_resource_lock);
 }
 
+/*
+ * Verify and measure the retrieved PNOR partition as part of the
+ * secure boot and trusted boot requirements, then move the
+ * subpartition, if any, in place for the caller.
+ */
+static void flash_verify_resource(struct flash_load_resource_item *r)
+{
+	uint64_t start = mftb();
+
+	secureboot_verify(r->id, r->buf, *r->len);
+	trustedboot_measure(r->id, r->buf, *r->len);
+
+	prlog(PR_INFO, "FLASH: %s: read %zu KB in %lu ms, verified and "
+	      "measured in %lu ms\n", flash_map_resource_name(r->id),
+	      *r->len >> 10, tb_to_msecs(r->read_tb),
+	      tb_to_msecs(mftb() - start));
+
+	if (r->subid != RESOURCE_SUBID_NONE) {
+		memmove(r->buf, r->content, r->content_len);
+		*r->len = r->content_len;
+	}
+}
+
+static void flash_verify_resources(void *data __unused)
+{
+	struct flash_load_resource_item *r;
+
+	lock(&flash_load_resource_lock);
+	while (true) {
+		if (list_empty(&flash_verify_resource_queue)) {
+			flash_verify_running = false;
+			break;
+		}
+
+		/* Leave it queued while we work on it, as above */
+		r = list_top(&flash_verify_resource_queue,
+			     struct flash_load_resource_item, link);
+		unlock(&flash_load_resource_lock);
+
+		flash_verify_resource(r);
+
+		lock(&flash_load_resource_lock);
+		list_del(&r->link);
+		r->result = OPAL_SUCCESS;
+		list_add_tail(&flash_loaded_resources, &r->link);
+	}
+	unlock(&flash_load_resource_lock);
+}
+
+static void start_flash_verify_job(void)
+{
+	bool start;
+
+	lock(&flash_load_resource_lock);
+	start = !flash_verify_running &&
+		!list_empty(&flash_verify_resource_queue);
+	if (start)
+		flash_verify_running = true;
+	unlock(&flash_load_resource_lock);
+
+	if (!start)
+		return;
+
+	/* The previous one is done with its queue, it's only returning */
+	if (flash_verify_job)
+		cpu_wait_job(flash_verify_job, true);
+
+	flash_verify_job = cpu_queue_job(NULL, "flash_verify_resources",
+					 flash_verify_resources, NULL);
+
+	cpu_process_local_jobs();
+}
+
 static void start_flash_load_resource_job(void)
 {
 	if (flash_load_job)
@@ -924,6 +1029,9 @@ static void start_flash_load_resource_job(void)
 				       flash_load_resources, NULL);
 
 	cpu_process_local_jobs();
+
+	/* What the previous load job read, or this one if synchronous */
+	start_flash_verify_job();
 }
 
 int flash_start_preload_resource(enum resource_id id, uint32_t subid,
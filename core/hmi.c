@@ -32,6 +32,7 @@
 #include <npu.h>
 #include <capp.h>
 #include <nvram.h>
+#include <timebase.h>
 
 /*
  * HMER register layout:
@@ -283,6 +284,36 @@ static const struct nx_xstop_bit_info nx_pbi_xstop_bits[] = {
 };
 
 static struct lock hmi_lock = LOCK_UNLOCKED;
+
+/*
+ * Malfunction alerts are raised on every thread, but the alert register
+ * is per chip and gets cleared by the first reader. The first thread of
+ * a chip to get there decodes it, under hmi_decode_lock (decoders of
+ * different chips may look at the same failing unit), while the other
+ * threads of the chip go straight back to the OS.
+ */
+static struct lock hmi_decode_lock = LOCK_UNLOCKED;
+static uint32_t malf_decoding[MAX_CHIPS];
+
+/*
+ * HMI statistics, exported to the OS as "hmi_stats" for debugging.
+ * All fields are u64: the number of HMIs handled, of malfunction alert
+ * decodes, and of decodes left to another thread of the chip, then the
+ * total and maximum handling time in timebase ticks, and a histogram of
+ * the handling times: bucket n counts the HMIs that took less than 2^n
+ * microseconds and at least half that, the last one takes the rest.
+ */
+#define HMI_LATENCY_BUCKETS	24
+
+static struct hmi_stats {
+	uint64_t	count;
+	uint64_t	malf_decoded;
+	uint64_t	malf_skipped;
+	uint64_t	total_tb;
+	uint64_t	max_tb;
+	uint64_t	latency[HMI_LATENCY_BUCKETS];
+} hmi_stats;
+static struct lock hmi_stats_lock = LOCK_UNLOCKED;
 static uint32_t malf_alert_scom;
 static uint32_t nx_status_reg;
 static uint32_t nx_dma_engine_fir;
@@ -471,6 +502,7 @@ static void find_capp_checkstop_reason(int flat_chip_id,
 	uint64_t capp_fir_mask;
 	uint64_t capp_fir_action0;
 	uint64_t capp_fir_action1;
+	uint64_t regs[4], vals[4];
 	uint64_t reg;
 	int64_t rc;
 
@@ -481,17 +513,19 @@ static void find_capp_checkstop_reason(int flat_chip_id,
 		if (rc == OPAL_PARAMETER)
 			continue;
 
-		if (xscom_read(flat_chip_id, info.capp_fir_reg, &capp_fir) ||
-		    xscom_read(flat_chip_id, info.capp_fir_mask_reg,
-			       &capp_fir_mask) ||
-		    xscom_read(flat_chip_id, info.capp_fir_action0_reg,
-			       &capp_fir_action0) ||
-		    xscom_read(flat_chip_id, info.capp_fir_action1_reg,
-			       &capp_fir_action1)) {
+		regs[0] = info.capp_fir_reg;
+		regs[1] = info.capp_fir_mask_reg;
+		regs[2] = info.capp_fir_action0_reg;
+		regs[3] = info.capp_fir_action1_reg;
+		if (xscom_read_list(flat_chip_id, regs, vals, 4)) {
 			prerror("CAPP: Couldn't read CAPP#%d (PHB:#%x) FIR registers by XSCOM!\n",
 				info.capp_index, info.phb_index);
 			continue;
 		}
+		capp_fir = vals[0];
+		capp_fir_mask = vals[1];
+		capp_fir_action0 = vals[2];
+		capp_fir_action1 = vals[3];
 
 		if (!(capp_fir & ~capp_fir_mask))
 			continue;
@@ -529,6 +563,7 @@ static void find_nx_checkstop_reason(int flat_chip_id,
 	uint64_t nx_status;
 	uint64_t nx_dma_fir;
 	uint64_t nx_pbi_fir_val;
+	uint64_t regs[2], vals[2];
 	int i;
 
 	/* Get NX status register value. */
@@ -547,17 +582,15 @@ static void find_nx_checkstop_reason(int flat_chip_id,
 	hmi_evt->u.xstop_error.xstop_type = CHECKSTOP_TYPE_NX;
 	hmi_evt->u.xstop_error.u.chip_id = flat_chip_id;
 
-	/* Get DMA & Engine FIR data register value. */
-	if (xscom_read(flat_chip_id, nx_dma_engine_fir, &nx_dma_fir) != 0) {
-		prerror("XSCOM error reading NX_DMA_ENGINE_FIR\n");
-		return;
-	}
-
-	/* Get PowerBus Interface FIR data register value. */
-	if (xscom_read(flat_chip_id, nx_pbi_fir, &nx_pbi_fir_val) != 0) {
-		prerror("XSCOM error reading NX_PBI_FIR\n");
+	/* Get DMA & Engine and PowerBus Interface FIR data register values. */
+	regs[0] = nx_dma_engine_fir;
+	regs[1] = nx_pbi_fir;
+	if (xscom_read_list(flat_chip_id, regs, vals, 2) != 0) {
+		prerror("XSCOM error reading NX_DMA_ENGINE_FIR/NX_PBI_FIR\n");
 		return;
 	}
+	nx_dma_fir = vals[0];
+	nx_pbi_fir_val = vals[1];
 
 	/* Find NX checkstop reason and populate HMI event with error info. */
 	for (i = 0; i < ARRAY_SIZE(nx_dma_xstop_bits); i++)
@@ -628,14 +661,13 @@ static void dump_scoms(int flat_chip_id, const char *unit, uint32_t *scoms,
 	uint64_t value;
 	int r;
 
-	while (*scoms != 0) {
+	for (; *scoms != 0; scoms++) {
 		value = 0;
 		r = _xscom_read(flat_chip_id, *scoms, &value, false);
 		if (r != OPAL_SUCCESS)
 			continue;
 		prlog(PR_ERR, "%s: [Loc: %s] P:%d 0x%08x=0x%016llx\n",
 		      unit, loc, flat_chip_id, *scoms, value);
-		scoms++;
 	}
 }
 
@@ -660,6 +692,7 @@ static void find_npu2_checkstop_reason(int flat_chip_id,
 	uint64_t npu2_fir_mask_addr;
 	uint64_t npu2_fir_action0_addr;
 	uint64_t npu2_fir_action1_addr;
+	uint64_t regs[4], vals[4];
 	uint64_t fatal_errors;
 	int total_errors = 0;
 	const char *loc;
@@ -685,13 +718,18 @@ static void find_npu2_checkstop_reason(int flat_chip_id,
 
 	for (i = 0; i < NPU2_TOTAL_FIR_REGISTERS; i++) {
 		/* Read all the registers necessary to find a checkstop condition. */
-		if (xscom_read(flat_chip_id, npu2_fir_addr, &npu2_fir) ||
-			xscom_read(flat_chip_id, npu2_fir_mask_addr, &npu2_fir_mask) ||
-			xscom_read(flat_chip_id, npu2_fir_action0_addr, &npu2_fir_action0) ||
-			xscom_read(flat_chip_id, npu2_fir_action1_addr, &npu2_fir_action1)) {
+		regs[0] = npu2_fir_addr;
+		regs[1] = npu2_fir_mask_addr;
+		regs[2] = npu2_fir_action0_addr;
+		regs[3] = npu2_fir_action1_addr;
+		if (xscom_read_list(flat_chip_id, regs, vals, 4)) {
 			prerror("HMI: Couldn't read NPU FIR register%d with XSCOM\n", i);
 			continue;
 		}
+		npu2_fir = vals[0];
+		npu2_fir_mask = vals[1];
+		npu2_fir_action0 = vals[2];
+		npu2_fir_action1 = vals[3];
 
 		fatal_errors = npu2_fir & ~npu2_fir_mask & npu2_fir_action0 & npu2_fir_action1;
 
@@ -755,6 +793,7 @@ static void find_npu_checkstop_reason(int flat_chip_id,
 	uint64_t npu_fir_mask;
 	uint64_t npu_fir_action0;
 	uint64_t npu_fir_action1;
+	uint64_t regs[4], vals[4];
 	uint64_t fatal_errors;
 
 	/* Only check for NPU errors if the chip has a NPU */
@@ -776,17 +815,18 @@ static void find_npu_checkstop_reason(int flat_chip_id,
 		return;
 
 	/* Read all the registers necessary to find a checkstop condition. */
-	if (xscom_read(flat_chip_id,
-		       p->at_xscom + NX_FIR, &npu_fir) ||
-	    xscom_read(flat_chip_id,
-		       p->at_xscom + NX_FIR_MASK, &npu_fir_mask) ||
-	    xscom_read(flat_chip_id,
-		       p->at_xscom + NX_FIR_ACTION0, &npu_fir_action0) ||
-	    xscom_read(flat_chip_id,
-		       p->at_xscom + NX_FIR_ACTION1, &npu_fir_action1)) {
+	regs[0] = p->at_xscom + NX_FIR;
+	regs[1] = p->at_xscom + NX_FIR_MASK;
+	regs[2] = p->at_xscom + NX_FIR_ACTION0;
+	regs[3] = p->at_xscom + NX_FIR_ACTION1;
+	if (xscom_read_list(flat_chip_id, regs, vals, 4)) {
 		prerror("Couldn't read NPU registers with XSCOM\n");
 		return;
 	}
+	npu_fir = vals[0];
+	npu_fir_mask = vals[1];
+	npu_fir_action0 = vals[2];
+	npu_fir_action1 = vals[3];
 
 	fatal_errors = npu_fir & ~npu_fir_mask & npu_fir_action0 & npu_fir_action1;
 
@@ -856,15 +896,75 @@ static void decode_malfunction(struct OpalHMIEvent *hmi_evt, uint64_t *out_flags
 	*out_flags |= flags;
 }
 
+static bool malf_alert_pending(uint32_t chip_id)
+{
+	uint64_t malf_alert = 0;
+
+	xscom_read(chip_id, malf_alert_scom, &malf_alert);
+	return malf_alert != 0;
+}
+
+/* How many times a chip's malfunction alert is decoded per HMI */
+#define MALF_DECODE_MAX_PASSES	4
+
+static void hmi_decode_malfunction(struct OpalHMIEvent *hmi_evt,
+				   uint64_t *out_flags)
+{
+	uint32_t chip_id = this_cpu()->chip_id;
+	uint32_t *decoding = &malf_decoding[chip_id];
+	int passes = 0;
+
+	do {
+		if (passes++ == MALF_DECODE_MAX_PASSES) {
+			prerror("HMI: Malfunction alert of chip %d still"
+				" pending after %d decodes, giving up\n",
+				chip_id, MALF_DECODE_MAX_PASSES);
+			return;
+		}
+
+		/* Somebody else on the chip is decoding, leave it to them */
+		if (cmpxchg32(decoding, 0, 1) != 0) {
+			lock(&hmi_stats_lock);
+			hmi_stats.malf_skipped++;
+			unlock(&hmi_stats_lock);
+			return;
+		}
+
+		lock(&hmi_decode_lock);
+		decode_malfunction(hmi_evt, out_flags);
+		unlock(&hmi_decode_lock);
+
+		lock(&hmi_stats_lock);
+		hmi_stats.malf_decoded++;
+		unlock(&hmi_stats_lock);
+
+		lwsync();
+		*decoding = 0;
+		sync();
+
+		/*
+		 * Alerts raised while we were decoding may have been skipped
+		 * by the other threads, check again once we're done.
+		 */
+	} while (malf_alert_pending(chip_id));
+}
+
 /*
  * This will "rendez-vous" all threads on the core to the rendez-vous
  * id "sig". You need to make sure that "sig" is different from the
  * previous rendez vous. The sig value must be between 0 and 7 with
  * boot time being set to 0.
  *
- * Note: in theory, we could just use a flip flop "sig" in the thread
- * structure (binary rendez-vous with no argument). This is a bit more
- * debuggable and better at handling timeouts (arguably).
+ * Each thread posts "sig" in its nibble of the core state. Thread 0 of
+ * the core is the leader: it waits for all the threads to post, then
+ * releases them by publishing "sig" in the core release word. The other
+ * threads only watch that one word, and all the waits are done at low
+ * SMT priority so that the threads still working (typically the leader
+ * doing SCOMs) get the core.
+ *
+ * The release word can't be reused too early: it only moves on to the
+ * next "sig" once every thread has posted that next "sig", ie. after
+ * everybody has left this rendez-vous.
  *
  * This should be called with the no lock held
  */
@@ -874,60 +974,55 @@ static void hmi_rendez_vous(uint32_t sig)
 	uint32_t my_id = cpu_get_thread_index(t);
 	uint32_t my_shift = my_id << 2;
 	uint32_t *sptr = t->core_hmi_state_ptr;
+	uint32_t *rptr = &t->primary->core_hmi_release;
 	uint32_t val, prev, shift, i;
 	uint64_t timeout;
 
 	assert(sig <= 0x7);
 
-	/*
-	 * Mark ourselves as having reached the rendez vous point with
-	 * the exit bit cleared
-	 */
+	/* Mark ourselves as having reached the rendez vous point */
 	do {
 		val = prev = *sptr;
 		val &= ~(0xfu << my_shift);
 		val |= sig << my_shift;
 	} while (cmpxchg32(sptr, prev, val) != prev);
 
-	/*
-	 * Wait for everybody else to reach that point, ignore the
-	 * exit bit as another thread could have already set it.
-	 */
-	for (i = 0; i < cpu_thread_count; i++) {
-		shift = i << 2;
-
+	if (t != t->primary) {
+		/* Follower: wait for the leader to release us */
 		timeout = TIMEOUT_LOOPS;
-		while (((*sptr >> shift) & 0x7) != sig && --timeout)
-			cpu_relax();
+		smt_lowest();
+		while (*rptr != sig && --timeout)
+			barrier();
+		smt_medium();
 		if (!timeout)
-			prlog(PR_ERR, "Rendez-vous stage 1 timeout, CPU 0x%x"
-			      " waiting for thread %d (sptr=%08x)\n",
-						      t->pir, i, *sptr);
+			prlog(PR_ERR, "Rendez-vous release timeout, CPU 0x%x"
+			      " (sptr=%08x)\n", t->pir, *sptr);
+		lwsync();
+		return;
 	}
 
-	/* Set the exit bit */
-	do {
-		val = prev = *sptr;
-		val &= ~(0xfu << my_shift);
-		val |= (sig | 8) << my_shift;
-	} while (cmpxchg32(sptr, prev, val) != prev);
-
-	/* At this point, we need to wait for everybody else to have a value
-	 * that is *not* sig. IE. they either have set the exit bit *or* they
-	 * have changed the rendez-vous (meaning they have moved on to another
-	 * rendez vous point).
-	 */
+	/* Leader: wait for everybody else to reach that point */
+	smt_lowest();
 	for (i = 0; i < cpu_thread_count; i++) {
 		shift = i << 2;
 
 		timeout = TIMEOUT_LOOPS;
-		while (((*sptr >> shift) & 0xf) == sig && --timeout)
-			cpu_relax();
-		if (!timeout)
-			prlog(PR_ERR, "Rendez-vous stage 2 timeout, CPU 0x%x"
+		while (((*sptr >> shift) & 0x7) != sig && --timeout)
+			barrier();
+		if (!timeout) {
+			smt_medium();
+			prlog(PR_ERR, "Rendez-vous timeout, CPU 0x%x"
 			      " waiting for thread %d (sptr=%08x)\n",
-						      t->pir, i, *sptr);
+			      t->pir, i, *sptr);
+			smt_lowest();
+		}
 	}
+	smt_medium();
+
+	/* Release the followers */
+	lwsync();
+	*rptr = sig;
+	sync();
 }
 
 static void hmi_print_debug(const uint8_t *msg, uint64_t hmer)
@@ -1178,12 +1273,32 @@ static int handle_tfac_errors(struct OpalHMIEvent *hmi_evt, uint64_t *out_flags)
 	return recover;
 }
 
+static void hmi_account(unsigned long start)
+{
+	unsigned long tb = mftb() - start;
+	unsigned long us = tb_to_usecs(tb);
+	unsigned int bucket = us ? ilog2(us) + 1 : 0;
+
+	if (bucket >= HMI_LATENCY_BUCKETS)
+		bucket = HMI_LATENCY_BUCKETS - 1;
+
+	lock(&hmi_stats_lock);
+	hmi_stats.count++;
+	hmi_stats.total_tb += tb;
+	if (tb > hmi_stats.max_tb)
+		hmi_stats.max_tb = tb;
+	hmi_stats.latency[bucket]++;
+	unlock(&hmi_stats_lock);
+}
+
 static int handle_hmi_exception(uint64_t hmer, struct OpalHMIEvent *hmi_evt,
 				uint64_t *out_flags)
 {
 	struct cpu_thread *cpu = this_cpu();
+	unsigned long start = mftb();
 	int recover = 1;
 	uint64_t handled = 0;
+	bool malfunction = false;
 
 	prlog(PR_DEBUG, "Received HMI interrupt: HMER = 0x%016llx\n", hmer);
 	/* Initialize the hmi event with old value of HMER */
@@ -1253,8 +1368,7 @@ static int handle_hmi_exception(uint64_t hmer, struct OpalHMIEvent *hmi_evt,
 		handled |= SPR_HMER_MALFUNCTION_ALERT;
 
 		hmi_print_debug("Malfunction Alert", hmer);
-		if (hmi_evt)
-			decode_malfunction(hmi_evt, out_flags);
+		malfunction = true;
 	}
 
 	/* Assert if we see Hypervisor resource error, we can not continue. */
@@ -1292,6 +1406,12 @@ static int handle_hmi_exception(uint64_t hmer, struct OpalHMIEvent *hmi_evt,
 	 */
 	mtspr(SPR_HMER, ~handled);
 	unlock(&hmi_lock);
+
+	/* Decoding takes lots of SCOMs, don't hold up the other HMIs */
+	if (malfunction && hmi_evt)
+		hmi_decode_malfunction(hmi_evt, out_flags);
+
+	hmi_account(start);
 	return recover;
 }
 
@@ -1337,3 +1457,8 @@ static int64_t opal_handle_hmi2(__be64 *out_flags)
 	return OPAL_SUCCESS;
 }
 opal_call(OPAL_HANDLE_HMI2, opal_handle_hmi2, 1);
+
+void hmi_init(void)
+{
+	opal_add_export("hmi_stats", &hmi_stats, sizeof(hmi_stats));
+}
@@ -54,6 +54,9 @@
 #include <sbe-p9.h>
 #include <debug_descriptor.h>
 #include <occ.h>
+#include <boot-phase.h>
+#include <opal-profile.h>
+#include <chip-arena.h>
 
 enum proc_gen proc_gen;
 unsigned int pcie_max_link_speed;
@@ -491,6 +494,7 @@ void __noreturn load_and_boot_kernel(bool is_reboot)
 
 	op_display(OP_LOG, OP_MOD_INIT, 0x000A);
 
+	boot_phase("load_kernel");
 	if (platform.exit)
 		platform.exit();
 
@@ -500,8 +504,10 @@ void __noreturn load_and_boot_kernel(bool is_reboot)
 		abort();
 	}
 
+	boot_phase("load_initramfs");
 	load_initramfs();
 
+	boot_phase("exit_boot_services");
 	trustedboot_exit_boot_services();
 
 	ipmi_set_fw_progress_sensor(IPMI_FW_OS_BOOT);
@@ -510,14 +516,17 @@ void __noreturn load_and_boot_kernel(bool is_reboot)
 		occ_pstates_init();
 
 	if (!is_reboot) {
+		boot_phase("nvram_wait");
 		/* We wait for the nvram read to complete here so we can
 		 * grab stuff from there such as the kernel arguments
 		 */
 		nvram_wait_for_load();
 
+		boot_phase("vpd_wait");
 		/* Wait for FW VPD data read to complete */
 		fsp_code_update_wait_vpd(true);
 
+		boot_phase("occ_sensors_init");
 		/*
 		 * OCC takes few secs to boot.  Call this as late as
 		 * as possible to avoid delay.
@@ -546,12 +555,14 @@ void __noreturn load_and_boot_kernel(bool is_reboot)
 
 	op_display(OP_LOG, OP_MOD_INIT, 0x000B);
 
+	boot_phase("create_dtb");
 	/* Create the device tree blob to boot OS. */
 	fdt = create_dtb(dt_root, false);
 	if (!fdt) {
 		op_display(OP_FATAL, OP_MOD_INIT, 2);
 		abort();
 	}
+	boot_phase_done();
 
 	op_display(OP_LOG, OP_MOD_INIT, 0x000C);
 
@@ -886,6 +897,7 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	/* Now locks can be used */
 	init_locks();
 
+	boot_phase("opal_table_init");
 	/* Create the OPAL call table early on, entries can be overridden
 	 * later on (FSP console code for example)
 	 */
@@ -902,6 +914,7 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	 * is set to -1, we record that and pass it to parse_hdat
 	 */
 
+	boot_phase("device_tree");
 	dt_root = dt_new_root("");
 
 	if (fdt == (void *)-1ul) {
@@ -930,6 +943,7 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	 * We also initialize the FSI master at that point in case we need
 	 * to access chips via that path early on.
 	 */
+	boot_phase("xscom_init");
 	init_chips();
 
 	xscom_init();
@@ -941,6 +955,7 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	 */
 	direct_controls_init();
 
+	boot_phase("dt_init_misc");
 	/*
 	 * Put various bits & pieces in device-tree that might not
 	 * already be there such as the /chosen node if not there yet,
@@ -948,6 +963,7 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	 */
 	dt_init_misc();
 
+	boot_phase("lpc_init");
 	/*
 	 * Initialize LPC (P8 only) so we can get to UART, BMC and
 	 * other system controller. This is done before probe_platform
@@ -956,6 +972,7 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	 */
 	lpc_init();
 
+	boot_phase("mem_region_init");
 	/*
 	 * This should be done before mem_region_init, so the stack
 	 * region length can be set according to the maximum PIR.
@@ -971,9 +988,11 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	 */
 	mem_region_init();
 
+	boot_phase("homer_init");
 	/* Reserve HOMER and OCC area */
 	homer_init();
 
+	boot_phase("init_all_cpus");
 	/* Initialize the rest of the cpu thread structs */
 	init_all_cpus();
 	if (proc_gen == proc_gen_p9)
@@ -982,6 +1001,7 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	/* Add the /opal node to the device-tree */
 	add_opal_node();
 
+	boot_phase("probe_platform");
 	/*
 	 * We probe the platform now. This means the platform probe gets
 	 * the opportunity to reserve additional areas of memory if needed.
@@ -990,6 +1010,7 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	 */
 	probe_platform();
 
+	boot_phase("init_interrupts");
 	/* Allocate our split trace buffers now. Depends add_opal_node() */
 	init_trace_buffers();
 
@@ -1001,9 +1022,11 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	/* On P9, initialize XIVE */
 	init_xive();
 
+	boot_phase("centaur_init");
 	/* Grab centaurs from device-tree if present (only on FSP-less) */
 	centaur_init();
 
+	boot_phase("psi_init");
 	/* Initialize PSI (depends on probe_platform being called) */
 	psi_init();
 
@@ -1013,6 +1036,7 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	 */
 	lpc_init_interrupts();
 
+	boot_phase("cpu_bringup");
 	/* Call in secondary CPUs */
 	cpu_bringup();
 
@@ -1024,6 +1048,7 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	/* We can now do NAP mode */
 	cpu_set_sreset_enable(true);
 
+	boot_phase("chiptod_init");
 	/*
 	 * Synchronize time bases. Prior to chiptod_init() the timebase
 	 * is free-running at a frequency based on the core clock rather
@@ -1033,6 +1058,7 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	 */
 	chiptod_init();
 
+	boot_phase("sbe_i2c_sensors");
 	/*
 	 * SBE uses TB value for scheduling timer. Hence init after
 	 * chiptod init
@@ -1052,6 +1078,13 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	 */
         opal_init_msg();
 
+	/* Export the HMI statistics */
+	hmi_init();
+
+	/* Export the boot phase timings */
+	boot_phase_init();
+
+	boot_phase("platform_init");
 	/*
 	 * We have initialized the basic HW, we can now call into the
 	 * platform to perform subsequent inits, such as establishing
@@ -1060,16 +1093,22 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	if (platform.init)
 		platform.init();
 
+	boot_phase("nvram_init");
 	/* Read in NVRAM and set it up */
 	nvram_init();
 
 	/* Set the console level */
 	console_log_level();
 
+	/* Optional OPAL call profiling, needs NVRAM */
+	opal_profile_init();
+
+	boot_phase("secureboot_init");
 	/* Secure/Trusted Boot init. We look for /ibm,secureboot in DT */
 	secureboot_init();
 	trustedboot_init();
 
+	boot_phase("preload_flash");
 	/*
 	 * BMC platforms load version information from flash after
 	 * secure/trustedboot init.
@@ -1083,11 +1122,13 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	/* Install the OPAL Console handlers */
 	init_opal_console();
 
+	boot_phase("slw_init");
 	/* Init SLW related stuff, including fastsleep */
 	slw_init();
 
 	op_display(OP_LOG, OP_MOD_INIT, 0x0002);
 
+	boot_phase("occ_pstates_init");
 	/*
 	 * On some POWER9 BMC systems, we need to initialise the OCC
 	 * before the NPU to facilitate NVLink/OpenCAPI presence
@@ -1099,21 +1140,25 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	if (!fsp_present())
 		occ_pstates_init();
 
+	boot_phase("start_preloads");
 	pci_nvram_init();
 
 	preload_io_vpd();
 	preload_capp_ucode();
 	start_preload_kernel();
 
+	boot_phase("vas_nx_init");
 	/* Virtual Accelerator Switchboard */
 	vas_init();
 
 	/* NX init */
 	nx_init();
 
+	boot_phase("imc_init");
 	/* Init In-Memory Collection related stuff (load the IMC dtb into memory) */
 	imc_init();
 
+	boot_phase("probe_phbs");
 	/* Probe IO hubs */
 	probe_p7ioc();
 
@@ -1123,15 +1168,18 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	/* Probe PHB4 on P9 */
 	probe_phb4();
 
+	boot_phase("probe_npu");
 	/* Probe NPUs */
 	probe_npu();
 	probe_npu2();
 	/* TODO: Eventually, we'll do NVLink and OpenCAPI together */
 	probe_npu2_opencapi();
 
+	boot_phase("pci_init_slots");
 	/* Initialize PCI */
 	pci_init_slots();
 
+	boot_phase("late_init");
 	/* Add OPAL timer related properties */
 	late_init_timers();
 
@@ -1143,6 +1191,7 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 
 	ipmi_set_fw_progress_sensor(IPMI_FW_PCI_INIT);
 
+	boot_phase("finalize_dt");
 	/*
 	 * These last few things must be done as late as possible
 	 * because they rely on various other things having been setup,
@@ -1159,6 +1208,9 @@ void __noreturn __nomcount main_cpu_entry(const void *fdt)
 	/* Add the list of interrupts going to OPAL */
 	add_opal_interrupts();
 
+	/* Trim the per-chip table arenas before the memory goes away */
+	chip_arena_finish();
+
 	/* Now release parts of memory nodes we haven't used ourselves... */
 	mem_region_release_unused();
 
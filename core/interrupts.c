@@ -33,13 +33,78 @@
 #define ICP_CPPR		0x4	/* 8-bit access */
 #define ICP_MFRR		0xc	/* 8-bit access */
 
+/*
+ * The lists are sorted by start and only used under irq_lock.
+ *
+ * Lookups go through irq_table instead, a sorted array of the same
+ * sources rebuilt on every change and looked up without a lock, see
+ * irq_find_source().
+ */
 static LIST_HEAD(irq_sources);
 static LIST_HEAD(irq_sources2);
+static unsigned int irq_nr_sources, irq_nr_sources2;
 static struct lock irq_lock = LOCK_UNLOCKED;
 
+struct irq_source_table {
+	uint64_t		gen;
+	unsigned int		nr_primary;
+	unsigned int		nr_secondary;
+	/* Primary then secondary sources, each sorted by start */
+	struct irq_source	*sources[];
+};
+
+static struct irq_source_table irq_empty_table;
+static struct irq_source_table *irq_table = &irq_empty_table;
+
+/* Wait for the lookups which may still be using the previous table */
+static void irq_wait_lookups(void)
+{
+	struct cpu_thread *cpu;
+
+	for_each_cpu(cpu) {
+		if (cpu == this_cpu())
+			continue;
+		while (cpu->in_irq_lookup)
+			cpu_relax();
+	}
+}
+
+/* Rebuild the lookup table from the lists, called with irq_lock held */
+static void irq_table_update(void)
+{
+	struct irq_source_table *new, *old = irq_table;
+	struct irq_source *is;
+	unsigned int i = 0;
+
+	new = malloc(sizeof(*new) +
+		     (irq_nr_sources + irq_nr_sources2) * sizeof(is));
+	assert(new);
+	new->gen = old->gen + 1;
+	new->nr_primary = irq_nr_sources;
+	new->nr_secondary = irq_nr_sources2;
+	list_for_each(&irq_sources, is, link)
+		new->sources[i++] = is;
+	list_for_each(&irq_sources2, is, link)
+		new->sources[i++] = is;
+
+	/* Publish the table once it's filled */
+	lwsync();
+	irq_table = new;
+
+	/*
+	 * Pairs with the sync in irq_find_source(): either a lookup sees
+	 * the new table, or we see it's running and wait for it.
+	 */
+	sync();
+	irq_wait_lookups();
+
+	if (old != &irq_empty_table)
+		free(old);
+}
+
 void __register_irq_source(struct irq_source *is, bool secondary)
 {
-	struct irq_source *is1;
+	struct irq_source *is1, *next = NULL;
 	struct list_head *list = secondary ? &irq_sources2 : &irq_sources;
 
 	prlog(PR_DEBUG, "IRQ: Registering %04x..%04x ops @%p (data %p)%s\n",
@@ -55,8 +120,18 @@ void __register_irq_source(struct irq_source *is, bool secondary)
 				is1->start, is1->end - 1);
 			assert(0);
 		}
+		if (!next && is1->start > is->start)
+			next = is1;
 	}
-	list_add_tail(list, &is->link);
+	if (next)
+		list_add_before(list, &is->link, &next->link);
+	else
+		list_add_tail(list, &is->link);
+	if (secondary)
+		irq_nr_sources2++;
+	else
+		irq_nr_sources++;
+	irq_table_update();
 	unlock(&irq_lock);
 }
 
@@ -91,8 +166,13 @@ void unregister_irq_source(uint32_t start, uint32_t count)
 				assert(0);
 			}
 			list_del(&is->link);
+			irq_nr_sources--;
+			irq_table_update();
 			unlock(&irq_lock);
-			/* XXX Add synchronize / RCU */
+			/*
+			 * No new lookup can return it now. XXX Callers of
+			 * irq_find_source() may still be using it though.
+			 */
 			free(is);
 			return;
 		}
@@ -103,31 +183,64 @@ void unregister_irq_source(uint32_t start, uint32_t count)
 	assert(0);
 }
 
-struct irq_source *irq_find_source(uint32_t isn)
+static struct irq_source *irq_table_search(struct irq_source **sources,
+					    unsigned int count, uint32_t isn)
 {
+	unsigned int lo = 0, hi = count, mid;
 	struct irq_source *is;
 
-	lock(&irq_lock);
-	/*
-	 * XXX This really needs some kind of caching !
-	 */
-	list_for_each(&irq_sources, is, link) {
-		if (isn >= is->start && isn < is->end) {
-			unlock(&irq_lock);
-			return is;
-		}
-	}
-	list_for_each(&irq_sources2, is, link) {
-		if (isn >= is->start && isn < is->end) {
-			unlock(&irq_lock);
+	/* Sources of a table don't overlap, so ends are sorted too */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		is = sources[mid];
+		if (isn < is->start)
+			hi = mid;
+		else if (isn >= is->end)
+			lo = mid + 1;
+		else
 			return is;
-		}
 	}
-	unlock(&irq_lock);
 
 	return NULL;
 }
 
+/*
+ * Lockless: the table is only freed once no CPU is in here with it
+ * (see irq_table_update()). Each CPU remembers the last primary source
+ * it found, since an interrupt usually comes with several calls for
+ * the same source (get/set xive, handle, EOI). Secondary sources may
+ * overlap primary ones, so they aren't cached.
+ */
+struct irq_source *irq_find_source(uint32_t isn)
+{
+	struct cpu_thread *cpu = this_cpu();
+	struct irq_source_table *t;
+	struct irq_source *is;
+
+	cpu->in_irq_lookup = true;
+	sync();
+	t = irq_table;
+
+	is = cpu->irq_cache;
+	if (is && cpu->irq_cache_gen == t->gen &&
+	    isn >= is->start && isn < is->end)
+		goto out;
+
+	is = irq_table_search(t->sources, t->nr_primary, isn);
+	if (is) {
+		cpu->irq_cache = is;
+		cpu->irq_cache_gen = t->gen;
+		goto out;
+	}
+
+	is = irq_table_search(t->sources + t->nr_primary, t->nr_secondary, isn);
+out:
+	lwsync();
+	cpu->in_irq_lookup = false;
+
+	return is;
+}
+
 void irq_for_each_source(void (*cb)(struct irq_source *, void *), void *data)
 {
 	struct irq_source *is;
@@ -252,3 +252,17 @@ bool ipmi_present(void)
 {
 	return ipmi_backend != NULL;
 }
+
+size_t ipmi_max_req_size(void)
+{
+	size_t size;
+
+	if (!ipmi_present() || !ipmi_backend->max_req_size)
+		return IPMI_MAX_REQ_SIZE;
+
+	/* req_size is a byte */
+	size = ipmi_backend->max_req_size();
+	if (size < IPMI_MAX_REQ_SIZE)
+		return IPMI_MAX_REQ_SIZE;
+	return MIN(size, (size_t)0xff);
+}
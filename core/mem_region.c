@@ -25,6 +25,7 @@
 #include <types.h>
 #include <mem_region.h>
 #include <mem_region-malloc.h>
+#include <opal.h>
 
 /* Memory poisoning on free (if POISON_MEM_REGION set to 1) */
 #ifdef DEBUG
@@ -50,8 +51,16 @@
  */
 struct lock mem_region_lock = LOCK_UNLOCKED;
 
+/*
+ * Once added, regions don't overlap. The regions list is kept sorted by
+ * address, and region_index holds the same regions in the same order
+ * so that we can binary search it. Empty regions come before a region
+ * starting at the same address.
+ */
 static struct list_head regions = LIST_HEAD_INIT(regions);
 static struct list_head early_reserves = LIST_HEAD_INIT(early_reserves);
+static struct mem_region **region_index;
+static unsigned int region_nr, region_index_size;
 
 static bool mem_region_init_done = false;
 static bool mem_regions_finalised = false;
@@ -711,6 +720,111 @@ static bool intersects(const struct mem_region *region, uint64_t addr)
 		addr < region->start + region->len;
 }
 
+/* Index of the last region starting at or before @addr, -1 if none */
+static int region_index_lookup(uint64_t addr)
+{
+	int lo = 0, hi = (int)region_nr - 1, found = -1;
+
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+
+		if (region_index[mid]->start <= addr) {
+			found = mid;
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return found;
+}
+
+/* Region containing @addr, or NULL */
+static struct mem_region *find_region(uint64_t addr)
+{
+	struct mem_region *r;
+	int i = region_index_lookup(addr);
+
+	/* Empty regions don't contain anything */
+	while (i >= 0 && !region_index[i]->len)
+		i--;
+	if (i < 0)
+		return NULL;
+
+	r = region_index[i];
+	return addr < r->start + r->len ? r : NULL;
+}
+
+static int region_index_of(const struct mem_region *region)
+{
+	int i = region_index_lookup(region->start);
+
+	while (i >= 0 && region_index[i] != region)
+		i--;
+	assert(i >= 0);
+	return i;
+}
+
+static bool region_insert(struct mem_region *region)
+{
+	struct mem_region **index;
+	unsigned int size;
+	int i;
+
+	if (region_nr == region_index_size) {
+		size = region_index_size ? region_index_size * 2 : 64;
+		index = realloc(region_index, size * sizeof(*index));
+		if (!index)
+			return false;
+		region_index = index;
+		region_index_size = size;
+	}
+
+	i = region_index_lookup(region->start) + 1;
+	while (i > 0 && region_index[i - 1]->start == region->start &&
+	       region_index[i - 1]->len > region->len)
+		i--;
+
+	memmove(&region_index[i + 1], &region_index[i],
+		(region_nr - i) * sizeof(*region_index));
+	region_index[i] = region;
+	region_nr++;
+
+	if (i + 1 < (int)region_nr)
+		list_add_before(&regions, &region->list,
+				&region_index[i + 1]->list);
+	else
+		list_add_tail(&regions, &region->list);
+
+	return true;
+}
+
+static void region_remove(struct mem_region *region)
+{
+	int i = region_index_of(region);
+
+	memmove(&region_index[i], &region_index[i + 1],
+		(region_nr - i - 1) * sizeof(*region_index));
+	region_nr--;
+	list_del_from(&regions, &region->list);
+}
+
+/* Rebuild the index of a regions list that was built or changed by hand */
+static void region_index_reset(void)
+{
+	struct mem_region *r, *next;
+	struct list_head old;
+
+	region_nr = 0;
+	list_head_init(&old);
+	while ((r = list_pop(&regions, struct mem_region, list)) != NULL)
+		list_add_tail(&old, &r->list);
+	list_for_each_safe(&old, r, next, list) {
+		list_del_from(&old, &r->list);
+		if (!region_insert(r))
+			abort();
+	}
+}
+
 static bool maybe_split(struct mem_region *r, uint64_t split_at)
 {
 	struct mem_region *tail;
@@ -722,8 +836,11 @@ static bool maybe_split(struct mem_region *r, uint64_t split_at)
 	if (!tail)
 		return false;
 
-	/* Tail add is important: we may need to split again! */
-	list_add_tail(&regions, &tail->list);
+	if (!region_insert(tail)) {
+		r->len += tail->len;
+		free(tail);
+		return false;
+	}
 	return true;
 }
 
@@ -741,20 +858,54 @@ static bool contains(const struct mem_region *r1, const struct mem_region *r2)
 	return (r1->start <= r2->start && r2_end <= r1_end);
 }
 
-static struct mem_region *get_overlap(const struct mem_region *region)
+/*
+ * Adjacent reservations of the same name and type, that the firmware
+ * describes in pieces in reserved-names/-ranges, are kept as one region.
+ * Only those without a device tree node, whose "reg" would no longer
+ * match. Reservations made with mem_reserve_*() are never merged: those
+ * of the same name are typically one per chip (HOMER, OCC...).
+ */
+static bool can_coalesce(const struct mem_region *r1,
+			 const struct mem_region *r2)
 {
-	struct mem_region *i;
+	return r1->type == r2->type &&
+		(r1->type == REGION_FW_RESERVED ||
+		 r1->type == REGION_RESERVED) &&
+		!r1->node && !r2->node &&
+		r1->start + r1->len == r2->start &&
+		streq(r1->name, r2->name);
+}
 
-	list_for_each(&regions, i, list) {
-		if (overlaps(region, i))
-			return i;
+static bool coalesce_region(struct mem_region *region)
+{
+	struct mem_region *prev = NULL, *next = NULL;
+	int i = region_index_lookup(region->start);
+
+	if (i >= 0 && region_index[i]->start + region_index[i]->len ==
+	    region->start)
+		prev = region_index[i];
+	i = region_index_lookup(region->start + region->len);
+	if (i >= 0 && region_index[i]->start == region->start + region->len)
+		next = region_index[i];
+
+	if (next && can_coalesce(region, next)) {
+		region_remove(next);
+		region->len += next->len;
+		free(next);
 	}
-	return NULL;
+	if (prev && can_coalesce(prev, region)) {
+		prev->len += region->len;
+		free(region);
+		return true;
+	}
+	return false;
 }
 
-static bool add_region(struct mem_region *region)
+static bool __add_region(struct mem_region *region, bool coalesce)
 {
-	struct mem_region *r;
+	struct mem_region *r = NULL;
+	uint64_t end = region->start + region->len;
+	int i;
 
 	if (mem_regions_finalised) {
 		prerror("MEM: add_region(%s@0x%"PRIx64") called after finalise!\n",
@@ -762,42 +913,69 @@ static bool add_region(struct mem_region *region)
 		return false;
 	}
 
-	/* First split any regions which intersect. */
-	list_for_each(&regions, r, list) {
-		/*
-		 * The new region should be fully contained by an existing one.
-		 * If it's not then we have a problem where reservations
-		 * partially overlap which is probably broken.
-		 *
-		 * NB: There *might* be situations where this is legitimate,
-		 * but the region handling does not currently support this.
-		 */
-		if (overlaps(r, region) && !contains(r, region)) {
+	/*
+	 * The new region should be fully contained by an existing one.
+	 * If it's not then we have a problem where reservations
+	 * partially overlap which is probably broken.
+	 *
+	 * NB: There *might* be situations where this is legitimate,
+	 * but the region handling does not currently support this.
+	 *
+	 * Regions don't overlap, so the candidates are the one holding
+	 * our start and those following it up to our end.
+	 */
+	i = region_index_lookup(region->start);
+	while (i > 0 && region_index[i - 1]->start + region_index[i - 1]->len >
+	       region->start)
+		i--;
+	for (i = i < 0 ? 0 : i; i < (int)region_nr; i++) {
+		struct mem_region *o = region_index[i];
+
+		if (o->start > end || (o->start == end && region->len))
+			break;
+
+		if (overlaps(o, region) && !contains(o, region)) {
 			prerror("MEM: Partial overlap detected between regions:\n");
 			prerror("MEM: %s [0x%"PRIx64"-0x%"PRIx64"] (new)\n",
 				region->name, region->start,
 				region->start + region->len);
 			prerror("MEM: %s [0x%"PRIx64"-0x%"PRIx64"]\n",
-				r->name, r->start, r->start + r->len);
+				o->name, o->start, o->start + o->len);
 			return false;
 		}
 
-		if (!maybe_split(r, region->start) ||
-		    !maybe_split(r, region->start + region->len))
-			return false;
+		/* An empty region still splits the one it's in */
+		if (intersects(o, region->start) || overlaps(o, region))
+			r = o;
 	}
 
-	/* Now we have only whole overlaps, if any. */
-	while ((r = get_overlap(region)) != NULL) {
-		assert(r->start == region->start);
-		assert(r->len == region->len);
-		list_del_from(&regions, &r->list);
-		free(r);
+	/* Split the region we're in, so that we replace a whole one */
+	if (r) {
+		if (!maybe_split(r, region->start))
+			return false;
+		r = find_region(region->start);
+		if (r && !maybe_split(r, end))
+			return false;
+
+		r = find_region(region->start);
+		if (r && region->len) {
+			assert(r->start == region->start);
+			assert(r->len == region->len);
+			region_remove(r);
+			free(r);
+		}
 	}
 
+	if (coalesce && coalesce_region(region))
+		return true;
+
 	/* Finally, add in our own region. */
-	list_add(&regions, &region->list);
-	return true;
+	return region_insert(region);
+}
+
+static bool add_region(struct mem_region *region)
+{
+	return __add_region(region, false);
 }
 
 static void mem_reserve(enum mem_region_type type, const char *name,
@@ -895,6 +1073,49 @@ restart:
 	return p;
 }
 
+static struct mem_region *find_alloc_region(const void *p)
+{
+	struct mem_region *region = find_region((uint64_t)p);
+
+	if (region && (region->type == REGION_SKIBOOT_HEAP ||
+		       region->type == REGION_MEMORY))
+		return region;
+	return NULL;
+}
+
+/* Shrink a local_alloc() allocation, giving the tail back to its region */
+void __local_shrink(void *p, size_t len, const char *location)
+{
+	struct mem_region *region;
+
+	lock(&mem_region_lock);
+	region = find_alloc_region(p);
+	assert(region);
+	lock(&region->free_list_lock);
+	mem_resize(region, p, len, location);
+	unlock(&region->free_list_lock);
+	unlock(&mem_region_lock);
+}
+
+/* Chip whose memory holds @p, or -1 if it isn't chip memory */
+int mem_chip_id(const void *p)
+{
+	const struct dt_property *prop;
+	struct mem_region *region;
+	int chip_id = -1;
+
+	lock(&mem_region_lock);
+	region = find_alloc_region(p);
+	if (region && region->node) {
+		prop = dt_find_property(region->node, "ibm,chip-id");
+		if (prop && prop->len >= sizeof(u32))
+			chip_id = be32_to_cpu(*(const __be32 *)prop->prop);
+	}
+	unlock(&mem_region_lock);
+
+	return chip_id;
+}
+
 struct mem_region *find_mem_region(const char *name)
 {
 	struct mem_region *region;
@@ -910,11 +1131,22 @@ bool mem_range_is_reserved(uint64_t start, uint64_t size)
 {
 	uint64_t end = start + size;
 	struct mem_region *region;
-	struct list_head *search;
 
-	/* We may have the range covered by a number of regions, which could
-	 * appear in any order. So, we look for a region that covers the
-	 * start address, and bump start up to the end of that region.
+	/* The regions don't overlap once added: walk them from @start */
+	if (mem_region_init_done) {
+		while (start < end) {
+			region = find_region(start);
+			if (!region || !region_is_reserved(region))
+				return false;
+			start = region->start + region->len;
+		}
+		return true;
+	}
+
+	/* We may have the range covered by a number of early reserves,
+	 * which could appear in any order. So, we look for a region that
+	 * covers the start address, and bump start up to the end of that
+	 * region.
 	 *
 	 * We repeat until we've either bumped past the end of the range,
 	 * or we didn't find a matching region.
@@ -922,16 +1154,10 @@ bool mem_range_is_reserved(uint64_t start, uint64_t size)
 	 * This has a worst-case of O(n^2), but n is well bounded by the
 	 * small number of reservations.
 	 */
-
-	if (!mem_region_init_done)
-		search = &early_reserves;
-	else
-		search = &regions;
-
 	for (;;) {
 		bool found = false;
 
-		list_for_each(search, region, list) {
+		list_for_each(&early_reserves, region, list) {
 			if (!region_is_reserved(region))
 				continue;
 
@@ -982,7 +1208,7 @@ static void mem_region_parse_reserved_properties(void)
 					dt_get_number(range, 2),
 					dt_get_number(range + 1, 2),
 					NULL, REGION_FW_RESERVED);
-			if (!add_region(region)) {
+			if (!__add_region(region, true)) {
 				prerror("Couldn't add mem_region %s\n", name);
 				abort();
 			}
@@ -1051,6 +1277,10 @@ void mem_region_init(void)
 	extern char _end[];
 	BUILD_ASSERT(HEAP_BASE >= (uint64_t)_end);
 
+	lock(&mem_region_lock);
+	region_index_reset();
+	unlock(&mem_region_lock);
+
 	/*
 	 * Add associativity properties outside of the lock
 	 * to avoid recursive locking caused by allocations
@@ -1083,7 +1313,10 @@ void mem_region_init(void)
 			prerror("MEM: Could not add mem region %s!\n", i->name);
 			abort();
 		}
-		list_add(&regions, &region->list);
+		if (!region_insert(region)) {
+			prerror("MEM: Could not add mem region %s!\n", i->name);
+			abort();
+		}
 		if ((start + len) > top_of_ram)
 			top_of_ram = start + len;
 		unlock(&mem_region_lock);
@@ -1195,7 +1428,11 @@ void mem_region_release_unused(void)
 					r->name);
 				abort();
 			}
-			list_add(&regions, &for_linux->list);
+			if (!region_insert(for_linux)) {
+				prerror("OOM adding mem node %s for linux\n",
+					r->name);
+				abort();
+			}
 		}
 	}
 	unlock(&mem_region_lock);
@@ -1246,6 +1483,131 @@ static void mem_clear_range(uint64_t s, uint64_t e)
 	memset((void *)s, 0, e - s);
 }
 
+/*
+ * Ranges of OS memory that the OS zeroed itself and reported with
+ * OPAL_REPORT_CLEAN_MEMORY, which the next fast reboot doesn't clear
+ * again. Memory it merely never wrote doesn't qualify, a kexec'd OS
+ * can find the previous one's data there. Kept sorted, with touching
+ * ranges merged.
+ *
+ * A report only covers the OS that made it: the table is reset when an
+ * OS (re)initialises the CPUs on entry, which a kexec'd kernel does too,
+ * and after the fast reboot clear.
+ *
+ * The OS is gone by the time the clear jobs read the table, so they
+ * don't take the lock.
+ */
+#define MEM_CLEAN_MAX_RANGES	64
+
+struct mem_clean_range {
+	uint64_t start;
+	uint64_t end;
+};
+
+static struct mem_clean_range mem_clean_ranges[MEM_CLEAN_MAX_RANGES];
+static unsigned int mem_clean_nr;
+static struct lock mem_clean_lock = LOCK_UNLOCKED;
+
+void mem_clean_ranges_reset(void)
+{
+	lock(&mem_clean_lock);
+	mem_clean_nr = 0;
+	unlock(&mem_clean_lock);
+}
+
+static int64_t mem_clean_range_add(uint64_t s, uint64_t e)
+{
+	struct mem_clean_range *c = mem_clean_ranges;
+	unsigned int i, j;
+
+	/* Merge with all the ranges that overlap or touch [s, e) */
+	for (i = 0; i < mem_clean_nr && c[i].end < s; i++)
+		;
+	for (j = i; j < mem_clean_nr && c[j].start <= e; j++) {
+		s = MIN(s, c[j].start);
+		e = MAX(e, c[j].end);
+	}
+
+	if (i == j) {
+		if (mem_clean_nr == MEM_CLEAN_MAX_RANGES)
+			return OPAL_RESOURCE;
+		memmove(&c[i + 1], &c[i], (mem_clean_nr - i) * sizeof(*c));
+		mem_clean_nr++;
+	} else {
+		memmove(&c[i + 1], &c[j], (mem_clean_nr - j) * sizeof(*c));
+		mem_clean_nr -= j - i - 1;
+	}
+	c[i].start = s;
+	c[i].end = e;
+
+	return OPAL_SUCCESS;
+}
+
+static bool mem_range_is_os(uint64_t s, uint64_t e)
+{
+	struct mem_region *r = find_region(s);
+
+	return r && r->type == REGION_OS && e <= r->start + r->len;
+}
+
+static int64_t opal_report_clean_memory(uint64_t addr, uint64_t size)
+{
+	uint64_t end = addr + size;
+	int64_t rc;
+
+	/* Forget what was reported so far */
+	if (!addr && !size) {
+		mem_clean_ranges_reset();
+		return OPAL_SUCCESS;
+	}
+
+	if (!size || end < addr || (addr | size) & 0xfff)
+		return OPAL_PARAMETER;
+
+	lock(&mem_region_lock);
+	rc = mem_range_is_os(addr, end) ? OPAL_SUCCESS : OPAL_PARAMETER;
+	unlock(&mem_region_lock);
+	if (rc)
+		return rc;
+
+	lock(&mem_clean_lock);
+	rc = mem_clean_range_add(addr, end);
+	unlock(&mem_clean_lock);
+
+	return rc;
+}
+opal_call(OPAL_REPORT_CLEAN_MEMORY, opal_report_clean_memory, 2);
+
+/* Clear [s, e) except for the ranges the OS reported as clean */
+static void mem_clear_dirty_range(uint64_t s, uint64_t e)
+{
+	const struct mem_clean_range *c;
+	unsigned int i;
+
+	for (i = 0; i < mem_clean_nr && s < e; i++) {
+		c = &mem_clean_ranges[i];
+		if (c->end <= s)
+			continue;
+		if (c->start >= e)
+			break;
+		if (c->start > s)
+			mem_clear_range(s, c->start);
+		s = c->end;
+	}
+	if (s < e)
+		mem_clear_range(s, e);
+}
+
+static uint64_t mem_clean_bytes(void)
+{
+	uint64_t total = 0;
+	unsigned int i;
+
+	for (i = 0; i < mem_clean_nr; i++)
+		total += mem_clean_ranges[i].end - mem_clean_ranges[i].start;
+	return total;
+}
+
 struct mem_region_clear_job_args {
 	char *job_name;
 	uint64_t s,e;
@@ -1254,7 +1616,7 @@ struct mem_region_clear_job_args {
 static void mem_region_clear_job(void *data)
 {
 	struct mem_region_clear_job_args *arg = (struct mem_region_clear_job_args*)data;
-	mem_clear_range(arg->s, arg->e);
+	mem_clear_dirty_range(arg->s, arg->e);
 }
 
 #define MEM_REGION_CLEAR_JOB_SIZE (16ULL*(1<<30))
@@ -1293,6 +1655,9 @@ void start_mem_region_clear_unused(void)
 	mem_clear_job_args = job_args;
 
 	prlog(PR_NOTICE, "Clearing unused memory:\n");
+	if (mem_clean_nr)
+		prlog(PR_NOTICE, "  skipping %"PRIu64"MB in %u ranges reported clean\n",
+		      mem_clean_bytes() >> 20, mem_clean_nr);
 	i = 0;
 	list_for_each(&regions, r, list) {
 		/* If it's not unused, ignore it. */
@@ -1377,6 +1742,9 @@ void wait_mem_region_clear_unused(void)
 	}
 	free(mem_clear_jobs);
 	free(mem_clear_job_args);
+
+	/* The next OS has to report its own clean ranges */
+	mem_clean_ranges_reset();
 }
 
 static void mem_region_add_dt_reserved_node(struct dt_node *parent,
@@ -0,0 +1,169 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define pr_fmt(fmt)	"OPAL-PROF: " fmt
+
+#include <skiboot.h>
+#include <cpu.h>
+#include <opal.h>
+#include <opal-internal.h>
+#include <opal-profile.h>
+#include <mem_region-malloc.h>
+#include <nvram.h>
+#include <stack.h>
+#include <timebase.h>
+
+bool opal_profile_waits;
+
+static size_t opal_profile_cpu_size(unsigned int nr_samples)
+{
+	size_t size = sizeof(struct opal_profile_cpu) +
+		(OPAL_LAST + 1) * sizeof(struct opal_call_stat) +
+		nr_samples * sizeof(struct opal_profile_sample);
+
+	/* Keep each CPU on its own cache lines */
+	return ALIGN_UP(size, 128);
+}
+
+static struct opal_profile_sample *opal_profile_samples(
+					struct opal_profile_cpu *prof)
+{
+	return (void *)&prof->calls[OPAL_LAST + 1];
+}
+
+/*
+ * Only the outermost call of a CPU is timed, calls the OS makes while
+ * re-entering OPAL (console, reboot...) are part of it.
+ */
+void opal_profile_entry(struct cpu_thread *cpu)
+{
+	if (cpu->in_opal_call == 1)
+		cpu->opal_call_tb = mftb();
+}
+
+void opal_profile_exit(struct cpu_thread *cpu, uint64_t token)
+{
+	struct opal_call_stat *s;
+	uint64_t tb;
+
+	if (cpu->in_opal_call != 1 || !cpu->opal_call_tb || token > OPAL_LAST)
+		return;
+
+	tb = mftb() - cpu->opal_call_tb;
+	cpu->opal_call_tb = 0;
+
+	/* The stats are per CPU, no need for atomics */
+	s = &cpu->opal_profile->calls[token];
+	s->count = cpu_to_be64(be64_to_cpu(s->count) + 1);
+	s->total_tb = cpu_to_be64(be64_to_cpu(s->total_tb) + tb);
+	if (tb > be64_to_cpu(s->max_tb))
+		s->max_tb = cpu_to_be64(tb);
+}
+
+/*
+ * OPAL runs with MSR[EE] clear, and an exception taken while in OPAL
+ * is fatal, so we can't sample the PC from the decrementer. Instead we
+ * sample where OPAL calls wait, which is where their time goes when
+ * polling the hardware, weighted by the duration of the wait.
+ */
+void __opal_profile_wait(unsigned long duration)
+{
+	struct cpu_thread *cpu = this_cpu();
+	struct bt_entry bt[OPAL_PROFILE_BT_DEPTH + 1];
+	struct opal_profile_sample *smp;
+	unsigned int i, count = ARRAY_SIZE(bt);
+	uint32_t n;
+
+	if (!cpu->in_opal_call || !cpu->opal_profile)
+		return;
+
+	n = be32_to_cpu(cpu->opal_profile->sample_count);
+	smp = &opal_profile_samples(cpu->opal_profile)[n % OPAL_PROFILE_SAMPLES];
+
+	/* Skip the time_wait*() frame we were called from */
+	__backtrace(bt, &count);
+	for (i = 0; i < OPAL_PROFILE_BT_DEPTH; i++)
+		smp->pc[i] = cpu_to_be64(i + 1 < count ? bt[i + 1].pc : 0);
+	smp->tb = cpu_to_be64(mftb());
+	smp->wait_tb = cpu_to_be64(duration);
+	smp->token = cpu_to_be64(cpu->current_token);
+
+	lwsync();
+	cpu->opal_profile->sample_count = cpu_to_be32(n + 1);
+}
+
+void opal_profile_init(void)
+{
+	struct opal_profile_header *hdr;
+	struct cpu_thread *cpu;
+	const char *mode;
+	unsigned int nr_cpus = 0, nr_samples = 0;
+	size_t cpu_offset, cpu_size, size;
+	void *area;
+
+	mode = nvram_query("opal-profile");
+	if (!mode)
+		return;
+
+	if (!strcmp(mode, "waits")) {
+		nr_samples = OPAL_PROFILE_SAMPLES;
+	} else if (strcmp(mode, "calls")) {
+		prerror("Unknown profiling mode '%s'\n", mode);
+		return;
+	}
+
+	for_each_cpu(cpu)
+		nr_cpus++;
+
+	cpu_offset = ALIGN_UP(sizeof(*hdr), 128);
+	cpu_size = opal_profile_cpu_size(nr_samples);
+	size = cpu_offset + nr_cpus * cpu_size;
+
+	/* Can be a few MB with samples, keep it out of the heap */
+	area = local_alloc(this_cpu()->chip_id, size, 0x10000);
+	if (!area) {
+		prerror("Failed to allocate %zu bytes\n", size);
+		return;
+	}
+	memset(area, 0, size);
+
+	hdr = area;
+	hdr->magic = cpu_to_be32(OPAL_PROFILE_MAGIC);
+	hdr->version = cpu_to_be16(OPAL_PROFILE_VERSION);
+	hdr->mode = cpu_to_be16(OPAL_PROFILE_CALLS |
+				(nr_samples ? OPAL_PROFILE_WAITS : 0));
+	hdr->nr_cpus = cpu_to_be32(nr_cpus);
+	hdr->nr_tokens = cpu_to_be32(OPAL_LAST + 1);
+	hdr->nr_samples = cpu_to_be32(nr_samples);
+	hdr->cpu_offset = cpu_to_be32(cpu_offset);
+	hdr->cpu_size = cpu_to_be32(cpu_size);
+	hdr->tb_hz = cpu_to_be64(tb_hz);
+	hdr->skiboot_base = cpu_to_be64(SKIBOOT_BASE);
+
+	area += cpu_offset;
+	for_each_cpu(cpu) {
+		struct opal_profile_cpu *prof = area;
+
+		prof->pir = cpu_to_be32(cpu->pir);
+		cpu->opal_profile = prof;
+		area += cpu_size;
+	}
+	opal_profile_waits = nr_samples != 0;
+
+	opal_add_export("opal_call_profile", hdr, size);
+	prlog(PR_NOTICE, "Profiling OPAL %s of %u CPUs\n",
+	      nr_samples ? "calls and waits" : "calls", nr_cpus);
+}
@@ -32,6 +32,7 @@
 #include <elf-abi.h>
 #include <errorlog.h>
 #include <occ.h>
+#include <opal-profile.h>
 
 /* Pending events to signal via opal_poll_events */
 uint64_t opal_pending_events;
@@ -167,6 +168,9 @@ int64_t opal_entry_check(struct stack_frame *eframe)
 		}
 	}
 
+	if (cpu->opal_profile)
+		opal_profile_entry(cpu);
+
 	return OPAL_SUCCESS;
 }
 
@@ -192,6 +196,8 @@ int64_t opal_exit_check(int64_t retval, struct stack_frame *eframe)
 			      token, retval);
 			drop_my_locks(true);
 		}
+		if (cpu->opal_profile)
+			opal_profile_exit(cpu, token);
 	}
 	return retval;
 }
@@ -356,6 +362,24 @@ static void add_opal_firmware_exports_node(struct dt_node *node)
 #endif
 }
 
+/*
+ * opal_add_export: export a firmware memory area to the OS at runtime,
+ * using the same exports node as above. Only call this after
+ * add_opal_node(), from the init processor.
+ */
+void opal_add_export(const char *name, void *base, uint64_t size)
+{
+	struct dt_node *exports;
+
+	exports = dt_find_by_path(opal_node, "firmware/exports");
+	if (!exports) {
+		prerror("OPAL: No exports node for %s\n", name);
+		return;
+	}
+
+	dt_add_property_u64s(exports, name, (uint64_t)base, size);
+}
+
 static void add_opal_firmware_node(void)
 {
 	struct dt_node *firmware = dt_new(opal_node, "firmware");
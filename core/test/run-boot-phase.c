@@ -0,0 +1,142 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define __TEST__
+#include <skiboot.h>
+
+#define mftb()	(stamp++)
+#define sync()
+#define lwsync()
+#define smt_lowest()
+#define smt_medium()
+
+#include <cpu.h>
+
+static uint64_t stamp = 1;
+static struct cpu_thread cpus[2], *cur_cpu = &cpus[0];
+#define this_cpu()	(cur_cpu)
+
+void lock_caller(struct lock *l, const char *caller)
+{
+	(void)l;
+	(void)caller;
+}
+
+void unlock(struct lock *l)
+{
+	(void)l;
+}
+
+unsigned long tb_hz = 512000000;
+
+static void *exported;
+static uint64_t exported_size;
+
+void opal_add_export(const char *name, void *base, uint64_t size)
+{
+	assert(!strcmp(name, "boot_phases"));
+	exported = base;
+	exported_size = size;
+}
+
+#include "../boot-phase.c"
+
+static const struct boot_phase_record *rec(unsigned int i)
+{
+	assert(i < be32_to_cpu(boot_phases.hdr.nr_records));
+	return &boot_phases.rec[i];
+}
+
+static void check(unsigned int i, const char *name, uint32_t pir,
+		  uint16_t depth, uint16_t flags)
+{
+	const struct boot_phase_record *r = rec(i);
+
+	assert(!strcmp(r->name, name));
+	assert(be32_to_cpu(r->pir) == pir);
+	assert(be16_to_cpu(r->depth) == depth);
+	assert(be16_to_cpu(r->flags) == flags);
+	assert(be64_to_cpu(r->end_tb) > be64_to_cpu(r->start_tb));
+}
+
+int main(void)
+{
+	int nested, job;
+	unsigned int i;
+
+	cpus[0].pir = 0;
+	cpus[1].pir = 8;
+
+	boot_phase("first");
+	nested = boot_phase_begin("nested", 0);
+	job = boot_phase_begin("local job", BOOT_PHASE_JOB);
+	boot_phase_end(job);
+	boot_phase_end(nested);
+
+	/* A job on another CPU isn't nested in the boot CPU phases */
+	cur_cpu = &cpus[1];
+	job = boot_phase_begin("remote job", BOOT_PHASE_JOB);
+	boot_phase_end(job);
+	cur_cpu = &cpus[0];
+
+	boot_phase_init();
+	assert(exported == &boot_phases);
+	assert(exported_size == sizeof(struct boot_phase_header) +
+	       BOOT_PHASE_MAX_RECORDS * sizeof(struct boot_phase_record));
+	assert(be32_to_cpu(boot_phases.hdr.magic) == BOOT_PHASE_MAGIC);
+	assert(be16_to_cpu(boot_phases.hdr.version) == BOOT_PHASE_VERSION);
+	assert(be16_to_cpu(boot_phases.hdr.record_size) ==
+	       sizeof(struct boot_phase_record));
+	assert(be32_to_cpu(boot_phases.hdr.max_records) ==
+	       BOOT_PHASE_MAX_RECORDS);
+	assert(be64_to_cpu(boot_phases.hdr.tb_hz) == tb_hz);
+
+	/* Names get truncated */
+	boot_phase("a phase name that is far too long to fit");
+	assert(strlen(rec(4)->name) == BOOT_PHASE_NAME_LEN - 1);
+	boot_phase("last");
+
+	/* Fill the area up, the rest gets counted as dropped */
+	for (i = 0; i < BOOT_PHASE_MAX_RECORDS; i++)
+		boot_phase_end(boot_phase_begin("filler", BOOT_PHASE_JOB));
+	assert(be32_to_cpu(boot_phases.hdr.nr_records) ==
+	       BOOT_PHASE_MAX_RECORDS);
+	assert(be32_to_cpu(boot_phases.hdr.dropped) == 6);
+	assert(cpus[0].boot_phase_depth == 1);
+
+	boot_phase_done();
+	assert(cpus[0].boot_phase_depth == 0);
+	assert(cpus[1].boot_phase_depth == 0);
+
+	check(0, "first", 0, 0, 0);
+	check(1, "nested", 0, 1, 0);
+	check(2, "local job", 0, 2, BOOT_PHASE_JOB);
+	check(3, "remote job", 8, 0, BOOT_PHASE_JOB);
+	check(5, "last", 0, 0, 0);
+	check(6, "filler", 0, 1, BOOT_PHASE_JOB);
+
+	/* Nothing is recorded once booted */
+	assert(boot_phase_begin("late", 0) < 0);
+	assert(be32_to_cpu(boot_phases.hdr.dropped) == 6);
+
+	return 0;
+}
@@ -0,0 +1,193 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#define BITS_PER_LONG (sizeof(long) * 8)
+
+#include "dummy-cpu.h"
+
+#include <stdlib.h>
+
+static void *__malloc(size_t size, const char *location __attribute__((unused)))
+{
+	return malloc(size);
+}
+
+static void *__realloc(void *ptr, size_t size, const char *location __attribute__((unused)))
+{
+	return realloc(ptr, size);
+}
+
+static void *__zalloc(size_t size, const char *location __attribute__((unused)))
+{
+	return calloc(size, 1);
+}
+
+static inline void __free(void *p, const char *location __attribute__((unused)))
+{
+	return free(p);
+}
+
+#include <skiboot.h>
+
+/* We need mem_region to accept __location__ */
+#define is_rodata(p) true
+#include "../mem_region.c"
+#undef pr_fmt
+#include "../chip-arena.c"
+
+/* But we need device tree to make copies of names. */
+#undef is_rodata
+#define is_rodata(p) false
+
+#include "../device.c"
+#include <assert.h>
+#include <stdio.h>
+
+void lock_caller(struct lock *l, const char *caller)
+{
+	(void)caller;
+	l->lock_val++;
+}
+
+void unlock(struct lock *l)
+{
+	l->lock_val--;
+}
+
+bool lock_held_by_me(struct lock *l)
+{
+	return l->lock_val;
+}
+
+void add_chip_dev_associativity(struct dt_node *dev __attribute__((unused)))
+{
+}
+
+#define TEST_HEAP_SIZE	0x10000
+#define NODE_SIZE	(64 * CHIP_ARENA_PAGE_2M)
+
+static void add_mem_node(uint64_t start, uint64_t len, uint32_t chip_id)
+{
+	struct dt_node *mem;
+	u64 reg[2];
+	char name[sizeof("memory@") + STR_MAX_CHARS(reg[0])];
+
+	reg[0] = cpu_to_be64(start);
+	reg[1] = cpu_to_be64(len);
+	sprintf(name, "memory@%llx", (long long)start);
+
+	mem = dt_new(dt_root, name);
+	dt_add_property_string(mem, "device_type", "memory");
+	dt_add_property(mem, "reg", reg, sizeof(reg));
+	dt_add_property_cells(mem, "ibm,chip-id", chip_id);
+}
+
+static struct mem_region *region_of(void *p)
+{
+	struct mem_region *r;
+
+	lock(&mem_region_lock);
+	r = find_alloc_region(p);
+	unlock(&mem_region_lock);
+	return r;
+}
+
+static bool crosses(void *p, size_t size, uint64_t page)
+{
+	uint64_t s = (uint64_t)p;
+
+	return (s & ~(page - 1)) != ((s + size - 1) & ~(page - 1));
+}
+
+int main(void)
+{
+	void *node0, *node1, *p, *q, *pages[40];
+	struct mem_region *r0;
+	unsigned int i;
+
+	skiboot_heap.start = (unsigned long)malloc(TEST_HEAP_SIZE);
+	skiboot_heap.len = TEST_HEAP_SIZE;
+	skiboot_os_reserve.len = 0;
+
+	dt_root = dt_new_root("");
+	dt_add_property_cells(dt_root, "#address-cells", 2);
+	dt_add_property_cells(dt_root, "#size-cells", 2);
+
+	/* The memory isn't touched, only the allocator headers */
+	node0 = aligned_alloc(CHIP_ARENA_PAGE_2M, NODE_SIZE);
+	node1 = aligned_alloc(CHIP_ARENA_PAGE_2M, NODE_SIZE);
+	assert(node0 && node1);
+	add_mem_node((uint64_t)node0, NODE_SIZE, 0);
+	add_mem_node((uint64_t)node1, NODE_SIZE, 1);
+	mem_region_init();
+
+	r0 = region_of(node0);
+	assert(r0 && r0 != region_of(node1));
+
+	/* 64K pages are packed back to back, with no header between */
+	for (i = 0; i < 40; i++) {
+		pages[i] = chip_arena_alloc(0, "page", 0x10000, 0x10000);
+		assert(pages[i]);
+		assert(mem_chip_id(pages[i]) == 0);
+		if (i)
+			assert(pages[i] == pages[i - 1] + 0x10000);
+	}
+
+	/* Small tables don't cross a 64K page, 2M ones a 2M page */
+	p = chip_arena_alloc(0, "small", 0xc000, 8);
+	q = chip_arena_alloc(0, "small", 0x8000, 8);
+	assert(p && q && q > p);
+	assert(!crosses(q, 0x8000, CHIP_ARENA_PAGE_64K));
+	p = chip_arena_alloc(0, "medium", 0x180000, 0x1000);
+	assert(p && !crosses(p, 0x180000, CHIP_ARENA_PAGE_2M));
+	p = chip_arena_alloc(0, "medium", 0x180000, 0x1000);
+	assert(p && !crosses(p, 0x180000, CHIP_ARENA_PAGE_2M));
+
+	/* Big tables get naturally aligned memory of their own */
+	p = chip_arena_alloc(0, "big", 0x300000, 0x1000);
+	assert(p && !((uint64_t)p & (0x400000 - 1)));
+	assert(mem_chip_id(p) == 0);
+
+	/* Each chip gets its own memory */
+	p = chip_arena_alloc(1, "page", 0x10000, 0x10000);
+	assert(p && mem_chip_id(p) == 1);
+
+	/* A chip without memory still gets its tables, elsewhere */
+	p = chip_arena_alloc(7, "page", 0x10000, 0x10000);
+	assert(p && mem_chip_id(p) != 7);
+
+	/* Silly requests */
+	assert(!chip_arena_alloc(0, "empty", 0, 8));
+	assert(!chip_arena_alloc(0, "huge", NODE_SIZE * 2, 8));
+
+	/* The end of the chunks goes back to the chip's memory */
+	assert(mem_allocated_size(pages[0]) >= CHIP_ARENA_CHUNK_SIZE);
+	chip_arena_finish();
+	assert(mem_allocated_size(pages[0]) < CHIP_ARENA_CHUNK_SIZE / 2);
+
+	/* And later tables get memory of their own */
+	p = chip_arena_alloc(0, "late", 0x8000, 0x1000);
+	assert(p && !((uint64_t)p & (0x8000 - 1)));
+	assert(mem_chip_id(p) == 0);
+
+	dt_free(dt_root);
+	free((void *)(long)skiboot_heap.start);
+	free(node0);
+	free(node1);
+	return 0;
+}
@@ -19,6 +19,8 @@
 #include <string.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
 
 #define __TEST__
 
@@ -47,6 +49,39 @@ ssize_t console_write(bool flush_to_drivers, const void *buf, size_t count)
 	return count;
 }
 
+#define BENCH_LOOPS	100000
+
+static unsigned long elapsed_ns(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1000000000UL +
+		end->tv_nsec - start->tv_nsec;
+}
+
+/* Rough cost of a message stored in memory, and of a filtered out one */
+static void bench_prlog(void)
+{
+	struct timespec start, mid, end;
+	char buf[80];
+	int i, len;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < BENCH_LOOPS; i++)
+		prlog(PR_DEBUG, "PHB#%04x:%02x:%02x.%x reg 0x%016llx = %d %s\n",
+		      i & 0xffff, i & 0xff, 2, 3,
+		      0xdeadbeefcafeULL * i, -i, "ok");
+	clock_gettime(CLOCK_MONOTONIC, &mid);
+	for (i = 0; i < BENCH_LOOPS; i++)
+		prlog(PR_INSANE, "Not stored %d\n", i);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	assert(strstr(console_buffer, "PREFIX: PHB#") != NULL);
+
+	len = snprintf(buf, sizeof(buf), "prlog: %lu ns stored, %lu ns skipped\n",
+		       elapsed_ns(&start, &mid) / BENCH_LOOPS,
+		       elapsed_ns(&mid, &end) / BENCH_LOOPS);
+	assert(write(1, buf, len) == len);
+}
+
 int main(void)
 {
 	debug_descriptor.console_log_levels = 0x75;
@@ -70,5 +105,7 @@ int main(void)
 	assert(strcmp(console_buffer, "[    0.000000042,5] PREFIX: Hello World") == 0);
 	assert(flushed_to_drivers==true);
 
+	bench_prlog();
+
 	return 0;
 }
@@ -26,9 +26,11 @@
 
 unsigned long tb_hz = 512000000;
 
+static unsigned long fake_tb = 42;
+
 static inline unsigned long mftb(void)
 {
-	return 42;
+	return fake_tb;
 }
 
 int _printf(const char* fmt, ...);
@@ -70,5 +72,10 @@ int main(void)
 	assert(strcmp(console_buffer, "[    0.000000042,5] Hello World") == 0);
 	assert(flushed_to_drivers==true);
 
+	// Timestamp wider than the field
+	fake_tb = 123456 * tb_hz + 7;
+	prlog(PR_INFO, "Hello World");
+	assert(strcmp(console_buffer, "[123456.000000007,6] Hello World") == 0);
+
 	return 0;
 }
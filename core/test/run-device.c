@@ -14,9 +14,31 @@
  * limitations under the License.
  */
 
-#include <skiboot.h>
 #include <stdlib.h>
 
+static void *__malloc(size_t size, const char *location __attribute__((unused)))
+{
+	return malloc(size);
+}
+
+static void *__realloc(void *ptr, size_t size, const char *location __attribute__((unused)))
+{
+	return realloc(ptr, size);
+}
+
+static void *__zalloc(size_t size, const char *location __attribute__((unused)))
+{
+	return calloc(size, 1);
+}
+
+static inline void __free(void *p, const char *location __attribute__((unused)))
+{
+	return free(p);
+}
+
+#include <skiboot.h>
+#include <mem_region-malloc.h>
+
 /* Override this for testing. */
 #define is_rodata(p) fake_is_rodata(p)
 
@@ -28,9 +50,10 @@ static inline bool fake_is_rodata(const void *p)
 	return ((char *)p >= __rodata_start && (char *)p < __rodata_end);
 }
 
-#define zalloc(bytes) calloc((bytes), 1)
-
 #include "../device.c"
+#include "../../libfdt/fdt.c"
+#include "../../libfdt/fdt_ro.c"
+#include "../../libfdt/fdt_sw.c"
 #include <assert.h>
 #include "../../test/dt_common.c"
 const char *prop_to_fix[] = {"something", NULL};
@@ -101,6 +124,45 @@ const char **props_to_fix(struct dt_node *node)
 	return NULL;
 }
 
+/* filter for dt_expand_node_filtered(): leaves out the "skip" nodes */
+static bool no_skip(const void *fdt, int offset, void *data)
+{
+	unsigned int *skipped = data;
+
+	if (strncmp(fdt_get_name(fdt, offset, NULL), "skip", 4))
+		return true;
+
+	(*skipped)++;
+	return false;
+}
+
+static void *build_fdt(void)
+{
+	void *fdt = malloc(4096);
+
+	assert(fdt);
+	assert(!fdt_create(fdt, 4096));
+	assert(!fdt_finish_reservemap(fdt));
+	assert(!fdt_begin_node(fdt, ""));
+	assert(!fdt_property_cell(fdt, "version-id", 1));
+	assert(!fdt_begin_node(fdt, "keep@1"));
+	assert(!fdt_begin_node(fdt, "child"));
+	assert(!fdt_property_cell(fdt, "reg", 2));
+	assert(!fdt_end_node(fdt));
+	assert(!fdt_end_node(fdt));
+	assert(!fdt_begin_node(fdt, "skip@1"));
+	assert(!fdt_begin_node(fdt, "keep@2"));
+	assert(!fdt_end_node(fdt));
+	assert(!fdt_property_cell(fdt, "reg", 3));
+	assert(!fdt_end_node(fdt));
+	assert(!fdt_begin_node(fdt, "keep@3"));
+	assert(!fdt_end_node(fdt));
+	assert(!fdt_end_node(fdt));
+	assert(!fdt_finish(fdt));
+
+	return fdt;
+}
+
 int main(void)
 {
 	struct dt_node *root, *c1, *c2, *gc1, *gc2, *gc3, *ggc1, *ggc2;
@@ -108,7 +170,8 @@ int main(void)
 	struct dt_node *i, *subtree, *ev1, *ut1, *ut2;
 	const struct dt_property *p;
 	struct dt_property *p2;
-	unsigned int n;
+	unsigned int n, skipped = 0;
+	void *fdt;
 	char *s;
 	size_t sz;
 	u32 phandle, ev1_ph, new_prop_ph;
@@ -465,6 +528,19 @@ int main(void)
 	new_prop_ph = dt_prop_get_u32(ut2, "something");
 	assert(!(new_prop_ph == ev1_ph));
 	dt_free(subtree);
+
+	/* filtered expansion test */
+	fdt = build_fdt();
+	subtree = dt_new_root("filtered");
+	assert(dt_expand_node_filtered(subtree, fdt, 0, no_skip, &skipped) > 0);
+	assert(skipped == 1);
+	assert(dt_prop_get_u32(subtree, "version-id") == 1);
+	assert(dt_prop_get_u32(dt_find_by_path(subtree, "keep@1/child"), "reg") == 2);
+	assert(!dt_find_by_name(subtree, "skip@1"));
+	assert(!dt_find_by_name(subtree, "keep@2"));
+	assert(dt_find_by_name(subtree, "keep@3"));
+	dt_free(subtree);
+	free(fdt);
 	return 0;
 }
 
@@ -0,0 +1,214 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define __TEST__
+#include <skiboot.h>
+
+/* Thousands of sources get registered, only keep the errors */
+#undef prlog
+#define prlog(l, f, ...) do {					\
+	if ((l) <= PR_ERR)					\
+		_prlog(l, pr_fmt(f), ##__VA_ARGS__);		\
+} while (0)
+
+/* No MMIO, the ICP code isn't exercised here */
+#define __IO_H
+static inline uint32_t in_be32(const volatile void *addr)
+{
+	(void)addr;
+	return 0;
+}
+static inline void out_8(volatile void *addr, uint8_t val)
+{
+	(void)addr;
+	(void)val;
+}
+static inline void out_be32(volatile void *addr, uint32_t val)
+{
+	(void)addr;
+	(void)val;
+}
+
+#define sync()
+#define lwsync()
+#define smt_lowest()
+#define smt_medium()
+
+#include <cpu.h>
+
+static struct cpu_thread fake_cpu;
+#define this_cpu()	(&fake_cpu)
+
+#define zalloc(bytes) calloc((bytes), 1)
+
+#include "../interrupts.c"
+
+void lock_caller(struct lock *l, const char *caller)
+{
+	(void)l;
+	(void)caller;
+}
+
+void unlock(struct lock *l)
+{
+	(void)l;
+}
+
+struct cpu_thread *first_cpu(void)
+{
+	return &fake_cpu;
+}
+
+struct cpu_thread *next_cpu(struct cpu_thread *cpu)
+{
+	(void)cpu;
+	return NULL;
+}
+
+/* Unused, but referenced by interrupts.c */
+enum proc_gen proc_gen = proc_gen_p9;
+struct dt_node *dt_root, *opal_node;
+uint64_t top_of_ram;
+uint64_t opal_pending_events;
+
+#define NR_RANGES	4000
+#define RANGE_SIZE	8
+/* Leave holes between ranges to check misses */
+#define RANGE_STRIDE	16
+
+static const struct irq_source_ops ops;
+static struct irq_source secondary = {
+	.start	= 0,
+	.end	= NR_RANGES * RANGE_STRIDE,
+	.ops	= &ops,
+};
+
+static uint32_t range_start(unsigned int i)
+{
+	return i * RANGE_STRIDE;
+}
+
+/* A permutation of 0..NR_RANGES-1, to register in a random order */
+static void shuffle(unsigned int *order)
+{
+	unsigned int i, j, t;
+
+	for (i = 0; i < NR_RANGES; i++)
+		order[i] = i;
+	for (i = NR_RANGES - 1; i > 0; i--) {
+		j = random() % (i + 1);
+		t = order[i];
+		order[i] = order[j];
+		order[j] = t;
+	}
+}
+
+static void check_lookups(const bool *registered, bool with_secondary)
+{
+	struct irq_source *is;
+	unsigned int i;
+	uint32_t isn;
+
+	for (i = 0; i < NR_RANGES; i++) {
+		for (isn = range_start(i); isn < range_start(i + 1); isn++) {
+			is = irq_find_source(isn);
+			if (registered[i] && isn < range_start(i) + RANGE_SIZE) {
+				assert(is);
+				assert(is->start == range_start(i));
+				assert(is->end == range_start(i) + RANGE_SIZE);
+			} else if (with_secondary) {
+				assert(is == &secondary);
+			} else {
+				assert(!is);
+			}
+		}
+	}
+	assert(!irq_find_source(NR_RANGES * RANGE_STRIDE));
+}
+
+static unsigned int count_sources(const struct list_head *list)
+{
+	struct irq_source *is, *prev = NULL;
+	unsigned int n = 0;
+
+	list_for_each(list, is, link) {
+		/* The lists are kept sorted */
+		assert(!prev || prev->end <= is->start);
+		prev = is;
+		n++;
+	}
+	return n;
+}
+
+int main(void)
+{
+	static bool registered[NR_RANGES];
+	static unsigned int order[NR_RANGES];
+	unsigned int i;
+
+	srandom(1);
+	assert(!irq_find_source(0));
+
+	shuffle(order);
+	for (i = 0; i < NR_RANGES; i++) {
+		register_irq_source(&ops, NULL, range_start(order[i]),
+				    RANGE_SIZE);
+		registered[order[i]] = true;
+	}
+	assert(count_sources(&irq_sources) == NR_RANGES);
+	assert(irq_table->nr_primary == NR_RANGES);
+	check_lookups(registered, false);
+
+	/* Primaries win over an overlapping secondary */
+	__register_irq_source(&secondary, true);
+	check_lookups(registered, true);
+
+	/* Drop every other range, in a random order */
+	shuffle(order);
+	for (i = 0; i < NR_RANGES; i++) {
+		if (order[i] & 1)
+			continue;
+		unregister_irq_source(range_start(order[i]), RANGE_SIZE);
+		registered[order[i]] = false;
+	}
+	assert(count_sources(&irq_sources) == NR_RANGES / 2);
+	check_lookups(registered, true);
+
+	/* The cache must not return a source that is gone */
+	assert(irq_find_source(range_start(1))->start == range_start(1));
+	unregister_irq_source(range_start(1), RANGE_SIZE);
+	registered[1] = false;
+	assert(irq_find_source(range_start(1)) == &secondary);
+
+	/* And register them again */
+	for (i = 0; i < NR_RANGES; i++) {
+		if (registered[i])
+			continue;
+		register_irq_source(&ops, NULL, range_start(i), RANGE_SIZE);
+		registered[i] = true;
+	}
+	assert(count_sources(&irq_sources) == NR_RANGES);
+	assert(count_sources(&irq_sources2) == 1);
+	check_lookups(registered, true);
+
+	return 0;
+}
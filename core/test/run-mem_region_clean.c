@@ -0,0 +1,175 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#define BITS_PER_LONG (sizeof(long) * 8)
+
+#include "dummy-cpu.h"
+
+#include <stdlib.h>
+
+static void *__malloc(size_t size, const char *location __attribute__((unused)))
+{
+	return malloc(size);
+}
+
+static void *__realloc(void *ptr, size_t size, const char *location __attribute__((unused)))
+{
+	return realloc(ptr, size);
+}
+
+static void *__zalloc(size_t size, const char *location __attribute__((unused)))
+{
+	return calloc(size, 1);
+}
+
+static inline void __free(void *p, const char *location __attribute__((unused)))
+{
+	return free(p);
+}
+
+#include <skiboot.h>
+
+#define is_rodata(p) true
+#include "../mem_region.c"
+
+#undef is_rodata
+#define is_rodata(p) false
+
+#include "../device.c"
+#include <assert.h>
+#include <stdio.h>
+
+void lock_caller(struct lock *l, const char *caller)
+{
+	(void)caller;
+	l->lock_val++;
+}
+
+void unlock(struct lock *l)
+{
+	l->lock_val--;
+}
+
+bool lock_held_by_me(struct lock *l)
+{
+	return l->lock_val;
+}
+
+void add_chip_dev_associativity(struct dt_node *dev __attribute__((unused)))
+{
+}
+
+#define PAGE		0x1000ULL
+#define NR_PAGES	256
+
+static struct mem_region os_region = {
+	.name	= "test-os",
+	.type	= REGION_OS,
+	.len	= NR_PAGES * PAGE,
+};
+
+static uint64_t page(unsigned int n)
+{
+	return os_region.start + n * PAGE;
+}
+
+static int64_t report(unsigned int first, unsigned int nr)
+{
+	return opal_report_clean_memory(page(first), nr * PAGE);
+}
+
+static void check_ranges(unsigned int nr, const unsigned int *pages)
+{
+	unsigned int i;
+
+	assert(mem_clean_nr == nr);
+	for (i = 0; i < nr; i++) {
+		assert(mem_clean_ranges[i].start == page(pages[i * 2]));
+		assert(mem_clean_ranges[i].end == page(pages[i * 2 + 1]));
+	}
+}
+
+int main(void)
+{
+	unsigned char *mem;
+	unsigned int i;
+
+	mem = aligned_alloc(PAGE, NR_PAGES * PAGE);
+	assert(mem);
+	os_region.start = (unsigned long)mem;
+	assert(add_region(&os_region));
+
+	/* Not page aligned, empty, wrapping or not OS memory */
+	assert(opal_report_clean_memory(page(1) + 8, PAGE) == OPAL_PARAMETER);
+	assert(opal_report_clean_memory(page(1), PAGE / 2) == OPAL_PARAMETER);
+	assert(opal_report_clean_memory(page(1), 0) == OPAL_PARAMETER);
+	assert(opal_report_clean_memory(page(1), -PAGE) == OPAL_PARAMETER);
+	assert(report(NR_PAGES - 1, 2) == OPAL_PARAMETER);
+	assert(mem_clean_nr == 0);
+
+	/* Overlapping and touching ranges get merged, in any order */
+	assert(report(8, 2) == OPAL_SUCCESS);
+	assert(report(2, 2) == OPAL_SUCCESS);
+	assert(report(20, 4) == OPAL_SUCCESS);
+	check_ranges(3, (unsigned int []){ 2, 4, 8, 10, 20, 24 });
+	assert(report(3, 3) == OPAL_SUCCESS);
+	check_ranges(3, (unsigned int []){ 2, 6, 8, 10, 20, 24 });
+	assert(report(6, 2) == OPAL_SUCCESS);
+	check_ranges(2, (unsigned int []){ 2, 10, 20, 24 });
+	assert(report(1, 30) == OPAL_SUCCESS);
+	check_ranges(1, (unsigned int []){ 1, 31 });
+	assert(report(4, 2) == OPAL_SUCCESS);
+	check_ranges(1, (unsigned int []){ 1, 31 });
+
+	/* Forget them all */
+	assert(opal_report_clean_memory(0, 0) == OPAL_SUCCESS);
+	assert(mem_clean_nr == 0);
+
+	/* The table is full, but ranges can still grow */
+	for (i = 0; i < MEM_CLEAN_MAX_RANGES; i++)
+		assert(report(i * 2, 1) == OPAL_SUCCESS);
+	assert(report(i * 2, 1) == OPAL_RESOURCE);
+	assert(report(1, 1) == OPAL_SUCCESS);
+	assert(mem_clean_nr == MEM_CLEAN_MAX_RANGES - 1);
+
+	/* The next OS doesn't inherit them */
+	mem_clean_ranges_reset();
+	assert(mem_clean_nr == 0);
+
+	/* Only the pages that weren't reported get cleared */
+	memset(mem, 0xaa, NR_PAGES * PAGE);
+	assert(report(0, 3) == OPAL_SUCCESS);
+	assert(report(10, 5) == OPAL_SUCCESS);
+	assert(report(NR_PAGES - 2, 2) == OPAL_SUCCESS);
+	mem_clear_dirty_range(page(0), page(NR_PAGES));
+	for (i = 0; i < NR_PAGES; i++) {
+		bool clean = i < 3 || (i >= 10 && i < 15) || i >= NR_PAGES - 2;
+
+		assert(mem[i * PAGE] == (clean ? 0xaa : 0));
+		assert(mem[i * PAGE + PAGE - 1] == (clean ? 0xaa : 0));
+	}
+
+	/* Within part of the memory only */
+	memset(mem, 0xaa, NR_PAGES * PAGE);
+	mem_clear_dirty_range(page(12), page(20));
+	for (i = 0; i < NR_PAGES; i++)
+		assert(mem[i * PAGE] == (i >= 15 && i < 20 ? 0 : 0xaa));
+
+	free(mem);
+	return 0;
+}
@@ -92,15 +92,16 @@ int main(void)
 	assert(add_region(r));
 	mem_regions_finalised = true;
 
+	/* Regions are kept in address order */
 	r = mem_region_next(NULL);
 	assert(r);
-	assert(r->start == 0x2000);
+	assert(r->start == 0x1000);
 	assert(r->len == 0x1000);
 	assert(r->type == REGION_RESERVED);
 
 	r = mem_region_next(r);
 	assert(r);
-	assert(r->start == 0x1000);
+	assert(r->start == 0x2000);
 	assert(r->len == 0x1000);
 	assert(r->type == REGION_RESERVED);
 
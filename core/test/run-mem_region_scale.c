@@ -0,0 +1,293 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#define BITS_PER_LONG (sizeof(long) * 8)
+
+#include "dummy-cpu.h"
+
+#include <stdlib.h>
+
+static void *__malloc(size_t size, const char *location __attribute__((unused)))
+{
+	return malloc(size);
+}
+
+static void *__realloc(void *ptr, size_t size, const char *location __attribute__((unused)))
+{
+	return realloc(ptr, size);
+}
+
+static void *__zalloc(size_t size, const char *location __attribute__((unused)))
+{
+	return calloc(size, 1);
+}
+
+static inline void __free(void *p, const char *location __attribute__((unused)))
+{
+	return free(p);
+}
+
+#include <skiboot.h>
+
+/* Thousands of regions get added, only keep the errors */
+#undef prlog
+#define prlog(l, f, ...) do {					\
+	if ((l) <= PR_ERR)					\
+		_prlog(l, pr_fmt(f), ##__VA_ARGS__);		\
+} while (0)
+
+/* We need mem_region to accept __location__ */
+#define is_rodata(p) true
+#include "../mem_region.c"
+
+/* But we need device tree to make copies of names. */
+#undef is_rodata
+#define is_rodata(p) false
+
+#include "../device.c"
+#include <assert.h>
+#include <stdio.h>
+
+void lock_caller(struct lock *l, const char *caller)
+{
+	(void)caller;
+	l->lock_val++;
+}
+
+void unlock(struct lock *l)
+{
+	l->lock_val--;
+}
+
+bool lock_held_by_me(struct lock *l)
+{
+	return l->lock_val;
+}
+
+void add_chip_dev_associativity(struct dt_node *dev __attribute__((unused)))
+{
+}
+
+#define TEST_HEAP_SIZE	0x10000
+
+/* The memory is never touched, it only has to look like memory */
+#define NR_NODES	4
+#define NODE_BASE	0x100000000000ull
+#define NODE_SIZE	0x4000000000ull		/* 256GB */
+
+/* Reservations of 64K every 16MB, half of them added before init */
+#define NR_RESERVES	4000
+#define RESERVE_SIZE	0x10000ull
+#define RESERVE_STRIDE	0x1000000ull
+
+/*
+ * Pairs of adjacent reservations of the same name, in reserved-names/
+ * -ranges, get coalesced
+ */
+#define NR_PAIRS	500
+#define PAIRS_BASE	(NODE_BASE + 0x1000000000ull)
+
+static void add_mem_node(uint64_t start, uint64_t len)
+{
+	struct dt_node *mem;
+	u64 reg[2];
+	char name[sizeof("memory@") + STR_MAX_CHARS(reg[0])];
+
+	reg[0] = cpu_to_be64(start);
+	reg[1] = cpu_to_be64(len);
+	sprintf(name, "memory@%llx", (long long)start);
+
+	mem = dt_new(dt_root, name);
+	dt_add_property_string(mem, "device_type", "memory");
+	dt_add_property(mem, "reg", reg, sizeof(reg));
+}
+
+static void add_reserved_pairs(void)
+{
+	static char names[2 * NR_PAIRS * sizeof("pair")];
+	static u64 ranges[2 * NR_PAIRS][2];
+	unsigned int i, j;
+	uint64_t s;
+
+	/* Each half of a pair, in either order */
+	for (i = 0; i < 2 * NR_PAIRS; i++) {
+		strcpy(names + i * sizeof("pair"), "pair");
+		j = (i & 1) ^ ((i >> 1) & 1);
+		s = PAIRS_BASE + (i / 2) * RESERVE_STRIDE + j * RESERVE_SIZE;
+		ranges[i][0] = cpu_to_be64(s);
+		ranges[i][1] = cpu_to_be64(RESERVE_SIZE);
+	}
+
+	dt_add_property(dt_root, "reserved-names", names, sizeof(names));
+	dt_add_property(dt_root, "reserved-ranges", ranges, sizeof(ranges));
+}
+
+static uint64_t reserve_start(unsigned int i)
+{
+	return NODE_BASE + (i / (NR_RESERVES / NR_NODES)) * NODE_SIZE +
+		(i % (NR_RESERVES / NR_NODES)) * RESERVE_STRIDE;
+}
+
+static void shuffle(unsigned int *order, unsigned int nr)
+{
+	unsigned int i, j, t;
+
+	for (i = 0; i < nr; i++)
+		order[i] = i;
+	for (i = nr - 1; i > 0; i--) {
+		j = random() % (i + 1);
+		t = order[i];
+		order[i] = order[j];
+		order[j] = t;
+	}
+}
+
+/* The list is sorted, without overlaps, and matches the index */
+static unsigned int check_regions(void)
+{
+	struct mem_region *r, *prev = NULL;
+	unsigned int n = 0;
+
+	list_for_each(&regions, r, list) {
+		assert(n < region_nr && region_index[n] == r);
+		if (prev)
+			assert(prev->start + prev->len <= r->start);
+		prev = r;
+		n++;
+	}
+	assert(n == region_nr);
+	return n;
+}
+
+static void check_reserves(void)
+{
+	struct mem_region *r;
+	unsigned int i;
+	uint64_t s;
+
+	for (i = 0; i < NR_RESERVES; i++) {
+		s = reserve_start(i);
+		r = find_region(s + RESERVE_SIZE / 2);
+		assert(r && r->start == s && r->len == RESERVE_SIZE);
+		assert(r->type == REGION_FW_RESERVED);
+		assert(mem_range_is_reserved(s, RESERVE_SIZE));
+		assert(!mem_range_is_reserved(s, RESERVE_SIZE + 1));
+		assert(!mem_range_is_reserved(s - 1, 2));
+
+		r = find_region(s + RESERVE_SIZE);
+		assert(r && r->type == REGION_MEMORY);
+	}
+
+	for (i = 0; i < NR_PAIRS; i++) {
+		s = PAIRS_BASE + i * RESERVE_STRIDE;
+		r = find_region(s);
+		assert(r && r->start == s && r->len == 2 * RESERVE_SIZE);
+		assert(mem_range_is_reserved(s, 2 * RESERVE_SIZE));
+	}
+}
+
+int main(void)
+{
+	static unsigned int order[NR_RESERVES];
+	struct mem_region *r;
+	unsigned int i, n;
+	uint64_t s;
+
+	srandom(1);
+
+	skiboot_heap.start = (unsigned long)malloc(TEST_HEAP_SIZE);
+	skiboot_heap.len = TEST_HEAP_SIZE;
+	skiboot_os_reserve.len = 0;
+
+	dt_root = dt_new_root("");
+	dt_add_property_cells(dt_root, "#address-cells", 2);
+	dt_add_property_cells(dt_root, "#size-cells", 2);
+
+	for (i = 0; i < NR_NODES; i++)
+		add_mem_node(NODE_BASE + i * NODE_SIZE, NODE_SIZE);
+	add_reserved_pairs();
+
+	/* Half the reservations come from HDAT, before init */
+	shuffle(order, NR_RESERVES);
+	for (i = 0; i < NR_RESERVES / 2; i++)
+		mem_reserve_fw("early", reserve_start(order[i]), RESERVE_SIZE);
+	assert(mem_range_is_reserved(reserve_start(order[0]), RESERVE_SIZE));
+
+	mem_region_init();
+	check_regions();
+
+	for (; i < NR_RESERVES; i++)
+		mem_reserve_fw("late", reserve_start(order[i]), RESERVE_SIZE);
+
+	/*
+	 * Each reservation splits a memory region in two, and adds
+	 * itself, except for those at the start of a node. A pair counts
+	 * as one. The skiboot regions are outside of our nodes.
+	 */
+	n = check_regions();
+	i = 0;
+	list_for_each(&regions, r, list)
+		if (r->start < NODE_BASE || r->start >= NODE_BASE + NR_NODES * NODE_SIZE)
+			i++;
+	assert(n - i == 2 * NR_RESERVES + 2 * NR_PAIRS);
+	check_reserves();
+
+	/* Those made by drivers, like the per chip HOMERs, stay apart */
+	s = PAIRS_BASE + NR_PAIRS * RESERVE_STRIDE;
+	mem_reserve_fw("per-chip", s, RESERVE_SIZE);
+	mem_reserve_fw("per-chip", s + RESERVE_SIZE, RESERVE_SIZE);
+	assert(find_region(s)->len == RESERVE_SIZE);
+	assert(find_region(s + RESERVE_SIZE)->start == s + RESERVE_SIZE);
+	assert(find_region(s + RESERVE_SIZE)->len == RESERVE_SIZE);
+
+	/* Reservations straddling two regions are refused */
+	lock(&mem_region_lock);
+	s = reserve_start(10);
+	r = new_region("straddle", s - 0x1000, 0x2000, NULL, REGION_RESERVED);
+	assert(!add_region(r));
+	free(r);
+
+	/* Adjacent ones with another name aren't merged */
+	s = PAIRS_BASE + 2 * RESERVE_SIZE;
+	r = new_region("other", s, RESERVE_SIZE, NULL, REGION_FW_RESERVED);
+	assert(add_region(r));
+	assert(find_region(PAIRS_BASE)->len == 2 * RESERVE_SIZE);
+	assert(find_region(s) == r);
+	assert(mem_range_is_reserved(PAIRS_BASE, 3 * RESERVE_SIZE));
+
+	/* Empty regions split the region they are in */
+	s = reserve_start(20) + RESERVE_SIZE + 0x8000;
+	r = new_region("empty", s, 0, NULL, REGION_RESERVED);
+	assert(add_region(r));
+	assert(find_region(s)->start == s);
+	assert(find_region(s - 1)->start + find_region(s - 1)->len == s);
+	unlock(&mem_region_lock);
+	check_regions();
+	check_reserves();
+
+	mem_region_release_unused();
+	check_regions();
+	mem_region_add_dt_reserved();
+	assert(dt_find_property(dt_root, "reserved-ranges")->len ==
+	       (int)(2 * sizeof(u64) * (NR_RESERVES + NR_PAIRS + 4)) +
+	       2 * (int)sizeof(u64) * 4);
+
+	dt_free(dt_root);
+	free((void *)(long)skiboot_heap.start);
+	return 0;
+}
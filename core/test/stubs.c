@@ -107,3 +107,16 @@ STUB(dt_next);
 STUB(dt_has_node_property);
 STUB(dt_get_address);
 STUB(add_chip_dev_associativity);
+STUB(dt_add_property);
+STUB(dt_add_property_string);
+STUB(__dt_add_property_cells);
+STUB(__dt_add_property_strings);
+STUB(dt_new_addr);
+STUB(dt_find_compatible_node);
+STUB(dt_get_number);
+STUB(dt_require_property);
+STUB(find_cpu_by_server);
+STUB(get_chip);
+STUB(check_timers);
+STUB(p8_sbe_timer_ok);
+STUB(p9_sbe_timer_ok);
@@ -19,9 +19,20 @@
 #include <opal.h>
 #include <cpu.h>
 #include <chip.h>
+#include <opal-profile.h>
 
 unsigned long tb_hz = 512000000;
 
+static void __time_wait_nopoll(unsigned long duration)
+{
+	if (this_cpu()->tb_invalid) {
+		cpu_relax();
+		return;
+	}
+
+	cpu_idle_delay(duration);
+}
+
 static void time_wait_poll(unsigned long duration)
 {
 	unsigned long now = mftb();
@@ -40,9 +51,9 @@ static void time_wait_poll(unsigned long duration)
 		 * bouncing cachelines due to lock contention. */
 		if (remaining >= period) {
 			opal_run_pollers();
-			time_wait_nopoll(period);
+			__time_wait_nopoll(period);
 		} else
-			time_wait_nopoll(remaining);
+			__time_wait_nopoll(remaining);
 
 		now = mftb();
 	}
@@ -52,25 +63,23 @@ void time_wait(unsigned long duration)
 {
 	struct cpu_thread *c = this_cpu();
 
+	opal_profile_wait(duration);
+
 	if (!list_empty(&this_cpu()->locks_held)) {
-		time_wait_nopoll(duration);
+		__time_wait_nopoll(duration);
 		return;
 	}
 
 	if (c != boot_cpu)
-		time_wait_nopoll(duration);
+		__time_wait_nopoll(duration);
 	else
 		time_wait_poll(duration);
 }
 
 void time_wait_nopoll(unsigned long duration)
 {
-	if (this_cpu()->tb_invalid) {
-		cpu_relax();
-		return;
-	}
-
-	cpu_idle_delay(duration);
+	opal_profile_wait(duration);
+	__time_wait_nopoll(duration);
 }
 
 void time_wait_ms(unsigned long ms)
@@ -0,0 +1,372 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Reader for the boot phase timings exported by skiboot.
+ *
+ * Reads /sys/firmware/opal/exports/boot_phases (or a copy of it) and
+ * prints either a report of the boot phases and of the CPU jobs, a CSV
+ * of all the records, or folded stacks which flamegraph.pl turns into
+ * a flame chart. The layout is the one described in skiboot's
+ * include/boot-phase.h; it is big endian.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "../../ccan/endian/endian.h"
+#include "../../ccan/short_types/short_types.h"
+
+#define DEFAULT_PATH	"/sys/firmware/opal/exports/boot_phases"
+
+#define BOOT_PHASE_MAGIC	0x42505446
+#define BOOT_PHASE_VERSION	1
+#define BOOT_PHASE_NAME_LEN	24
+#define BOOT_PHASE_JOB		0x0001
+
+struct boot_phase_header {
+	be32 magic;
+	be16 version;
+	be16 record_size;
+	be32 nr_records;
+	be32 max_records;
+	be32 dropped;
+	be32 reserved;
+	be64 tb_hz;
+} __attribute__((__packed__));
+
+struct boot_phase_record {
+	be64 start_tb;
+	be64 end_tb;
+	be32 pir;
+	be16 depth;
+	be16 flags;
+	char name[BOOT_PHASE_NAME_LEN];
+} __attribute__((__packed__));
+
+/* Host endian copy of a record */
+struct phase {
+	u64 start;
+	u64 end;
+	u64 self;	/* Duration minus the children's */
+	u32 pir;
+	u16 depth;
+	u16 flags;
+	int parent;
+	char name[BOOT_PHASE_NAME_LEN + 1];
+};
+
+static struct phase *phases;
+static unsigned int nr_phases;
+static u64 tb_hz;
+static u64 first_tb;
+
+static double tb_to_ms(u64 tb)
+{
+	return (double)tb * 1000 / tb_hz;
+}
+
+/*
+ * Phases that never ended, or that straddle the timebase jump done by
+ * chiptod_init(), don't have a meaningful duration.
+ */
+static u64 duration(const struct phase *p)
+{
+	return p->end > p->start ? p->end - p->start : 0;
+}
+
+static void load(const char *path)
+{
+	const struct boot_phase_header *hdr;
+	const struct boot_phase_record *rec;
+	unsigned int i, max;
+	struct stat st;
+	u8 *area;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		err(1, "Opening %s", path);
+	if (fstat(fd, &st) < 0)
+		err(1, "Stat %s", path);
+	if ((size_t)st.st_size < sizeof(*hdr))
+		errx(1, "%s: too small for boot phases", path);
+
+	area = malloc(st.st_size);
+	if (!area)
+		err(1, "Allocating %lld bytes", (long long)st.st_size);
+	if (pread(fd, area, st.st_size, 0) != st.st_size)
+		err(1, "Reading %s", path);
+	close(fd);
+
+	hdr = (const void *)area;
+	if (be32_to_cpu(hdr->magic) != BOOT_PHASE_MAGIC ||
+	    be16_to_cpu(hdr->version) != BOOT_PHASE_VERSION ||
+	    be16_to_cpu(hdr->record_size) != sizeof(*rec))
+		errx(1, "%s: unsupported boot phase layout", path);
+
+	max = be32_to_cpu(hdr->max_records);
+	nr_phases = be32_to_cpu(hdr->nr_records);
+	tb_hz = be64_to_cpu(hdr->tb_hz);
+	if (nr_phases > max ||
+	    sizeof(*hdr) + max * sizeof(*rec) > (size_t)st.st_size || !tb_hz)
+		errx(1, "%s: corrupted boot phase header", path);
+	if (be32_to_cpu(hdr->dropped))
+		warnx("%u records were dropped, the area was full",
+		      be32_to_cpu(hdr->dropped));
+
+	phases = calloc(nr_phases, sizeof(*phases));
+	if (nr_phases && !phases)
+		err(1, "Allocating phases");
+
+	rec = (const void *)(hdr + 1);
+	for (i = 0; i < nr_phases; i++) {
+		struct phase *p = &phases[i];
+
+		p->start = be64_to_cpu(rec[i].start_tb);
+		p->end = be64_to_cpu(rec[i].end_tb);
+		p->pir = be32_to_cpu(rec[i].pir);
+		p->depth = be16_to_cpu(rec[i].depth);
+		p->flags = be16_to_cpu(rec[i].flags);
+		p->parent = -1;
+		memcpy(p->name, rec[i].name, BOOT_PHASE_NAME_LEN);
+		p->name[BOOT_PHASE_NAME_LEN] = '\0';
+
+		if (!i || p->start < first_tb)
+			first_tb = p->start;
+	}
+	free(area);
+}
+
+static int cmp_cpu_start(const void *a, const void *b)
+{
+	const struct phase *pa = *(struct phase * const *)a;
+	const struct phase *pb = *(struct phase * const *)b;
+
+	if (pa->pir != pb->pir)
+		return pa->pir < pb->pir ? -1 : 1;
+	if (pa->start != pb->start)
+		return pa->start < pb->start ? -1 : 1;
+	return pa->depth - pb->depth;
+}
+
+/*
+ * Rebuild the call tree: walking the records of each CPU in start
+ * order, the parent of a record is the last open one a level up.
+ */
+static void link_parents(void)
+{
+	struct phase **sorted, *stack[64];
+	unsigned int i, sp = 0;
+	u32 pir = 0;
+
+	sorted = malloc(nr_phases * sizeof(*sorted));
+	if (nr_phases && !sorted)
+		err(1, "Allocating phases");
+	for (i = 0; i < nr_phases; i++)
+		sorted[i] = &phases[i];
+	qsort(sorted, nr_phases, sizeof(*sorted), cmp_cpu_start);
+
+	for (i = 0; i < nr_phases; i++) {
+		struct phase *p = sorted[i];
+
+		if (!i || p->pir != pir)
+			sp = 0;
+		pir = p->pir;
+
+		while (sp && stack[sp - 1]->depth >= p->depth)
+			sp--;
+		p->self = duration(p);
+		if (sp) {
+			struct phase *parent = stack[sp - 1];
+
+			p->parent = parent - phases;
+			parent->self -= parent->self > duration(p) ?
+				duration(p) : parent->self;
+		}
+		if (sp < sizeof(stack) / sizeof(stack[0]))
+			stack[sp++] = p;
+	}
+	free(sorted);
+}
+
+static void print_csv(void)
+{
+	unsigned int i;
+
+	printf("name,type,pir,depth,parent,start_tb,end_tb,start_ms,"
+	       "duration_ms,self_ms\n");
+	for (i = 0; i < nr_phases; i++) {
+		const struct phase *p = &phases[i];
+
+		printf("%s,%s,0x%x,%u,%s,%" PRIu64 ",%" PRIu64
+		       ",%.3f,%.3f,%.3f\n", p->name,
+		       p->flags & BOOT_PHASE_JOB ? "job" : "phase",
+		       p->pir, p->depth,
+		       p->parent >= 0 ? phases[p->parent].name : "",
+		       p->start, p->end, tb_to_ms(p->start - first_tb),
+		       tb_to_ms(duration(p)), tb_to_ms(p->self));
+	}
+}
+
+static void print_stack(const struct phase *p)
+{
+	if (p->parent >= 0) {
+		print_stack(&phases[p->parent]);
+		printf(";");
+	} else {
+		printf("cpu_0x%x;", p->pir);
+	}
+	printf("%s", p->name);
+}
+
+/* One line per record: "cpu;phase;...;name self_time_in_us" */
+static void print_folded(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_phases; i++) {
+		u64 us = phases[i].self * 1000000 / tb_hz;
+
+		if (!us)
+			continue;
+		print_stack(&phases[i]);
+		printf(" %" PRIu64 "\n", us);
+	}
+}
+
+struct job_stats {
+	char name[BOOT_PHASE_NAME_LEN + 1];
+	unsigned int count;
+	u64 total;
+	u64 max;
+	u64 first;
+	u64 last;
+};
+
+static void print_report(void)
+{
+	struct job_stats *jobs;
+	unsigned int i, j, nr_jobs = 0;
+	u64 last_tb = first_tb;
+
+	jobs = calloc(nr_phases, sizeof(*jobs));
+	if (nr_phases && !jobs)
+		err(1, "Allocating job stats");
+
+	printf("%10s %10s  %s\n", "start(ms)", "time(ms)", "phase");
+	for (i = 0; i < nr_phases; i++) {
+		const struct phase *p = &phases[i];
+
+		if (p->end > last_tb)
+			last_tb = p->end;
+
+		if (p->flags & BOOT_PHASE_JOB) {
+			for (j = 0; j < nr_jobs; j++)
+				if (!strcmp(jobs[j].name, p->name))
+					break;
+			if (j == nr_jobs) {
+				strcpy(jobs[nr_jobs++].name, p->name);
+				jobs[j].first = p->start;
+			}
+			jobs[j].count++;
+			jobs[j].total += duration(p);
+			if (duration(p) > jobs[j].max)
+				jobs[j].max = duration(p);
+			if (p->end > jobs[j].last)
+				jobs[j].last = p->end;
+			continue;
+		}
+
+		printf("%10.3f ", tb_to_ms(p->start - first_tb));
+		if (p->end)
+			printf("%10.3f", tb_to_ms(duration(p)));
+		else
+			printf("%10s", "-");
+		printf("  %*s%s\n", p->depth * 2, "", p->name);
+	}
+
+	if (nr_jobs) {
+		printf("\n%-24s %6s %10s %10s %10s\n", "job", "count",
+		       "cpu(ms)", "max(ms)", "wall(ms)");
+		for (j = 0; j < nr_jobs; j++)
+			printf("%-24s %6u %10.3f %10.3f %10.3f\n",
+			       jobs[j].name, jobs[j].count,
+			       tb_to_ms(jobs[j].total), tb_to_ms(jobs[j].max),
+			       tb_to_ms(jobs[j].last > jobs[j].first ?
+					jobs[j].last - jobs[j].first : 0));
+	}
+
+	printf("\n%u records, %.3f ms from the first to the last\n",
+	       nr_phases, tb_to_ms(last_tb - first_tb));
+	free(jobs);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [-f file] [-c | -g]\n", prog);
+	fprintf(stderr, "  -f file   boot phases (default %s)\n", DEFAULT_PATH);
+	fprintf(stderr, "  -c        CSV of all the records\n");
+	fprintf(stderr, "  -g        folded stacks, for flamegraph.pl\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = DEFAULT_PATH;
+	char mode = 'r';
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:cgh")) != -1) {
+		switch (opt) {
+		case 'f':
+			path = optarg;
+			break;
+		case 'c':
+		case 'g':
+			mode = opt;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	load(path);
+	link_parents();
+
+	switch (mode) {
+	case 'c':
+		print_csv();
+		break;
+	case 'g':
+		print_folded();
+		break;
+	default:
+		print_report();
+	}
+
+	free(phases);
+	return 0;
+}
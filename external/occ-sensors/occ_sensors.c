@@ -0,0 +1,350 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Reference reader for the OCC inband sensors exported by skiboot.
+ *
+ * Maps /sys/firmware/opal/exports/occ_inband_sensors (or a copy of it)
+ * and prints a consistent snapshot of the sensors of each OCC, without
+ * going through OPAL_SENSOR_READ for every sensor. The layout is the one
+ * described in skiboot's include/occ.h; it is big endian.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "../../ccan/endian/endian.h"
+#include "../../ccan/short_types/short_types.h"
+
+#define DEFAULT_PATH	"/sys/firmware/opal/exports/occ_inband_sensors"
+
+#define OCC_SENSOR_DATA_BLOCK_SIZE	0x00025800
+#define OCC_READING_BUFFER_SIZE		0xa000
+#define OCC_MAX_CHARS_SENSOR_NAME	16
+#define OCC_MAX_CHARS_SENSOR_UNIT	4
+
+#define OCC_SENSOR_READING_FULL		0x01
+#define OCC_SENSOR_READING_COUNTER	0x02
+
+#define OCC_SENSOR_TYPE_CURRENT		0x0002
+
+#define SNAPSHOT_RETRIES	10
+
+/* Versions of the layout this reader understands */
+#define OCC_HEADER_VERSION	0x01
+#define OCC_READING_VERSION	0x01
+#define OCC_NAMES_VERSION	0x01
+
+struct occ_sensor_data_header {
+	u8 valid;
+	u8 version;
+	be16 nr_sensors;
+	u8 reading_version;
+	u8 pad[3];
+	be32 names_offset;
+	u8 names_version;
+	u8 name_length;
+	be16 reserved;
+	be32 reading_ping_offset;
+	be32 reading_pong_offset;
+} __attribute__((__packed__));
+
+struct occ_sensor_name {
+	char name[OCC_MAX_CHARS_SENSOR_NAME];
+	char units[OCC_MAX_CHARS_SENSOR_UNIT];
+	be16 gsid;
+	be32 freq;
+	be32 scale_factor;
+	be16 type;
+	be16 location;
+	u8 structure_type;
+	be32 reading_offset;
+	u8 sensor_data;
+	u8 pad[8];
+} __attribute__((__packed__));
+
+struct occ_sensor_record {
+	be16 gsid;
+	be64 timestamp;
+	be16 sample;
+	be16 sample_min;
+	be16 sample_max;
+	be16 csm_min;
+	be16 csm_max;
+	be16 profiler_min;
+	be16 profiler_max;
+	be16 job_scheduler_min;
+	be16 job_scheduler_max;
+	be64 accumulator;
+	be32 update_tag;
+	u8 pad[8];
+} __attribute__((__packed__));
+
+struct occ_sensor_counter {
+	be16 gsid;
+	be64 timestamp;
+	be64 accumulator;
+	u8 sample;
+	u8 pad[5];
+} __attribute__((__packed__));
+
+static bool check_header(const struct occ_sensor_data_header *hb, int occ)
+{
+	u32 ping = be32_to_cpu(hb->reading_ping_offset);
+	u32 pong = be32_to_cpu(hb->reading_pong_offset);
+	u32 names = be32_to_cpu(hb->names_offset);
+	u16 nr = be16_to_cpu(hb->nr_sensors);
+
+	if (hb->valid != 0x01) {
+		warnx("OCC %d: sensor data not valid", occ);
+		return false;
+	}
+
+	if (hb->version != OCC_HEADER_VERSION ||
+	    hb->reading_version != OCC_READING_VERSION ||
+	    hb->names_version != OCC_NAMES_VERSION ||
+	    hb->name_length != sizeof(struct occ_sensor_name)) {
+		warnx("OCC %d: unsupported layout (header %d, readings %d, "
+		      "names %d/%d)", occ, hb->version, hb->reading_version,
+		      hb->names_version, hb->name_length);
+		return false;
+	}
+
+	if (!nr || names + nr * sizeof(struct occ_sensor_name) >
+	    OCC_SENSOR_DATA_BLOCK_SIZE ||
+	    ping + OCC_READING_BUFFER_SIZE > OCC_SENSOR_DATA_BLOCK_SIZE ||
+	    pong + OCC_READING_BUFFER_SIZE > OCC_SENSOR_DATA_BLOCK_SIZE) {
+		warnx("OCC %d: bad sensor buffer offsets", occ);
+		return false;
+	}
+
+	return true;
+}
+
+/* Every record type starts with the gsid and the timestamp */
+static u64 buffer_timestamp(const u8 *buf, const struct occ_sensor_name *md)
+{
+	const struct occ_sensor_record *r;
+
+	r = (const void *)(buf + be32_to_cpu(md[0].reading_offset));
+	return be64_to_cpu(r->timestamp);
+}
+
+/*
+ * Same choice as skiboot's OPAL_OCC_SENSOR_BUFFER: the valid buffer
+ * with the most recent timestamp.
+ */
+static const u8 *select_buffer(const u8 *block,
+			       const struct occ_sensor_data_header *hb,
+			       const struct occ_sensor_name *md, u64 *tb)
+{
+	const u8 *ping = block + be32_to_cpu(hb->reading_ping_offset);
+	const u8 *pong = block + be32_to_cpu(hb->reading_pong_offset);
+	u64 tping = buffer_timestamp(ping, md);
+	u64 tpong = buffer_timestamp(pong, md);
+
+	if (*ping && (!*pong || tping > tpong)) {
+		*tb = tping;
+		return ping;
+	}
+
+	if (*pong) {
+		*tb = tpong;
+		return pong;
+	}
+
+	return NULL;
+}
+
+/*
+ * Copy the current readings buffer out, and check it was not marked
+ * invalid or refilled by the OCC while we were copying it.
+ */
+static bool snapshot(const u8 *block, const struct occ_sensor_data_header *hb,
+		     const struct occ_sensor_name *md, u8 *copy, u64 *tb)
+{
+	const volatile u8 *buf;
+	int i;
+
+	for (i = 0; i < SNAPSHOT_RETRIES; i++) {
+		buf = select_buffer(block, hb, md, tb);
+		if (!buf) {
+			usleep(1000);
+			continue;
+		}
+
+		memcpy(copy, (const void *)buf, OCC_READING_BUFFER_SIZE);
+
+		if (*buf && buffer_timestamp((const u8 *)buf, md) == *tb)
+			return true;
+	}
+
+	return false;
+}
+
+/* (mantissa << 8) | (s8)exponent, as in skiboot's scale_sensor() */
+static double scale(const struct occ_sensor_name *md, u64 value)
+{
+	u32 factor = be32_to_cpu(md->scale_factor);
+	double v = (double)value * (factor >> 8);
+	s8 exp = factor & 0xff;
+
+	for (; exp > 0; exp--)
+		v *= 10;
+	for (; exp < 0; exp++)
+		v /= 10;
+
+	return v;
+}
+
+static void print_sensors(const struct occ_sensor_data_header *hb,
+			  const struct occ_sensor_name *md, const u8 *copy)
+{
+	u16 nr = be16_to_cpu(hb->nr_sensors);
+	char name[OCC_MAX_CHARS_SENSOR_NAME + 1];
+	char units[OCC_MAX_CHARS_SENSOR_UNIT + 1];
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		u32 off = be32_to_cpu(md[i].reading_offset);
+
+		memcpy(name, md[i].name, sizeof(md[i].name));
+		name[sizeof(md[i].name)] = '\0';
+		memcpy(units, md[i].units, sizeof(md[i].units));
+		units[sizeof(md[i].units)] = '\0';
+
+		if (md[i].structure_type == OCC_SENSOR_READING_FULL &&
+		    off + sizeof(struct occ_sensor_record) <=
+		    OCC_READING_BUFFER_SIZE) {
+			const struct occ_sensor_record *r = (const void *)(copy + off);
+
+			printf("%-16s %12.3f %-4s (min %.3f max %.3f)\n", name,
+			       scale(&md[i], be16_to_cpu(r->sample)), units,
+			       scale(&md[i], be16_to_cpu(r->sample_min)),
+			       scale(&md[i], be16_to_cpu(r->sample_max)));
+		} else if (md[i].structure_type == OCC_SENSOR_READING_COUNTER &&
+			   off + sizeof(struct occ_sensor_counter) <=
+			   OCC_READING_BUFFER_SIZE) {
+			const struct occ_sensor_counter *c = (const void *)(copy + off);
+
+			printf("%-16s %12u      (count %" PRIu64 ")\n", name,
+			       c->sample, be64_to_cpu(c->accumulator));
+		}
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [-f file] [-o occ]\n", prog);
+	fprintf(stderr, "  -f file   sensor area (default %s)\n", DEFAULT_PATH);
+	fprintf(stderr, "  -o occ    only print this OCC\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = DEFAULT_PATH;
+	int fd, opt, occ, nr_occs, only = -1, rc = 0;
+	struct stat st;
+	u8 *area, *copy;
+	bool mapped = true;
+
+	while ((opt = getopt(argc, argv, "f:o:h")) != -1) {
+		switch (opt) {
+		case 'f':
+			path = optarg;
+			break;
+		case 'o':
+			only = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		err(1, "Opening %s", path);
+
+	if (fstat(fd, &st) < 0)
+		err(1, "Stat %s", path);
+
+	nr_occs = st.st_size / OCC_SENSOR_DATA_BLOCK_SIZE;
+	if (!nr_occs)
+		errx(1, "%s: too small for an OCC sensor block", path);
+
+	area = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (area == MAP_FAILED) {
+		/* Older kernels can't mmap exports, take a single copy */
+		mapped = false;
+		area = malloc(st.st_size);
+		if (!area)
+			err(1, "Allocating %lld bytes", (long long)st.st_size);
+		if (pread(fd, area, st.st_size, 0) != st.st_size)
+			err(1, "Reading %s", path);
+	}
+
+	copy = malloc(OCC_READING_BUFFER_SIZE);
+	if (!copy)
+		err(1, "Allocating snapshot buffer");
+
+	for (occ = 0; occ < nr_occs; occ++) {
+		const u8 *block = area + occ * OCC_SENSOR_DATA_BLOCK_SIZE;
+		const struct occ_sensor_data_header *hb = (const void *)block;
+		const struct occ_sensor_name *md;
+		u64 tb;
+
+		if (only >= 0 && occ != only)
+			continue;
+
+		if (!check_header(hb, occ)) {
+			rc = 1;
+			continue;
+		}
+
+		md = (const void *)(block + be32_to_cpu(hb->names_offset));
+
+		if (!snapshot(block, hb, md, copy, &tb)) {
+			warnx("OCC %d: no consistent readings buffer", occ);
+			rc = 1;
+			continue;
+		}
+
+		printf("OCC %d: %d sensors, timestamp 0x%016" PRIx64 "\n",
+		       occ, be16_to_cpu(hb->nr_sensors), tb);
+		print_sensors(hb, md, copy);
+	}
+
+	free(copy);
+	if (mapped)
+		munmap(area, st.st_size);
+	else
+		free(area);
+	close(fd);
+
+	return rc;
+}
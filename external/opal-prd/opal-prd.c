@@ -91,6 +91,10 @@ struct opal_prd_ctx {
 	struct opal_prd_msg	*msg;
 	size_t			msg_alloc_len;
 	void			(*vlog)(int, const char *, va_list);
+	/* SCOMs made by HBRT, counted per attention */
+	unsigned int		scom_reads;
+	unsigned int		scom_writes;
+	uint64_t		scom_ns;
 };
 
 enum control_msg_type {
@@ -353,15 +357,27 @@ void *hservice_realloc(void *ptr, size_t size)
 	return realloc(ptr, size);
 }
 
+static uint64_t time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
 int hservice_scom_read(uint64_t chip_id, uint64_t addr, void *buf)
 {
 	int rc;
 	struct opal_prd_scom scom;
+	uint64_t start;
 
 	scom.chip = chip_id;
 	scom.addr = addr;
 
+	start = time_ns();
 	rc = ioctl(ctx->fd, OPAL_PRD_SCOM_READ, &scom);
+	ctx->scom_ns += time_ns() - start;
+	ctx->scom_reads++;
 	if (rc) {
 		pr_log(LOG_ERR, "SCOM: ioctl read(chip 0x%lx, addr 0x%lx) "
 				"failed: %m", chip_id, addr);
@@ -382,12 +398,16 @@ int hservice_scom_write(uint64_t chip_id, uint64_t addr,
 {
 	int rc;
 	struct opal_prd_scom scom;
+	uint64_t start;
 
 	scom.chip = chip_id;
 	scom.addr = addr;
 	scom.data = be64toh(*(uint64_t *)buf);
 
+	start = time_ns();
 	rc = ioctl(ctx->fd, OPAL_PRD_SCOM_WRITE, &scom);
+	ctx->scom_ns += time_ns() - start;
+	ctx->scom_writes++;
 	if (rc) {
 		pr_log(LOG_ERR, "SCOM: ioctl write(chip 0x%lx, addr 0x%lx) "
 				"failed: %m", chip_id, addr);
@@ -1376,7 +1396,7 @@ static int prd_init(struct opal_prd_ctx *ctx)
 
 static int handle_msg_attn(struct opal_prd_ctx *ctx, struct opal_prd_msg *msg)
 {
-	uint64_t proc, ipoll_mask, ipoll_status;
+	uint64_t proc, ipoll_mask, ipoll_status, start;
 	int rc;
 
 	proc = be64toh(msg->attn.proc);
@@ -1388,7 +1408,17 @@ static int handle_msg_attn(struct opal_prd_ctx *ctx, struct opal_prd_msg *msg)
 		return -1;
 	}
 
+	ctx->scom_reads = ctx->scom_writes = 0;
+	ctx->scom_ns = 0;
+	start = time_ns();
+
 	rc = call_handle_attns(proc, ipoll_status, ipoll_mask);
+
+	pr_log(LOG_INFO, "HBRT: handle_attns(%lx) took %lu us, "
+			"%u SCOM reads, %u writes, %lu us in SCOMs",
+			proc, (time_ns() - start) / 1000,
+			ctx->scom_reads, ctx->scom_writes,
+			ctx->scom_ns / 1000);
 	if (rc) {
 		pr_log(LOG_ERR, "HBRT: handle_attns(%lx,%lx,%lx) failed, rc %d",
 				proc, ipoll_status, ipoll_mask, rc);
@@ -0,0 +1,423 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Reader for the OPAL call profile exported by skiboot when the
+ * "opal-profile" NVRAM option is set.
+ *
+ * Reads /sys/firmware/opal/exports/opal_call_profile (or a copy of it)
+ * and prints the number of calls and their latency per OPAL token,
+ * summed over all the CPUs, or as a CSV per CPU. Given skiboot.map, it
+ * also symbolizes the wait samples, either as a list of the functions
+ * OPAL calls wait in, or as folded stacks for flamegraph.pl. The
+ * layout is the one described in skiboot's include/opal-profile.h; it
+ * is big endian.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "../../ccan/endian/endian.h"
+#include "../../ccan/short_types/short_types.h"
+
+#define DEFAULT_PATH	"/sys/firmware/opal/exports/opal_call_profile"
+
+#define OPAL_PROFILE_MAGIC	0x4f50524f
+#define OPAL_PROFILE_VERSION	1
+#define OPAL_PROFILE_BT_DEPTH	6
+#define OPAL_PROFILE_WAITS	0x2
+
+struct opal_profile_header {
+	be32 magic;
+	be16 version;
+	be16 mode;
+	be32 nr_cpus;
+	be32 nr_tokens;
+	be32 nr_samples;
+	be32 cpu_offset;
+	be32 cpu_size;
+	be32 reserved;
+	be64 tb_hz;
+	be64 skiboot_base;
+} __attribute__((__packed__));
+
+struct opal_call_stat {
+	be64 count;
+	be64 total_tb;
+	be64 max_tb;
+} __attribute__((__packed__));
+
+struct opal_profile_sample {
+	be64 tb;
+	be64 wait_tb;
+	be64 token;
+	be64 pc[OPAL_PROFILE_BT_DEPTH];
+} __attribute__((__packed__));
+
+struct opal_profile_cpu {
+	be32 pir;
+	be32 sample_count;
+	struct opal_call_stat calls[];
+} __attribute__((__packed__));
+
+static const struct opal_profile_header *hdr;
+static size_t area_size;
+static unsigned int nr_cpus, nr_tokens, nr_samples, cpu_offset, cpu_size;
+static u64 tb_hz, skiboot_base;
+
+struct symbol {
+	u64 addr;
+	char *name;
+};
+
+static struct symbol *symbols;
+static unsigned int nr_symbols;
+
+static double tb_to_us(u64 tb)
+{
+	return (double)tb * 1000000 / tb_hz;
+}
+
+static const struct opal_profile_cpu *get_cpu(unsigned int i)
+{
+	return (const void *)hdr + cpu_offset + i * cpu_size;
+}
+
+static const struct opal_profile_sample *get_samples(
+					const struct opal_profile_cpu *cpu)
+{
+	return (const void *)&cpu->calls[nr_tokens];
+}
+
+static void load(const char *path)
+{
+	struct stat st;
+	void *area;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		err(1, "Opening %s", path);
+	if (fstat(fd, &st) < 0)
+		err(1, "Stat %s", path);
+	area_size = st.st_size;
+	if (area_size < sizeof(*hdr))
+		errx(1, "%s: too small for an OPAL profile", path);
+
+	/* One copy, so the CPUs keep updating their own tables meanwhile */
+	area = malloc(area_size);
+	if (!area)
+		err(1, "Allocating %zu bytes", area_size);
+	if (pread(fd, area, area_size, 0) != (ssize_t)area_size)
+		err(1, "Reading %s", path);
+	close(fd);
+
+	hdr = area;
+	if (be32_to_cpu(hdr->magic) != OPAL_PROFILE_MAGIC ||
+	    be16_to_cpu(hdr->version) != OPAL_PROFILE_VERSION)
+		errx(1, "%s: unsupported OPAL profile layout", path);
+
+	nr_cpus = be32_to_cpu(hdr->nr_cpus);
+	nr_tokens = be32_to_cpu(hdr->nr_tokens);
+	nr_samples = be32_to_cpu(hdr->nr_samples);
+	cpu_offset = be32_to_cpu(hdr->cpu_offset);
+	cpu_size = be32_to_cpu(hdr->cpu_size);
+	tb_hz = be64_to_cpu(hdr->tb_hz);
+	skiboot_base = be64_to_cpu(hdr->skiboot_base);
+
+	if (!tb_hz || cpu_size < sizeof(struct opal_profile_cpu) +
+	    nr_tokens * sizeof(struct opal_call_stat) +
+	    nr_samples * sizeof(struct opal_profile_sample) ||
+	    cpu_offset < sizeof(*hdr) ||
+	    cpu_offset + (size_t)nr_cpus * cpu_size > area_size)
+		errx(1, "%s: corrupted OPAL profile header", path);
+}
+
+static void print_calls(void)
+{
+	unsigned int i, t;
+	u64 grand_total = 0;
+
+	printf("%5s %10s %12s %10s %10s %6s\n", "token", "calls",
+	       "total(ms)", "avg(us)", "max(us)", "share");
+
+	for (t = 0; t < nr_tokens; t++)
+		for (i = 0; i < nr_cpus; i++)
+			grand_total += be64_to_cpu(get_cpu(i)->calls[t].total_tb);
+
+	for (t = 0; t < nr_tokens; t++) {
+		u64 count = 0, total = 0, max = 0;
+
+		for (i = 0; i < nr_cpus; i++) {
+			const struct opal_call_stat *s = &get_cpu(i)->calls[t];
+
+			count += be64_to_cpu(s->count);
+			total += be64_to_cpu(s->total_tb);
+			if (be64_to_cpu(s->max_tb) > max)
+				max = be64_to_cpu(s->max_tb);
+		}
+		if (!count)
+			continue;
+
+		printf("%5u %10" PRIu64 " %12.3f %10.3f %10.3f %5.1f%%\n", t,
+		       count, tb_to_us(total) / 1000, tb_to_us(total) / count,
+		       tb_to_us(max),
+		       grand_total ? 100.0 * total / grand_total : 0.0);
+	}
+}
+
+static void print_csv(void)
+{
+	unsigned int i, t;
+
+	printf("pir,token,calls,total_us,max_us\n");
+	for (i = 0; i < nr_cpus; i++) {
+		const struct opal_profile_cpu *cpu = get_cpu(i);
+
+		for (t = 0; t < nr_tokens; t++) {
+			const struct opal_call_stat *s = &cpu->calls[t];
+
+			if (!s->count)
+				continue;
+			printf("0x%x,%u,%" PRIu64 ",%.3f,%.3f\n",
+			       be32_to_cpu(cpu->pir), t, be64_to_cpu(s->count),
+			       tb_to_us(be64_to_cpu(s->total_tb)),
+			       tb_to_us(be64_to_cpu(s->max_tb)));
+		}
+	}
+}
+
+/* skiboot.map is "nm -n" output, addresses relative to skiboot_base */
+static void load_map(const char *path)
+{
+	unsigned int room = 0;
+	char line[512], name[256], type;
+	unsigned long long addr;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f)
+		err(1, "Opening %s", path);
+
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%llx %c %255s", &addr, &type, name) != 3)
+			continue;
+		if (nr_symbols == room) {
+			room = room ? room * 2 : 1024;
+			symbols = realloc(symbols, room * sizeof(*symbols));
+			if (!symbols)
+				err(1, "Allocating symbols");
+		}
+		symbols[nr_symbols].addr = addr | skiboot_base;
+		symbols[nr_symbols].name = strdup(name);
+		nr_symbols++;
+	}
+	fclose(f);
+
+	if (!nr_symbols)
+		errx(1, "%s: no symbols", path);
+}
+
+static const char *lookup(u64 pc)
+{
+	unsigned int lo = 0, hi = nr_symbols;
+
+	if (!pc || pc < symbols[0].addr)
+		return NULL;
+
+	/* Last symbol at or below pc */
+	while (hi - lo > 1) {
+		unsigned int mid = (lo + hi) / 2;
+
+		if (symbols[mid].addr <= pc)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return symbols[lo].name;
+}
+
+/* The samples are taken in there, the interesting part is the caller */
+static bool is_wait_helper(const char *sym)
+{
+	return !strncmp(sym, "time_wait", 9) || !strcmp(sym, "nanosleep") ||
+		!strcmp(sym, "nanosleep_nopoll");
+}
+
+struct wait_site {
+	const char *sym;
+	u64 token;
+	unsigned int count;
+	u64 wait_tb;
+};
+
+static int cmp_site(const void *a, const void *b)
+{
+	const struct wait_site *sa = a, *sb = b;
+
+	if (sa->wait_tb != sb->wait_tb)
+		return sa->wait_tb > sb->wait_tb ? -1 : 1;
+	return 0;
+}
+
+/* Calls fn on each valid sample still in the rings */
+static void for_each_sample(void (*fn)(const struct opal_profile_sample *))
+{
+	unsigned int i, n, count;
+
+	for (i = 0; i < nr_cpus; i++) {
+		const struct opal_profile_cpu *cpu = get_cpu(i);
+		const struct opal_profile_sample *smp = get_samples(cpu);
+
+		count = be32_to_cpu(cpu->sample_count);
+		if (count > nr_samples)
+			count = nr_samples;
+		for (n = 0; n < count; n++)
+			fn(&smp[n]);
+	}
+}
+
+static struct wait_site *sites;
+static unsigned int nr_sites;
+
+static void add_site(const struct opal_profile_sample *smp)
+{
+	const char *sym = NULL;
+	unsigned int i;
+	u64 token = be64_to_cpu(smp->token);
+
+	for (i = 0; i < OPAL_PROFILE_BT_DEPTH; i++) {
+		sym = lookup(be64_to_cpu(smp->pc[i]));
+		if (sym && !is_wait_helper(sym))
+			break;
+	}
+	if (!sym)
+		sym = "?";
+
+	for (i = 0; i < nr_sites; i++)
+		if (sites[i].token == token && !strcmp(sites[i].sym, sym))
+			break;
+	if (i == nr_sites) {
+		nr_sites++;
+		sites[i].sym = sym;
+		sites[i].token = token;
+	}
+	sites[i].count++;
+	sites[i].wait_tb += be64_to_cpu(smp->wait_tb);
+}
+
+static void print_waits(void)
+{
+	unsigned int i;
+
+	sites = calloc((size_t)nr_cpus * nr_samples + 1, sizeof(*sites));
+	if (!sites)
+		err(1, "Allocating wait sites");
+	for_each_sample(add_site);
+	qsort(sites, nr_sites, sizeof(*sites), cmp_site);
+
+	printf("\n%5s %8s %12s  %s\n", "token", "samples", "waited(ms)",
+	       "waiting in");
+	for (i = 0; i < nr_sites; i++)
+		printf("%5" PRIu64 " %8u %12.3f  %s\n", sites[i].token,
+		       sites[i].count, tb_to_us(sites[i].wait_tb) / 1000,
+		       sites[i].sym);
+	free(sites);
+}
+
+/* "opal_<token>;outer;...;inner wait_us", outermost frame first */
+static void print_folded_sample(const struct opal_profile_sample *smp)
+{
+	const char *sym;
+	int i;
+
+	printf("opal_%" PRIu64, be64_to_cpu(smp->token));
+	for (i = OPAL_PROFILE_BT_DEPTH - 1; i >= 0; i--) {
+		sym = lookup(be64_to_cpu(smp->pc[i]));
+		if (sym)
+			printf(";%s", sym);
+	}
+	printf(" %.0f\n", tb_to_us(be64_to_cpu(smp->wait_tb)));
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [-f file] [-c] [-m skiboot.map [-g]]\n",
+		prog);
+	fprintf(stderr, "  -f file   profile (default %s)\n", DEFAULT_PATH);
+	fprintf(stderr, "  -c        CSV of the calls per CPU\n");
+	fprintf(stderr, "  -m map    symbolize the wait samples\n");
+	fprintf(stderr, "  -g        wait samples as folded stacks, for "
+		"flamegraph.pl\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = DEFAULT_PATH, *map = NULL;
+	bool csv = false, folded = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:cm:gh")) != -1) {
+		switch (opt) {
+		case 'f':
+			path = optarg;
+			break;
+		case 'c':
+			csv = true;
+			break;
+		case 'm':
+			map = optarg;
+			break;
+		case 'g':
+			folded = true;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (folded && !map)
+		usage(argv[0]);
+
+	load(path);
+	if (map) {
+		if (!(be16_to_cpu(hdr->mode) & OPAL_PROFILE_WAITS))
+			errx(1, "No wait samples, set opal-profile=waits");
+		load_map(map);
+	}
+
+	if (folded)
+		for_each_sample(print_folded_sample);
+	else if (csv)
+		print_csv();
+	else
+		print_calls();
+
+	if (map && !folded && !csv)
+		print_waits();
+
+	free((void *)hdr);
+	return 0;
+}
@@ -602,12 +602,24 @@ static int bt_del_ipmi_msg(struct ipmi_msg *ipmi_msg)
 	return 0;
 }
 
+/*
+ * The input buffer length the BMC gave us counts the length byte and
+ * the netfn, seq and cmd bytes that go ahead of the data.
+ */
+static size_t bt_max_req_size(void)
+{
+	if (bt.caps.input_buf_len <= 1 + BT_MIN_REQ_LEN)
+		return 0;
+	return bt.caps.input_buf_len - 1 - BT_MIN_REQ_LEN;
+}
+
 static struct ipmi_backend bt_backend = {
 	.alloc_msg = bt_alloc_ipmi_msg,
 	.free_msg = bt_free_ipmi_msg,
 	.queue_msg = bt_add_ipmi_msg,
 	.queue_msg_head = bt_add_ipmi_msg_head,
 	.dequeue_msg = bt_del_ipmi_msg,
+	.max_req_size = bt_max_req_size,
 };
 
 static struct lpc_client bt_lpc_client = {
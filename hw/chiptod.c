@@ -253,6 +253,51 @@ static void chiptod_cache_tod_registers(void)
 		_chiptod_cache_tod_regs(chip->id);
 }
 
+static void chiptod_cache_tod_regs_job(void *data)
+{
+	struct proc_chip *chip = data;
+
+	_chiptod_cache_tod_regs(chip->id);
+}
+
+/*
+ * Boot time version of chiptod_cache_tod_registers(), with the chips
+ * read by chip local jobs. The runtime callers hold chiptod_lock and
+ * may be in HMI context, so they keep using the serial version.
+ */
+static void chiptod_cache_tod_registers_parallel(void)
+{
+	struct proc_chip *chip;
+	struct cpu_job **jobs;
+	unsigned int i = 0;
+
+	for_each_chip(chip)
+		i++;
+
+	jobs = zalloc(i * sizeof(*jobs));
+	if (!jobs) {
+		chiptod_cache_tod_registers();
+		return;
+	}
+
+	i = 0;
+	for_each_chip(chip) {
+		jobs[i] = cpu_queue_job_on_node(chip->id, "chiptod_cache_regs",
+						chiptod_cache_tod_regs_job,
+						chip);
+		if (!jobs[i])
+			jobs[i] = cpu_queue_job(NULL, "chiptod_cache_regs",
+						chiptod_cache_tod_regs_job,
+						chip);
+		assert(jobs[i]);
+		i++;
+	}
+	cpu_process_local_jobs();
+	while (i--)
+		cpu_wait_job(jobs[i], true);
+	free(jobs);
+}
+
 static void print_topo_info(enum chiptod_topology topo)
 {
 	const char *role[] = { "Unknown", "MDMT", "MDST", "SDMT", "SDST" };
@@ -1739,13 +1784,134 @@ static void chiptod_init_topology_info(void)
 	chiptod_update_topology(chiptod_topo_secondary);
 
 	/* Cache TOD control registers values. */
-	chiptod_cache_tod_registers();
+	chiptod_cache_tod_registers_parallel();
 	print_topology_info();
 }
 
+struct chiptod_sync_job {
+	struct cpu_thread	*cpu;
+	unsigned int		wave;
+	bool			result;
+};
+
+/*
+ * Slave sync of every CPU but the master.
+ *
+ * chiptod_to_tb() goes through the chip wide PIB_MASTER register, so the
+ * cores of a chip have to be synced one after the other, but chips are
+ * independent. Each wave thus syncs the next core of every chip, along
+ * with the secondary threads of the cores synced by the previous wave
+ * (those only clean up their TFMR, after their primary got the TB).
+ */
+static unsigned int chiptod_sync_slaves(struct cpu_thread *master)
+{
+	int next_wave[MAX_CHIPS] = { 0 };
+	int core_wave[MAX_CHIPS];
+	struct chiptod_sync_job *sj;
+	struct cpu_job **jobs;
+	struct cpu_thread *cpu;
+	unsigned int i, n = 0, count = 0, wave, waves = 0;
+
+	for_each_available_cpu(cpu)
+		count++;
+
+	sj = zalloc(count * sizeof(*sj));
+	jobs = zalloc(count * sizeof(*jobs));
+	assert(sj && jobs);
+
+	/*
+	 * Threads of a core with no earlier wave, like the master's
+	 * siblings, can go in the first one
+	 */
+	for (i = 0; i < MAX_CHIPS; i++)
+		core_wave[i] = -1;
+
+	for_each_available_cpu(cpu) {
+		uint32_t chip_id = cpu->chip_id;
+
+		assert(chip_id < MAX_CHIPS);
+		if (cpu == master)
+			continue;
+
+		sj[n].cpu = cpu;
+		if (cpu->is_secondary) {
+			/* Threads follow their primary in PIR order */
+			sj[n].wave = core_wave[chip_id] + 1;
+		} else {
+			core_wave[chip_id] = next_wave[chip_id]++;
+			sj[n].wave = core_wave[chip_id];
+		}
+		if (sj[n].wave + 1 > waves)
+			waves = sj[n].wave + 1;
+		n++;
+	}
+
+	for (wave = 0; wave < waves; wave++) {
+		unsigned int queued = 0;
+
+		for (i = 0; i < n; i++) {
+			/* Skip threads of cores disabled by a failed sync */
+			if (sj[i].wave != wave || !cpu_is_available(sj[i].cpu))
+				continue;
+			jobs[queued++] = cpu_queue_job(sj[i].cpu,
+						       "chiptod_sync_slave",
+						       chiptod_sync_slave,
+						       &sj[i].result);
+		}
+		for (i = 0; i < queued; i++)
+			cpu_wait_job(jobs[i], true);
+
+		for (i = 0; i < n; i++) {
+			cpu = sj[i].cpu;
+			if (sj[i].wave != wave || !cpu_is_available(cpu))
+				continue;
+			if (!sj[i].result) {
+				op_display(OP_WARN, OP_MOD_CHIPTOD,
+					   3|(cpu->pir << 8));
+
+				/* Disable threads */
+				cpu_disable_all_threads(cpu);
+			}
+			op_display(OP_LOG, OP_MOD_CHIPTOD, 3|(cpu->pir << 8));
+		}
+	}
+
+	free(jobs);
+	free(sj);
+
+	return waves;
+}
+
+static void chiptod_print_tbs(void)
+{
+	struct cpu_thread *cpu;
+	struct cpu_job **jobs;
+	unsigned int count = 0;
+
+	for_each_available_cpu(cpu)
+		count++;
+
+	jobs = zalloc(count * sizeof(*jobs));
+	assert(jobs);
+
+	count = 0;
+	for_each_available_cpu(cpu) {
+		/* Only do primaries, not threads */
+		if (cpu->is_secondary)
+			continue;
+		jobs[count++] = cpu_queue_job(cpu, "chiptod_print_tb",
+					      chiptod_print_tb, NULL);
+	}
+	while (count--)
+		cpu_wait_job(jobs[count], true);
+	free(jobs);
+}
+
 void chiptod_init(void)
 {
-	struct cpu_thread *cpu0, *cpu;
+	struct cpu_thread *cpu0;
+	unsigned long start, t_master, t_slaves, t_print;
+	unsigned int waves;
 	bool sres;
 
 	/* Mambo and qemu doesn't simulate the chiptod */
@@ -1771,6 +1937,7 @@ void chiptod_init(void)
 	prlog(PR_DEBUG, "Base TFMR=0x%016llx\n", base_tfmr);
 
 	/* Schedule master sync */
+	start = mftb();
 	sres = false;
 	cpu_wait_job(cpu_queue_job(cpu0, "chiptod_sync_master",
 				   chiptod_sync_master, &sres), true);
@@ -1778,40 +1945,26 @@ void chiptod_init(void)
 		op_display(OP_FATAL, OP_MOD_CHIPTOD, 2);
 		abort();
 	}
+	t_master = mftb();
 
 	op_display(OP_LOG, OP_MOD_CHIPTOD, 2);
 
-	/* Schedule slave sync */
-	for_each_available_cpu(cpu) {
-		/* Skip master */
-		if (cpu == cpu0)
-			continue;
-
-		/* Queue job */
-		sres = false;
-		cpu_wait_job(cpu_queue_job(cpu, "chiptod_sync_slave",
-					   chiptod_sync_slave, &sres),
-			     true);
-		if (!sres) {
-			op_display(OP_WARN, OP_MOD_CHIPTOD, 3|(cpu->pir << 8));
-
-			/* Disable threads */
-			cpu_disable_all_threads(cpu);
-		}
-		op_display(OP_LOG, OP_MOD_CHIPTOD, 3|(cpu->pir << 8));
-	}
+	/* Schedule slave sync, only once the master is done */
+	waves = chiptod_sync_slaves(cpu0);
+	t_slaves = mftb();
 
 	/* Display TBs */
-	for_each_available_cpu(cpu) {
-		/* Only do primaries, not threads */
-		if (cpu->is_secondary)
-			continue;
-		cpu_wait_job(cpu_queue_job(cpu, "chiptod_print_tb",
-					   chiptod_print_tb, NULL), true);
-	}
+	chiptod_print_tbs();
+	t_print = mftb();
 
 	chiptod_init_topology_info();
 	op_display(OP_LOG, OP_MOD_CHIPTOD, 4);
+
+	prlog(PR_INFO, "CHIPTOD: Master sync %lu us, slave sync %lu us"
+	      " (%u waves), TB print %lu us, topology %lu us\n",
+	      tb_to_usecs(t_master - start), tb_to_usecs(t_slaves - t_master),
+	      waves, tb_to_usecs(t_print - t_slaves),
+	      tb_to_usecs(mftb() - t_print));
 }
 
 /* CAPP timebase sync */
@@ -24,6 +24,7 @@
 #include <errorlog.h>
 #include <opal-api.h>
 #include <timebase.h>
+#include <cpu.h>
 
 #include "fsp-codeupdate.h"
 
@@ -41,12 +42,26 @@ enum lid_fetch_side {
 	FETCH_BOTH_SIDE,
 };
 
+/*
+ * A LID being written. Up to two are in flight: while the FSP writes
+ * one, the next one is mapped next to it.
+ */
+struct cupd_lid {
+	uint32_t	id;
+	uint32_t	size;
+	uint32_t	offset;		/* In the image */
+	uint32_t	tce_off;	/* Mapping in PSI_DMA_CODE_UPD */
+	uint32_t	tce_size;
+	uint32_t	tce_start;	/* DMA address of the LID data */
+	struct fsp_msg	*msg;
+	uint64_t	write_tb;
+};
+
 static enum flash_state flash_state = FLASH_STATE_INVALID;
 static enum lid_fetch_side lid_fetch_side = FETCH_BOTH_SIDE;
 
 /* Image buffers */
 static struct opal_sg_list *image_data;
-static uint32_t tce_start;
 static void *lid_data;
 static char validate_buf[VALIDATE_BUF_SIZE];
 
@@ -101,9 +116,9 @@ static inline void code_update_tce_map(uint32_t tce_offset,
 	fsp_tce_map(PSI_DMA_CODE_UPD + tce_offset, buffer, tlen);
 }
 
-static inline void code_update_tce_unmap(uint32_t size)
+static inline void code_update_tce_unmap(uint32_t tce_offset, uint32_t size)
 {
-	fsp_tce_unmap(PSI_DMA_CODE_UPD, size);
+	fsp_tce_unmap(PSI_DMA_CODE_UPD + tce_offset, size);
 }
 
 static inline void set_def_fw_version(uint32_t side)
@@ -390,7 +405,7 @@ static void fetch_lid_data_complete(struct fsp_msg *msg)
 	/* Validate marker LID data */
 	validate_com_marker_lid();
 	/* TCE unmap */
-	code_update_tce_unmap(MARKER_LID_SIZE);
+	code_update_tce_unmap(0, MARKER_LID_SIZE);
 
 	unlock(&flash_lock);
 }
@@ -524,24 +539,55 @@ static int code_update_start(void)
 	return rc;
 }
 
-static int code_update_write_lid(uint32_t lid_id, uint32_t size)
+/*
+ * Queue the write of a LID, without waiting for it, so that we can
+ * prepare the next LID meanwhile. The FSP driver sends the writes one
+ * at a time, in order.
+ */
+static int code_update_write_lid(struct cupd_lid *lid)
 {
-	struct fsp_msg *msg;
-	int rc, n_pairs = 1;
+	int n_pairs = 1;
 
-	msg = fsp_mkmsg(FSP_CMD_FLASH_WRITE, 5, lid_id,
-			n_pairs, 0, tce_start, size);
-	if (!msg) {
+	lid->msg = fsp_mkmsg(FSP_CMD_FLASH_WRITE, 5, lid->id,
+			     n_pairs, 0, lid->tce_start, lid->size);
+	if (!lid->msg) {
 		log_simple_error(&e_info(OPAL_RC_CU_MSG),
 			"CUPD: CMD_FLASH_WRITE message allocation failed !\n");
 		return OPAL_INTERNAL_ERROR;
 	}
-	if (fsp_sync_msg(msg, false)) {
-		fsp_freemsg(msg);
+	lid->write_tb = mftb();
+	if (fsp_queue_msg(lid->msg, NULL)) {
+		fsp_freemsg(lid->msg);
+		lid->msg = NULL;
 		return OPAL_INTERNAL_ERROR;
 	}
-	rc = (msg->resp->word1 >> 8) & 0xff;
+	return OPAL_SUCCESS;
+}
+
+/* Wait for a LID write queued by code_update_write_lid() */
+static int code_update_wait_lid(struct cupd_lid *lid)
+{
+	static uint64_t last_done_tb;
+	struct fsp_msg *msg = lid->msg;
+	int rc = OPAL_INTERNAL_ERROR;
+
+	while (fsp_msg_busy(msg)) {
+		if (fsp_in_rr()) {
+			fsp_cancelmsg(msg);
+			goto out;
+		}
+		cpu_relax();
+		opal_run_pollers();
+	}
+	/* The FSP only started on it once done with the previous one */
+	lid->write_tb = mftb() - MAX(lid->write_tb, last_done_tb);
+	last_done_tb = mftb();
+
+	if (msg->state == fsp_msg_done && msg->resp)
+		rc = (msg->resp->word1 >> 8) & 0xff;
+ out:
 	fsp_freemsg(msg);
+	lid->msg = NULL;
 	return rc;
 }
 
@@ -855,25 +901,22 @@ static int validate_out_buf_ml_data(void *buffer, int offset, uint32_t result)
 }
 
 /*
- * Copy LID data to TCE buffer
+ * Map the LID data to the TCE space at lid->tce_off
  */
-static int get_lid_data(struct opal_sg_list *list,
-			int lid_size, int lid_offset)
+static int get_lid_data(struct opal_sg_list *list, struct cupd_lid *lid)
 {
 	struct opal_sg_list *sg;
 	struct opal_sg_entry *entry;
-	int length, num_entries, i, buf_pos = 0;
+	int length, num_entries, i, buf_pos = lid->tce_off;
+	int lid_size = lid->size, lid_offset = lid->offset;
 	int map_act, map_size;
-	bool last = false;
-
-	/* Reset TCE start address */
-	tce_start = 0;
+	bool first = true, last = false;
 
 	for (sg = list; sg; sg = (struct opal_sg_list*)be64_to_cpu(sg->next)) {
 		length = (be64_to_cpu(sg->length) & ~(SG_LIST_VERSION << 56)) - 16;
 		num_entries = length / sizeof(struct opal_sg_entry);
 		if (num_entries <= 0)
-			return -1;
+			goto fail;
 
 		for (i = 0; i < num_entries; i++) {
 			entry = &sg->entry[i];
@@ -882,7 +925,7 @@ static int get_lid_data(struct opal_sg_list *list,
 			 * Continue until we get data block which
 			 * contains LID data
 			 */
-			if (lid_offset > be64_to_cpu(entry->length)) {
+			if (lid_offset >= be64_to_cpu(entry->length)) {
 				lid_offset -= be64_to_cpu(entry->length);
 				continue;
 			}
@@ -896,12 +939,13 @@ static int get_lid_data(struct opal_sg_list *list,
 			map_size = be64_to_cpu(entry->length);
 
 			/* First TCE mapping */
-			if (!tce_start) {
-				tce_start = PSI_DMA_CODE_UPD +
+			if (first) {
+				lid->tce_start = PSI_DMA_CODE_UPD + buf_pos +
 						(lid_offset & 0xfff);
 				map_act = be64_to_cpu(entry->length) - lid_offset;
 				lid_offset &= ~0xfff;
 				map_size = be64_to_cpu(entry->length) - lid_offset;
+				first = false;
 			}
 
 			/* Check pending LID size to map */
@@ -927,10 +971,16 @@ static int get_lid_data(struct opal_sg_list *list,
 			/* Reset LID offset count */
 			lid_offset = 0;
 
-			if (last)
+			if (last) {
+				lid->tce_size = ALIGN_UP(buf_pos - lid->tce_off,
+							 TCE_PSIZE);
 				return OPAL_SUCCESS;
+			}
 		}
 	} /* outer loop */
+ fail:
+	code_update_tce_unmap(lid->tce_off,
+			      ALIGN_UP(buf_pos - lid->tce_off, TCE_PSIZE));
 	return -1;
 }
 
@@ -1005,13 +1055,114 @@ static int64_t fsp_opal_manage_flash(uint8_t op)
 	return code_update_commit(cmd);
 }
 
+/* Wait for the write of a LID and release its TCEs */
+static int code_update_finish_lid(struct cupd_lid *lid)
+{
+	int rc;
+
+	rc = code_update_wait_lid(lid);
+	code_update_tce_unmap(lid->tce_off, lid->tce_size);
+	if (rc) {
+		log_simple_error(&e_info(OPAL_RC_CU_FLASH), "CUPD: "
+			"Failed to write LID to FSP. (rc : %d).\n", rc);
+		return rc;
+	}
+
+	prlog(PR_INFO, "CUPD: LID 0x%08x, %u bytes, written in %llu ms\n",
+	      lid->id, lid->size,
+	      (unsigned long long)tb_to_msecs(lid->write_tb));
+	return OPAL_SUCCESS;
+}
+
+/*
+ * Write the LIDs of the image. While the FSP writes a LID, the next
+ * one is mapped in the TCE space left free and its write queued, so that the FSP goes on with it as
+ * soon as it is done with the current one.
+ */
+static int code_update_write_lids(struct opal_sg_list *list,
+				  struct lid_index_entry *idx_entry, int nr_lids)
+{
+	struct cupd_lid lids[2], *lid, *prev = NULL;
+	uint32_t need;
+	int rc = 0, i;
+
+	for (i = 0; i < nr_lids; i++, idx_entry++) {
+		lid = &lids[i & 1];
+		memset(lid, 0, sizeof(*lid));
+		lid->id = be32_to_cpu(idx_entry->id);
+		lid->size = be32_to_cpu(idx_entry->size);
+		lid->offset = be32_to_cpu(idx_entry->offset);
+
+		if (lid->size > LID_MAX_SIZE) {
+			log_simple_error(&e_info(OPAL_RC_CU_FLASH), "CUPD: LID"
+				" (0x%x) size 0x%x is > max LID size (0x%x).\n",
+				 lid->id, lid->size, LID_MAX_SIZE);
+			rc = -1;
+			break;
+		}
+
+		/*
+		 * Map it after the LID being written, or before it, and
+		 * if it doesn't fit either way wait for that LID first.
+		 */
+		need = ALIGN_UP(lid->size + (lid->offset & 0xfff), TCE_PSIZE);
+		if (prev && prev->tce_off + prev->tce_size + need <=
+		    PSI_DMA_CODE_UPD_SIZE) {
+			lid->tce_off = prev->tce_off + prev->tce_size;
+		} else if (prev && need > prev->tce_off) {
+			rc = code_update_finish_lid(prev);
+			prev = NULL;
+			if (rc)
+				break;
+		}
+
+		rc = get_lid_data(list, lid);
+		if (rc) {
+			log_simple_error(&e_info(OPAL_RC_CU_FLASH), "CUPD: "
+				"Failed to parse LID from firmware image."
+				" (rc : %d).\n", rc);
+			break;
+		}
+
+		/* FIXME:
+		 *   At present we depend on FSP to validate CRC for
+		 *   individual LIDs. Calculate and validate individual
+		 *   LID CRC here.
+		 */
+
+		rc = code_update_write_lid(lid);
+		if (rc) {
+			code_update_tce_unmap(lid->tce_off, lid->tce_size);
+			break;
+		}
+
+		if (prev) {
+			rc = code_update_finish_lid(prev);
+			if (rc) {
+				prev = lid;
+				break;
+			}
+		}
+		prev = lid;
+	}
+
+	/* Don't leave the FSP DMAing from a LID we forgot about */
+	if (prev) {
+		if (rc)
+			code_update_finish_lid(prev);
+		else
+			rc = code_update_finish_lid(prev);
+	}
+	return rc;
+}
+
 static int fsp_flash_firmware(void)
 {
 	struct update_image_header *header;
 	struct lid_index_entry *idx_entry;
 	struct opal_sg_list *list;
 	struct opal_sg_entry *entry;
-	int rc, i;
+	int rc;
 
 	/* Make sure no outstanding LID read is in progress */
 	rc = code_update_check_state();
@@ -1026,12 +1177,6 @@ static int fsp_flash_firmware(void)
 	header = (struct update_image_header *)be64_to_cpu(entry->data);
 	idx_entry = (void *)header + be16_to_cpu(header->lid_index_offset);
 
-	/* FIXME:
-	 *   At present we depend on FSP to validate CRC for
-	 *   individual LIDs. Calculate and validate individual
-	 *   LID CRC here.
-	 */
-
 	if (validate_ipl_side() != 0) {
 		log_simple_error(&e_info(OPAL_RC_CU_FLASH), "CUPD: "
 				 "Rename (Swap T and P) failed!\n");
@@ -1066,38 +1211,10 @@ static int fsp_flash_firmware(void)
 	if (rc)
 		prlog(PR_TRACE, "CUPD: Failed to delete LIDs (%d). This is okay, continuing..", rc);
 
-	for (i = 0; i < be16_to_cpu(header->number_lids); i++) {
-		if (be32_to_cpu(idx_entry->size) > LID_MAX_SIZE) {
-			log_simple_error(&e_info(OPAL_RC_CU_FLASH), "CUPD: LID"
-				" (0x%x) size 0x%x is > max LID size (0x%x).\n",
-				 be32_to_cpu(idx_entry->id),
-				 be32_to_cpu(idx_entry->size), LID_MAX_SIZE);
-			goto abort_update;
-		}
-
-		rc = get_lid_data(list, be32_to_cpu(idx_entry->size),
-				  be32_to_cpu(idx_entry->offset));
-		if (rc) {
-			log_simple_error(&e_info(OPAL_RC_CU_FLASH), "CUPD: "
-				"Failed to parse LID from firmware image."
-				" (rc : %d).\n", rc);
-			goto abort_update;
-		}
-
-		rc = code_update_write_lid(be32_to_cpu(idx_entry->id),
-					   be32_to_cpu(idx_entry->size));
-		if (rc) {
-			log_simple_error(&e_info(OPAL_RC_CU_FLASH), "CUPD: "
-				"Failed to write LID to FSP. (rc : %d).\n", rc);
-			goto abort_update;
-		}
-
-		/* Unmap TCE */
-		code_update_tce_unmap(PSI_DMA_CODE_UPD_SIZE);
-
-		/* Next LID index */
-		idx_entry = (void *)idx_entry + sizeof(struct lid_index_entry);
-	}
+	rc = code_update_write_lids(list, idx_entry,
+				    be16_to_cpu(header->number_lids));
+	if (rc)
+		goto abort_update;
 
 	/* Code update completed */
 	rc = code_update_complete(FSP_CMD_FLASH_COMPLETE);
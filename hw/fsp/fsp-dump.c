@@ -42,6 +42,7 @@
 #include <skiboot.h>
 #include <errorlog.h>
 #include <opal-api.h>
+#include <timebase.h>
 
 /*
  * Max outstanding dumps to retrieve
@@ -101,8 +102,17 @@ static enum dump_state dump_state = DUMP_STATE_NONE;
 static struct opal_sg_list *dump_data;
 static struct dump_record *dump_entry;
 static int64_t dump_offset;
+static int64_t fetch_offset;	/* Dump offset at the start of the window */
 static size_t fetch_remain;
 
+/* Progress of the current dump read */
+static struct {
+	uint64_t start_tb;
+	uint32_t fetched;		/* Bytes received */
+	uint32_t requests;		/* Fetch requests sent */
+	uint32_t more_data;		/* Responses the FSP split up */
+} dump_stats;
+
 /* FipS dump retry count */
 static int retry_cnt;
 
@@ -536,6 +546,12 @@ static void dump_read_complete(struct fsp_msg *msg)
 		goto bail;
 	}
 
+	if (status == FSP_STATUS_SUCCESS || status == FSP_STATUS_MORE_DATA) {
+		dump_stats.fetched += length;
+		prlog(PR_DEBUG, "DUMP: ID 0x%x, %u of %u bytes fetched\n",
+		      dump_id, dump_stats.fetched, dump_entry->size);
+	}
+
 	switch (status) {
 	case FSP_STATUS_SUCCESS: /* Fetch next dump block */
 		if (dump_offset < dump_entry->size) {
@@ -549,13 +565,16 @@ static void dump_read_complete(struct fsp_msg *msg)
 		break;
 	case FSP_STATUS_MORE_DATA:	/* More data to read */
 		offset += length;
-		buffer = (void *)PSI_DMA_DUMP_DATA + offset;
+		buffer = (void *)PSI_DMA_DUMP_DATA + offset - fetch_offset;
 		fetch_remain -= length;
+		dump_stats.more_data++;
 
 		rc = fsp_fetch_data_queue(flags, id, dump_id, offset, buffer,
 					  &fetch_remain, dump_read_complete);
-		if (rc == OPAL_SUCCESS)
+		if (rc == OPAL_SUCCESS) {
+			dump_stats.requests++;
 			goto bail;
+		}
 		break;
 	default:
 		break;
@@ -565,7 +584,14 @@ static void dump_read_complete(struct fsp_msg *msg)
 
 	/* Update state */
 	if (compl) {
+		uint64_t ms = tb_to_msecs(mftb() - dump_stats.start_tb);
+		uint64_t kbps = ms ? (dump_stats.fetched / 1024) * 1000 / ms : 0;
+
 		printf("DUMP: Fetch dump success. ID = 0x%x\n", dump_id);
+		prlog(PR_INFO, "DUMP: Fetched %u bytes in %llu ms (%llu KB/s), "
+		      "%u requests, %u split\n", dump_stats.fetched,
+		      (unsigned long long)ms, (unsigned long long)kbps,
+		      dump_stats.requests, dump_stats.more_data);
 		update_dump_state(DUMP_STATE_FETCH);
 	} else {
 		printf("DUMP: Fetch dump partial. ID = 0x%x\n", dump_id);
@@ -598,9 +624,12 @@ static int64_t fsp_dump_read(void)
 	       data_set, dump_entry->id, fetch_remain);
 
 	/* Fetch data */
+	fetch_offset = dump_offset;
 	rc = fsp_fetch_data_queue(flags, data_set, dump_entry->id,
 				  dump_offset, (void *)PSI_DMA_DUMP_DATA,
 				  &fetch_remain, dump_read_complete);
+	if (rc == OPAL_SUCCESS)
+		dump_stats.requests++;
 
 	/* Adjust dump fetch offset */
 	dump_offset += fetch_remain;
@@ -649,6 +678,8 @@ static int64_t fsp_opal_dump_read(uint32_t dump_id,
 	dump_entry = record;
 	dump_data = list;
 	dump_offset = 0;
+	memset(&dump_stats, 0, sizeof(dump_stats));
+	dump_stats.start_tb = mftb();
 	rc = fsp_dump_read();
 	if (rc != OPAL_SUCCESS)
 		goto out;
@@ -68,6 +68,16 @@ static struct list_head  cec_ledq;		/* CEC LED list */
 static struct list_head	 encl_ledq;	/* Enclosure LED list */
 static struct list_head  spcn_cmdq;	/* SPCN command queue */
 
+/*
+ * Both lists are also hashed by location code. Enclosure location
+ * codes have no '-', and the descendants of an enclosure are the
+ * location codes that start with the enclosure's and a '-'.
+ */
+#define LED_HASH_SIZE	1024
+
+static struct list_head	cec_led_hash[LED_HASH_SIZE];
+static struct list_head	encl_led_hash[LED_HASH_SIZE];
+
 /* LED lock */
 static struct lock led_lock = LOCK_UNLOCKED;
 static struct lock spcn_cmd_lock = LOCK_UNLOCKED;
@@ -110,82 +120,118 @@ DEFINE_LOG_ENTRY(OPAL_RC_LED_SUPPORT, OPAL_PLATFORM_ERR_EVT, OPAL_LED,
 		OPAL_PLATFORM_FIRMWARE, OPAL_INFO, OPAL_NA);
 
 
-/* Find descendent LED record with CEC location code in CEC list */
-static struct fsp_led_data *fsp_find_cec_led(char *loc_code)
+/* FNV-1a of the first len characters of a location code */
+static unsigned int led_hash(const char *loc_code, size_t len)
 {
-	struct fsp_led_data *led, *next;
+	u32 hash = 2166136261u;
 
-	list_for_each_safe(&cec_ledq, led, next, link) {
-		if (strcmp(led->loc_code, loc_code))
-			continue;
-		return led;
+	while (len--) {
+		hash ^= (u8)*loc_code++;
+		hash *= 16777619;
 	}
-	return NULL;
+	return (hash ^ (hash >> 16)) % LED_HASH_SIZE;
 }
 
-/* Find encl LED record with ENCL location code in ENCL list */
-static struct fsp_led_data *fsp_find_encl_led(char *loc_code)
+static void led_hash_init(struct list_head *hash)
 {
-	struct fsp_led_data *led, *next;
+	int i;
 
-	list_for_each_safe(&encl_ledq, led, next, link) {
-		if (strcmp(led->loc_code, loc_code))
-			continue;
-		return led;
+	for (i = 0; i < LED_HASH_SIZE; i++)
+		list_head_init(&hash[i]);
+}
+
+static void led_hash_add(struct list_head *hash, struct fsp_led_data *led)
+{
+	list_add_tail(&hash[led_hash(led->loc_code, strlen(led->loc_code))],
+		      &led->hash_link);
+}
+
+/* First LED whose location code is the first len characters of loc_code */
+static struct fsp_led_data *led_hash_find(struct list_head *hash,
+					  const char *loc_code, size_t len)
+{
+	struct fsp_led_data *led;
+
+	if (len >= LOC_CODE_SIZE)
+		return NULL;
+
+	list_for_each(&hash[led_hash(loc_code, len)], led, hash_link) {
+		if (!strncmp(led->loc_code, loc_code, len) &&
+		    led->loc_code[len] == '\0')
+			return led;
 	}
 	return NULL;
 }
 
+/* Length of the enclosure part of a location code */
+static size_t encl_loc_code_len(const char *loc_code)
+{
+	const char *p = strchr(loc_code, '-');
+
+	return p ? (size_t)(p - loc_code) : strlen(loc_code);
+}
+
+/* Find descendent LED record with CEC location code in CEC list */
+static struct fsp_led_data *fsp_find_cec_led(char *loc_code)
+{
+	return led_hash_find(cec_led_hash, loc_code, strlen(loc_code));
+}
+
+/* Find encl LED record with ENCL location code in ENCL list */
+static struct fsp_led_data *fsp_find_encl_led(char *loc_code)
+{
+	return led_hash_find(encl_led_hash, loc_code, strlen(loc_code));
+}
+
 /* Find encl LED record with CEC location code in CEC list */
 static struct fsp_led_data *fsp_find_encl_cec_led(char *loc_code)
 {
-	struct fsp_led_data *led, *next;
-
-	list_for_each_safe(&cec_ledq, led, next, link) {
-		if (strstr(led->loc_code, "-"))
-			continue;
-		if (!strstr(loc_code, led->loc_code))
-			continue;
-		return led;
-	}
-	return NULL;
+	return led_hash_find(cec_led_hash, loc_code,
+			     encl_loc_code_len(loc_code));
 }
 
 /* Find encl LED record with CEC location code in ENCL list */
 static struct fsp_led_data *fsp_find_encl_encl_led(char *loc_code)
 {
-	struct fsp_led_data *led, *next;
+	return led_hash_find(encl_led_hash, loc_code,
+			     encl_loc_code_len(loc_code));
+}
 
-	list_for_each_safe(&encl_ledq, led, next, link) {
-		if (!strstr(loc_code, led->loc_code))
-			continue;
-		return led;
+/* Keep the counts of the enclosure in line with a descendant's status */
+static void led_set_status(struct fsp_led_data *led, u16 status)
+{
+	struct fsp_led_data *encl = led->encl;
+	u16 changed = led->status ^ status;
+
+	led->status = status;
+	if (!encl)
+		return;
+
+	if (changed & SPCN_LED_FAULT_MASK) {
+		if (status & SPCN_LED_FAULT_MASK)
+			encl->nr_fault++;
+		else
+			encl->nr_fault--;
+	}
+	if (changed & SPCN_LED_IDENTIFY_MASK) {
+		if (status & SPCN_LED_IDENTIFY_MASK)
+			encl->nr_identify++;
+		else
+			encl->nr_identify--;
 	}
-	return NULL;
 }
 
 /* Compute the ENCL LED status in CEC list */
 static void compute_encl_status_cec(struct fsp_led_data *encl_led)
 {
-	struct fsp_led_data *led, *next;
-
 	encl_led->status &= ~SPCN_LED_IDENTIFY_MASK;
 	encl_led->status &= ~SPCN_LED_FAULT_MASK;
 
-	list_for_each_safe(&cec_ledq, led, next, link) {
-		if (!strstr(led->loc_code, encl_led->loc_code))
-			continue;
-
-		/* Don't count the enclsure LED itself */
-		if (!strcmp(led->loc_code, encl_led->loc_code))
-			continue;
-
-		if (led->status & SPCN_LED_IDENTIFY_MASK)
-			encl_led->status |= SPCN_LED_IDENTIFY_MASK;
+	if (encl_led->nr_identify)
+		encl_led->status |= SPCN_LED_IDENTIFY_MASK;
 
-		if (led->status & SPCN_LED_FAULT_MASK)
-			encl_led->status |= SPCN_LED_FAULT_MASK;
-	}
+	if (encl_led->nr_fault)
+		encl_led->status |= SPCN_LED_FAULT_MASK;
 }
 
 /* Is a enclosure LED */
@@ -412,7 +458,7 @@ static void update_led_list(char *loc_code, u32 led_state, u32 excl_bit)
 					 CEC LC=%s\n", loc_code);
 			return;
 		}
-		led->status = led_state;
+		led_set_status(led, led_state);
 	}
 
 	/* Enclosure LED in ENCL list */
@@ -996,7 +1042,7 @@ static void fsp_ret_led_state(char *loc_code)
 	bool found = false;
 	u8 ind_state = 0;
 	u32 cmd = FSP_RSP_GET_LED_STATE;
-	struct fsp_led_data *led, *next;
+	struct fsp_led_data *led;
 	struct fsp_msg *msg;
 
 	if (is_sai_loc_code(loc_code)) {
@@ -1004,10 +1050,8 @@ static void fsp_ret_led_state(char *loc_code)
 			ind_state = FSP_IND_FAULT_ACTV;
 		found = true;
 	} else {
-		list_for_each_safe(&cec_ledq, led, next, link) {
-			if (strcmp(loc_code, led->loc_code))
-				continue;
-
+		led = fsp_find_cec_led(loc_code);
+		if (led) {
 			/* Found the location code */
 			if (led->status & SPCN_LED_IDENTIFY_MASK)
 				ind_state |= FSP_IND_IDENTIFY_ACTV;
@@ -1015,7 +1059,6 @@ static void fsp_ret_led_state(char *loc_code)
 				ind_state |= FSP_IND_FAULT_ACTV;
 
 			found = true;
-			break;
 		}
 	}
 
@@ -1683,10 +1726,32 @@ static void fsp_process_leds_data(u16 len)
 
 			/* Add to the list of enclosure LEDs */
 			list_add_tail(&encl_ledq, &encl_led_data->link);
+			led_hash_add(encl_led_hash, encl_led_data);
 		}
 
 		/* Push this onto the list */
 		list_add_tail(&cec_ledq, &led_data->link);
+		led_hash_add(cec_led_hash, led_data);
+	}
+}
+
+/*
+ * Once all the LEDs are in, point the descendants at their enclosure
+ * and count the ones that are on.
+ */
+static void fsp_link_leds_to_encl(void)
+{
+	struct fsp_led_data *led;
+	u16 status;
+
+	list_for_each(&cec_ledq, led, link) {
+		if (!strchr(led->loc_code, '-'))
+			continue;
+
+		led->encl = fsp_find_encl_cec_led(led->loc_code);
+		status = led->status;
+		led->status = 0;
+		led_set_status(led, status);
 	}
 }
 
@@ -1778,6 +1843,7 @@ static void fsp_read_leds_data_complete(struct fsp_msg *msg)
 
 		/* Copy data to the local list */
 		fsp_process_leds_data(data_len);
+		fsp_link_leds_to_encl();
 
 		/* LEDs captured on the system */
 		prlog(PR_DEBUG, "CEC LEDs captured on the system:\n");
@@ -1881,6 +1947,8 @@ static void fsp_leds_query_spcn(void)
 		led = list_pop(&encl_ledq, struct fsp_led_data, link);
 		free(led);
 	}
+	led_hash_init(cec_led_hash);
+	led_hash_init(encl_led_hash);
 
 	/* Allocate buffer with alignment requirements */
 	if (led_buffer == NULL) {
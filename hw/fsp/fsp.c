@@ -37,6 +37,7 @@
 #include <errorlog.h>
 #include <opal.h>
 #include <opal-msg.h>
+#include <pool.h>
 #include <ccan/list/list.h>
 
 DEFINE_LOG_ENTRY(OPAL_RC_FSP_POLL_TIMEOUT, OPAL_PLATFORM_ERR_EVT, OPAL_FSP,
@@ -109,6 +110,7 @@ static struct lock fsp_lock = LOCK_UNLOCKED;
 static struct lock fsp_poll_lock = LOCK_UNLOCKED;
 
 static u64 fsp_cmdclass_resp_bitmask;
+static u64 fsp_cmdclass_pending_bitmask;
 static u64 timeout_timer;
 
 static u64 fsp_hir_timeout;
@@ -180,6 +182,19 @@ static struct fsp_cmdclass fsp_cmdclass[FSP_MCLASS_LAST - FSP_MCLASS_FIRST + 1]
 	DEF_CLASS(FSP_MCLASS_OCC,		16),
 };
 
+static struct fsp_cmdclass_stats
+fsp_cmdclass_stats[FSP_MCLASS_LAST - FSP_MCLASS_FIRST + 1];
+
+/*
+ * Preallocated messages. Bursts from the console, sensors, LEDs and
+ * error logging would otherwise all go through the heap (and its lock)
+ * for every request and response. We fall back to the heap if the
+ * pool runs dry.
+ */
+#define FSP_MSG_POOL_SIZE	256
+static struct pool fsp_msg_pool;
+static struct lock fsp_msg_pool_lock = LOCK_UNLOCKED;
+
 static void fsp_trace_msg(struct fsp_msg *msg, u8 dir __unused)
 {
 	union trace fsp __unused;
@@ -243,9 +258,60 @@ static struct fsp_cmdclass *fsp_get_cmdclass(struct fsp_msg *msg)
 	return __fsp_get_cmdclass(c);
 }
 
+static struct fsp_cmdclass_stats *fsp_get_cmdclass_stats(
+					struct fsp_cmdclass *cmdclass)
+{
+	if (cmdclass < fsp_cmdclass ||
+	    cmdclass > &fsp_cmdclass[FSP_MCLASS_LAST - FSP_MCLASS_FIRST])
+		return NULL;
+
+	return &fsp_cmdclass_stats[cmdclass - fsp_cmdclass];
+}
+
+/* The statistics are kept big endian, as the OS reads them */
+static void fsp_stats_queued(struct fsp_cmdclass_stats *stats)
+{
+	u16 depth = be16_to_cpu(stats->depth) + 1;
+
+	stats->depth = cpu_to_be16(depth);
+	if (depth > be16_to_cpu(stats->max_depth))
+		stats->max_depth = cpu_to_be16(depth);
+}
+
+static void fsp_stats_dequeued(struct fsp_cmdclass_stats *stats)
+{
+	stats->depth = cpu_to_be16(be16_to_cpu(stats->depth) - 1);
+}
+
+static void fsp_stats_completed(struct fsp_cmdclass_stats *stats, u64 lat)
+{
+	fsp_stats_dequeued(stats);
+	stats->completed = cpu_to_be32(be32_to_cpu(stats->completed) + 1);
+	stats->total_lat = cpu_to_be64(be64_to_cpu(stats->total_lat) + lat);
+	if (lat > be64_to_cpu(stats->max_lat))
+		stats->max_lat = cpu_to_be64(lat);
+}
+
+static bool fsp_msg_from_pool(struct fsp_msg *msg)
+{
+	void *start = fsp_msg_pool.buf;
+	void *end = start + fsp_msg_pool.obj_size * FSP_MSG_POOL_SIZE;
+
+	return start && (void *)msg >= start && (void *)msg < end;
+}
+
 static struct fsp_msg *__fsp_allocmsg(void)
 {
-	return zalloc(sizeof(struct fsp_msg));
+	struct fsp_msg *msg = NULL;
+
+	lock(&fsp_msg_pool_lock);
+	if (fsp_msg_pool.buf)
+		msg = pool_get(&fsp_msg_pool, POOL_NORMAL);
+	unlock(&fsp_msg_pool_lock);
+
+	if (!msg)
+		msg = zalloc(sizeof(struct fsp_msg));
+	return msg;
 }
 
 struct fsp_msg *fsp_allocmsg(bool alloc_response)
@@ -258,7 +324,7 @@ struct fsp_msg *fsp_allocmsg(bool alloc_response)
 	if (alloc_response) {
 		msg->resp = __fsp_allocmsg();
 		if (!msg->resp) {
-			free(msg);
+			__fsp_freemsg(msg);
 			return NULL;
 		}
 	}
@@ -268,7 +334,14 @@ struct fsp_msg *fsp_allocmsg(bool alloc_response)
 
 void __fsp_freemsg(struct fsp_msg *msg)
 {
-	free(msg);
+	if (!fsp_msg_from_pool(msg)) {
+		free(msg);
+		return;
+	}
+
+	lock(&fsp_msg_pool_lock);
+	pool_free_object(&fsp_msg_pool, msg);
+	unlock(&fsp_msg_pool_lock);
 }
 
 void fsp_freemsg(struct fsp_msg *msg)
@@ -282,6 +355,7 @@ void fsp_cancelmsg(struct fsp_msg *msg)
 {
 	bool need_unlock = false;
 	struct fsp_cmdclass* cmdclass = fsp_get_cmdclass(msg);
+	struct fsp_cmdclass_stats *stats;
 
 	if (!fsp_in_rr()) {
 		prerror("FSP: Message cancel allowed only when"
@@ -297,6 +371,9 @@ void fsp_cancelmsg(struct fsp_msg *msg)
 
 	list_del(&msg->link);
 	msg->state = fsp_msg_cancelled;
+	stats = fsp_get_cmdclass_stats(cmdclass);
+	if (stats)
+		fsp_stats_dequeued(stats);
 
 	if (need_unlock)
 		unlock(&fsp_lock);
@@ -1046,6 +1123,7 @@ struct fsp_msg *fsp_mkmsg(u32 cmd_sub_mod, u32 add_words, ...)
 int fsp_queue_msg(struct fsp_msg *msg, void (*comp)(struct fsp_msg *msg))
 {
 	struct fsp_cmdclass *cmdclass;
+	struct fsp_cmdclass_stats *stats;
 	struct fsp *fsp = fsp_get_active();
 	bool need_unlock;
 	u16 seq;
@@ -1081,6 +1159,10 @@ int fsp_queue_msg(struct fsp_msg *msg, void (*comp)(struct fsp_msg *msg))
 	}
 
 	msg->state = fsp_msg_queued;
+	msg->queued_tb = mftb();
+	stats = fsp_get_cmdclass_stats(cmdclass);
+	if (stats)
+		fsp_stats_queued(stats);
 
 	/*
 	 * If we have initiated or about to initiate a reset/reload operation,
@@ -1091,6 +1173,7 @@ int fsp_queue_msg(struct fsp_msg *msg, void (*comp)(struct fsp_msg *msg))
 		list_add_tail(&cmdclass->rr_queue, &msg->link);
 	else {
 		list_add_tail(&cmdclass->msgq, &msg->link);
+		fsp_cmdclass_pending_bitmask |= fsp_get_class_bit(msg->word0 & 0xff);
 		fsp_poke_queue(cmdclass);
 	}
 
@@ -1105,6 +1188,7 @@ int fsp_queue_msg(struct fsp_msg *msg, void (*comp)(struct fsp_msg *msg))
 static void fsp_complete_msg(struct fsp_msg *msg)
 {
 	struct fsp_cmdclass *cmdclass = fsp_get_cmdclass(msg);
+	struct fsp_cmdclass_stats *stats;
 	void (*comp)(struct fsp_msg *msg);
 
 	assert(cmdclass);
@@ -1116,6 +1200,10 @@ static void fsp_complete_msg(struct fsp_msg *msg)
 	cmdclass->busy = false;
 	msg->state = fsp_msg_done;
 
+	stats = fsp_get_cmdclass_stats(cmdclass);
+	if (stats)
+		fsp_stats_completed(stats, mftb() - msg->queued_tb);
+
 	unlock(&fsp_lock);
 	if (comp)
 		(*comp)(msg);
@@ -1223,8 +1311,10 @@ static void fsp_repost_queued_msgs_post_rr(void)
 			list_add_tail(&cmdclass->msgq, &msg->link);
 			poke = true;
 		}
-		if (poke)
+		if (poke) {
+			fsp_cmdclass_pending_bitmask |= 1ull << i;
 			fsp_poke_queue(cmdclass);
+		}
 	}
 }
 
@@ -1534,18 +1624,26 @@ static void fsp_handle_incoming(struct fsp *fsp)
 
 static void fsp_check_queues(struct fsp *fsp)
 {
+	u64 pending = fsp_cmdclass_pending_bitmask;
 	int i;
 
-	/* XXX In the long run, we might want to have a queue of
-	 * classes waiting to be serviced to speed this up, either
-	 * that or a bitmap.
+	/*
+	 * Only look at the classes that had something queued. Bits are
+	 * set when queuing and lazily cleared here once the class queue
+	 * has drained.
 	 */
-	for (i = 0; i <= (FSP_MCLASS_LAST - FSP_MCLASS_FIRST); i++) {
+	for (i = 0; pending; i++, pending >>= 1) {
 		struct fsp_cmdclass *cmdclass = &fsp_cmdclass[i];
 
+		if (!(pending & 1))
+			continue;
 		if (fsp->state != fsp_mbx_idle)
 			break;
-		if (cmdclass->busy || list_empty(&cmdclass->msgq))
+		if (list_empty(&cmdclass->msgq)) {
+			fsp_cmdclass_pending_bitmask &= ~(1ull << i);
+			continue;
+		}
+		if (cmdclass->busy)
 			continue;
 		fsp_poke_queue(cmdclass);
 	}
@@ -2101,6 +2199,17 @@ static bool fsp_init_one(const char *compat)
 	return inited;
 }
 
+static void fsp_init_msg_stats(void)
+{
+	int i;
+
+	for (i = 0; i <= (FSP_MCLASS_LAST - FSP_MCLASS_FIRST); i++)
+		fsp_cmdclass_stats[i].class = FSP_MCLASS_FIRST + i;
+
+	opal_add_export("fsp_msg_stats", fsp_cmdclass_stats,
+			sizeof(fsp_cmdclass_stats));
+}
+
 void fsp_init(void)
 {
 	prlog(PR_DEBUG, "FSP: Looking for FSP...\n");
@@ -2111,6 +2220,12 @@ void fsp_init(void)
 		prlog(PR_DEBUG, "FSP: No FSP on this machine\n");
 		return;
 	}
+
+	if (pool_init(&fsp_msg_pool, sizeof(struct fsp_msg),
+		      FSP_MSG_POOL_SIZE, 0))
+		prerror("FSP: Failed to allocate message pool\n");
+
+	fsp_init_msg_stats();
 }
 
 bool fsp_present(void)
@@ -2304,6 +2419,7 @@ struct fsp_fetch_lid_item {
 	size_t *length;
 	size_t remaining;
 	size_t chunk_requested;
+	uint64_t start_tb;
 	struct list_node link;
 	int result;
 };
@@ -2476,6 +2592,12 @@ static void fsp_fetch_lid_next_chunk(struct fsp_fetch_lid_item *last)
 	assert(lock_held_by_me(&fsp_fetch_lock));
 
 	if (last->remaining == 0 || last->result == OPAL_SUCCESS) {
+		uint64_t ms = tb_to_msecs(mftb() - last->start_tb);
+
+		prlog(PR_INFO, "FSP: LID %08x loaded %zu bytes in %llu ms"
+		      " (%llu KB/s)\n", last->lid_no, *last->length, ms,
+		      ms ? (*last->length / 1024) * 1000 / ms : 0);
+
 		last->result = OPAL_SUCCESS;
 		last = list_pop(&fsp_fetch_lid_queue,
 				struct fsp_fetch_lid_item, link);
@@ -2530,8 +2652,10 @@ static void fsp_start_fetching_next_lid(void)
 		return;
 
 	/* If we're not already fetching */
-	if (last->result == OPAL_EMPTY)
+	if (last->result == OPAL_EMPTY) {
+		last->start_tb = mftb();
 		fsp_fetch_lid_next_chunk(last);
+	}
 }
 
 int fsp_start_preload_resource(enum resource_id id, uint32_t idx,
@@ -2684,6 +2808,7 @@ int fsp_wait_lid_loaded(uint32_t lid_no)
 void fsp_used_by_console(void)
 {
 	fsp_lock.in_con_path = true;
+	fsp_msg_pool_lock.in_con_path = true;
 
 	/*
 	 * Some other processor might hold it without having
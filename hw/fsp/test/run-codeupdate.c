@@ -0,0 +1,472 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Flash an image through the code update code into a simulated FSP,
+ * which reads the LIDs through the TCEs the code mapped, and check what
+ * got written, and that the LIDs were queued while the FSP was busy
+ * writing the previous ones.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <malloc.h>
+#include <assert.h>
+
+#define __TEST__
+
+static unsigned long stamp;
+#define mftb()	(stamp)
+
+#define zalloc(bytes) calloc((bytes), 1)
+
+static inline void smt_lowest(void) { }
+static inline void smt_medium(void) { }
+
+#include "../../../ccan/list/list.c"
+#include "../fsp-codeupdate.c"
+
+/* Single threaded, locks are no-ops */
+void lock_caller(struct lock *l, const char *caller)
+{
+	(void)l;
+	(void)caller;
+}
+
+void unlock(struct lock *l)
+{
+	(void)l;
+}
+
+bool lock_held_by_me(struct lock *l)
+{
+	(void)l;
+	return true;
+}
+
+unsigned long tb_hz = 512000000;
+struct dt_node *dt_root;
+
+void _prlog(int log_level, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (log_level > PR_NOTICE)
+		return;
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+}
+
+static unsigned int errors_logged;
+
+uint32_t log_simple_error(struct opal_err_info *e_info, const char *fmt, ...)
+{
+	(void)e_info;
+	(void)fmt;
+	errors_logged++;
+	return 0;
+}
+
+/* Only the flashing is exercised, not the FSP and OPAL plumbing */
+bool fsp_present(void)
+{
+	return true;
+}
+
+void fsp_register_client(struct fsp_client *client, u8 msgclass)
+{
+	(void)client;
+	(void)msgclass;
+}
+
+void __opal_register(uint64_t token, void *func, unsigned int nargs)
+{
+	(void)token;
+	(void)func;
+	(void)nargs;
+}
+
+void disable_fast_reboot(const char *reason)
+{
+	(void)reason;
+}
+
+bool fsp_in_rr(void)
+{
+	return false;
+}
+
+void fsp_cancelmsg(struct fsp_msg *msg)
+{
+	msg->state = fsp_msg_cancelled;
+}
+
+int fsp_get_sys_param(uint32_t param_id, void *buffer, uint32_t length,
+		      void (*async_complete)(uint32_t param_id, int len,
+					     void *data),
+		      void *comp_data)
+{
+	(void)param_id;
+	(void)buffer;
+	(void)length;
+	(void)async_complete;
+	(void)comp_data;
+	return -1;
+}
+
+void sysparam_add_update_notifier(bool (*update_notify)(struct fsp_msg *msg))
+{
+	(void)update_notify;
+}
+
+int fsp_fetch_data_queue(uint8_t flags, uint16_t id, uint32_t sub_id,
+			 uint32_t offset, void *buffer, size_t *length,
+			 void (*comp)(struct fsp_msg *msg))
+{
+	(void)flags;
+	(void)id;
+	(void)sub_id;
+	(void)offset;
+	(void)buffer;
+	(void)length;
+	(void)comp;
+	return -1;
+}
+
+struct dt_node *dt_find_by_path(struct dt_node *root, const char *path)
+{
+	(void)root;
+	(void)path;
+	return NULL;
+}
+
+struct dt_property *dt_add_property(struct dt_node *node, const char *name,
+				    const void *val, size_t size)
+{
+	(void)node;
+	(void)name;
+	(void)val;
+	(void)size;
+	return NULL;
+}
+
+const void *dt_prop_get_def(const struct dt_node *node, const char *prop,
+			    void *def)
+{
+	(void)node;
+	(void)prop;
+	return def;
+}
+
+void time_wait_ms(unsigned long ms)
+{
+	(void)ms;
+}
+
+struct dt_property *__dt_add_property_strings(struct dt_node *node,
+					      const char *name,
+					      int count, ...)
+{
+	(void)node;
+	(void)name;
+	(void)count;
+	return NULL;
+}
+
+/* The TCEs of the code update space */
+#define NR_TCES		(PSI_DMA_CODE_UPD_SIZE / TCE_PSIZE)
+
+static void *tces[NR_TCES];
+static unsigned int tces_mapped, max_tces_mapped;
+
+void fsp_tce_map(u32 offset, void *addr, u32 size)
+{
+	u32 i;
+
+	assert(offset >= PSI_DMA_CODE_UPD && !(offset & TCE_MASK));
+	assert(!((u64)addr & TCE_MASK) && !(size & TCE_MASK));
+	offset -= PSI_DMA_CODE_UPD;
+	assert(offset + size <= PSI_DMA_CODE_UPD_SIZE);
+
+	for (i = 0; i < size / TCE_PSIZE; i++) {
+		assert(!tces[offset / TCE_PSIZE + i]);
+		tces[offset / TCE_PSIZE + i] = addr + i * TCE_PSIZE;
+	}
+	tces_mapped += size / TCE_PSIZE;
+	if (tces_mapped > max_tces_mapped)
+		max_tces_mapped = tces_mapped;
+}
+
+void fsp_tce_unmap(u32 offset, u32 size)
+{
+	u32 i;
+
+	offset -= PSI_DMA_CODE_UPD;
+	assert(offset + size <= PSI_DMA_CODE_UPD_SIZE);
+	for (i = 0; i < size / TCE_PSIZE; i++) {
+		if (tces[offset / TCE_PSIZE + i])
+			tces_mapped--;
+		tces[offset / TCE_PSIZE + i] = NULL;
+	}
+}
+
+static unsigned int queued_while_writing;
+static LIST_HEAD(fsp_queue);
+
+/*
+ * The simulated FSP: synchronous messages are answered right away,
+ * queued ones (the LID writes) one at a time, a few polls apart.
+ */
+#define MAX_CMDS	64
+#define MAX_LIDS	16
+
+static u32 cmds[MAX_CMDS];
+static unsigned int nr_cmds;
+
+struct sim_lid {
+	u32 id;
+	u32 size;
+	u8 *data;
+	bool written;
+};
+
+static struct sim_lid sim_lids[MAX_LIDS];
+static unsigned int nr_sim_lids, polls;
+
+static u32 msg_cmd(struct fsp_msg *msg)
+{
+	return (msg->word0 & 0xff) << 16 | (msg->word1 & 0xff) << 8 |
+		(msg->word1 >> 8 & 0xff) | (msg->response ? 0x1000000 : 0);
+}
+
+struct fsp_msg *fsp_mkmsg(u32 cmd_sub_mod, u32 add_words, ...)
+{
+	struct fsp_msg *msg = zalloc(sizeof(*msg));
+	va_list list;
+	u32 i;
+
+	msg->word0 = (cmd_sub_mod >> 16) & 0xff;
+	msg->word1 = (cmd_sub_mod & 0xff) << 8 | ((cmd_sub_mod >> 8) & 0xff);
+	msg->response = !!(cmd_sub_mod & 0x1000000);
+	msg->dlen = add_words << 2;
+	va_start(list, add_words);
+	for (i = 0; i < add_words; i++)
+		msg->data.words[i] = va_arg(list, unsigned int);
+	va_end(list);
+	return msg;
+}
+
+void fsp_freemsg(struct fsp_msg *msg)
+{
+	free(msg->resp);
+	free(msg);
+}
+
+/* The FSP reads a LID through the TCEs and checks it */
+static u8 fsp_write_lid(struct fsp_msg *msg)
+{
+	u32 id = msg->data.words[0];
+	u32 tce = msg->data.words[3] - PSI_DMA_CODE_UPD;
+	u32 size = msg->data.words[4], i, j;
+	u8 *p;
+
+	for (j = 0; j < nr_sim_lids; j++)
+		if (sim_lids[j].id == id)
+			break;
+	assert(j < nr_sim_lids && size == sim_lids[j].size);
+	assert(!sim_lids[j].written);
+
+	for (i = 0; i < size; i++) {
+		p = tces[(tce + i) / TCE_PSIZE];
+		assert(p);
+		assert(p[(tce + i) & TCE_MASK] == sim_lids[j].data[i]);
+	}
+	sim_lids[j].written = true;
+	return 0;
+}
+
+static void fsp_answer(struct fsp_msg *msg)
+{
+	u32 cmd = msg_cmd(msg);
+	u8 status = 0;
+
+	assert(nr_cmds < MAX_CMDS);
+	cmds[nr_cmds++] = cmd;
+	if (cmd == FSP_CMD_FLASH_WRITE)
+		status = fsp_write_lid(msg);
+
+	msg->resp = zalloc(sizeof(*msg->resp));
+	msg->resp->word1 = status << 8;
+	msg->state = fsp_msg_done;
+}
+
+int fsp_queue_msg(struct fsp_msg *msg, void (*comp)(struct fsp_msg *msg))
+{
+	assert(!comp);
+	if (!list_empty(&fsp_queue))
+		queued_while_writing++;
+	msg->state = fsp_msg_queued;
+	list_add_tail(&fsp_queue, &msg->link);
+	return 0;
+}
+
+int fsp_sync_msg(struct fsp_msg *msg, bool autofree)
+{
+	assert(!autofree);
+	/* Behind the queued writes, like in the FSP driver */
+	while (!list_empty(&fsp_queue))
+		opal_run_pollers();
+	fsp_answer(msg);
+	return 0;
+}
+
+void opal_run_pollers(void)
+{
+	struct fsp_msg *msg;
+
+	stamp += tb_hz / 10000;
+	if (++polls % 4)
+		return;
+	msg = list_pop(&fsp_queue, struct fsp_msg, link);
+	if (msg)
+		fsp_answer(msg);
+}
+
+/* Image: header, LID index, then the LIDs back to back */
+#define IMAGE_ENTRY_SIZE	0x40000
+
+static struct opal_sg_list *image_list;
+static u8 *image;
+static u32 image_size;
+
+static const u32 lid_sizes[] = {
+	0x18000, 0x300123, 0xc00000, 0x900000, 0x3210, 0x1000, 0x77,
+};
+
+static void make_image(void)
+{
+	struct update_image_header *hdr;
+	struct lid_index_entry *idx;
+	struct opal_sg_list *sg = NULL, *prev = NULL;
+	u32 off, len, i;
+	int n = 0;
+
+	nr_sim_lids = ARRAY_SIZE(lid_sizes);
+	off = ALIGN_UP(sizeof(*hdr) + nr_sim_lids * sizeof(*idx), 16) + 3;
+	image_size = off;
+	for (i = 0; i < nr_sim_lids; i++)
+		image_size += lid_sizes[i];
+	image = zalloc(image_size);
+
+	hdr = (void *)image;
+	hdr->magic = cpu_to_be16(IMAGE_MAGIC_NUMBER);
+	hdr->lid_index_offset = cpu_to_be16(sizeof(*hdr));
+	hdr->number_lids = cpu_to_be16(nr_sim_lids);
+	idx = (void *)hdr + sizeof(*hdr);
+
+	srandom(1);
+	for (i = 0; i < nr_sim_lids; i++, idx++) {
+		struct sim_lid *lid = &sim_lids[i];
+		u32 b;
+
+		lid->id = 0x80a00000 + i;
+		lid->size = lid_sizes[i];
+		lid->data = image + off;
+		for (b = 0; b < lid->size; b++)
+			lid->data[b] = random();
+
+		idx->id = cpu_to_be32(lid->id);
+		idx->size = cpu_to_be32(lid->size);
+		idx->offset = cpu_to_be32(off);
+		off += lid->size;
+	}
+
+	/* Linux's copy of the image, in scattered pages */
+	for (off = 0; off < image_size; off += len) {
+		if (!sg || n == 8) {
+			sg = zalloc(16 + 8 * sizeof(struct opal_sg_entry));
+			if (prev)
+				prev->next = cpu_to_be64((u64)sg);
+			else
+				image_list = sg;
+			prev = sg;
+			n = 0;
+		}
+		len = MIN(IMAGE_ENTRY_SIZE, image_size - off);
+		sg->entry[n].data = cpu_to_be64((u64)memalign(TCE_PSIZE, len));
+		sg->entry[n].length = cpu_to_be64(len);
+		sg->length = cpu_to_be64(SG_LIST_VERSION << 56 |
+					 (16 + ++n * sizeof(struct opal_sg_entry)));
+		memcpy((void *)be64_to_cpu(sg->entry[n - 1].data), image + off,
+		       len);
+	}
+}
+
+static void reset_sim(void)
+{
+	unsigned int i;
+
+	nr_cmds = 0;
+	queued_while_writing = 0;
+	errors_logged = 0;
+	for (i = 0; i < nr_sim_lids; i++)
+		sim_lids[i].written = false;
+}
+
+static void test_flash(void)
+{
+	unsigned int i;
+
+	reset_sim();
+	assert(fsp_flash_firmware() == OPAL_SUCCESS);
+	assert(!errors_logged);
+
+	/* Side, start, delete, the LIDs in order, complete */
+	assert(nr_cmds == 4 + nr_sim_lids);
+	assert(cmds[0] == FSP_CMD_SET_IPL_SIDE);
+	assert(cmds[1] == FSP_CMD_FLASH_START);
+	assert(cmds[2] == FSP_CMD_FLASH_DEL);
+	for (i = 0; i < nr_sim_lids; i++) {
+		assert(cmds[3 + i] == FSP_CMD_FLASH_WRITE);
+		assert(sim_lids[i].written);
+	}
+	assert(cmds[nr_cmds - 1] == FSP_CMD_FLASH_COMPLETE);
+	assert(!tces_mapped);
+
+	/*
+	 * All but the first LID are queued behind a write, except for the
+	 * 9MB one which has to wait for the TCEs of the 12MB one before it.
+	 */
+	assert(queued_while_writing == nr_sim_lids - 2);
+	assert(max_tces_mapped * TCE_PSIZE > 0xc00000);
+	printf("%u LIDs, %u queued while writing, up to %u TCEs mapped\n",
+	       nr_sim_lids, queued_while_writing, max_tces_mapped);
+}
+
+int main(void)
+{
+	make_image();
+
+	image_data = image_list;
+	ipl_side = FW_IPL_SIDE_PERM;
+	flash_state = FLASH_STATE_READ;
+
+	test_flash();
+
+	return 0;
+}
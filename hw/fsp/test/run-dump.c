@@ -0,0 +1,439 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Read dumps through the dump code into scattered buffers, from a
+ * simulated FSP which serves the fetch requests one at a time and DMAs
+ * through the TCEs the dump code mapped, and check the data and the
+ * final states.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <malloc.h>
+#include <assert.h>
+
+#define __TEST__
+
+static unsigned long stamp;
+#define mftb()	(stamp)
+
+#define zalloc(bytes) calloc((bytes), 1)
+
+#include "../../../ccan/list/list.c"
+#include "../fsp-dump.c"
+
+/* Single threaded, locks are no-ops */
+void lock_caller(struct lock *l, const char *caller)
+{
+	(void)l;
+	(void)caller;
+}
+
+void unlock(struct lock *l)
+{
+	(void)l;
+}
+
+bool lock_held_by_me(struct lock *l)
+{
+	(void)l;
+	return true;
+}
+
+unsigned long tb_hz = 512000000;
+struct dt_node *dt_root;
+
+void _prlog(int log_level, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (log_level > PR_NOTICE)
+		return;
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+}
+
+uint32_t log_simple_error(struct opal_err_info *e_info, const char *fmt, ...)
+{
+	(void)e_info;
+	(void)fmt;
+	return 0;
+}
+
+void opal_update_pending_evt(uint64_t evt_mask, uint64_t evt_values)
+{
+	(void)evt_mask;
+	(void)evt_values;
+}
+
+/* Only the dump reads are exercised, not the FSP and OPAL plumbing */
+bool fsp_present(void)
+{
+	return true;
+}
+
+void fsp_register_client(struct fsp_client *client, u8 msgclass)
+{
+	(void)client;
+	(void)msgclass;
+}
+
+void opal_add_host_sync_notifier(bool (*notify)(void *data), void *data)
+{
+	(void)notify;
+	(void)data;
+}
+
+void __opal_register(uint64_t token, void *func, unsigned int nargs)
+{
+	(void)token;
+	(void)func;
+	(void)nargs;
+}
+
+struct dt_node *dt_find_by_path(struct dt_node *root, const char *path)
+{
+	(void)root;
+	(void)path;
+	return NULL;
+}
+
+const struct dt_property *dt_find_property(const struct dt_node *node,
+					   const char *name)
+{
+	(void)node;
+	(void)name;
+	return NULL;
+}
+
+u32 dt_prop_get_u32(const struct dt_node *node, const char *prop)
+{
+	(void)node;
+	(void)prop;
+	return 0;
+}
+
+u64 dt_prop_get_u64(const struct dt_node *node, const char *prop)
+{
+	(void)node;
+	(void)prop;
+	return 0;
+}
+
+/* Dump ACKs, dropped on the floor */
+struct fsp_msg *fsp_mkmsg(u32 cmd_sub_mod, u32 add_words, ...)
+{
+	(void)cmd_sub_mod;
+	(void)add_words;
+	return zalloc(sizeof(struct fsp_msg));
+}
+
+int fsp_queue_msg(struct fsp_msg *msg, void (*comp)(struct fsp_msg *msg))
+{
+	(void)comp;
+	free(msg);
+	return 0;
+}
+
+void fsp_freemsg(struct fsp_msg *msg)
+{
+	free(msg->resp);
+	free(msg);
+}
+
+/* The TCEs of the dump space */
+#define NR_TCES		(PSI_DMA_DUMP_DATA_SIZE / TCE_PSIZE)
+
+static void *tces[NR_TCES];
+
+void fsp_tce_map(u32 offset, void *addr, u32 size)
+{
+	u32 i;
+
+	assert(offset >= PSI_DMA_DUMP_DATA && !(offset & TCE_MASK));
+	assert(!((u64)addr & TCE_MASK) && !(size & TCE_MASK));
+	offset -= PSI_DMA_DUMP_DATA;
+	assert(offset + size <= PSI_DMA_DUMP_DATA_SIZE);
+
+	for (i = 0; i < size / TCE_PSIZE; i++) {
+		assert(!tces[offset / TCE_PSIZE + i]);
+		tces[offset / TCE_PSIZE + i] = addr + i * TCE_PSIZE;
+	}
+}
+
+void fsp_tce_unmap(u32 offset, u32 size)
+{
+	u32 i;
+
+	offset -= PSI_DMA_DUMP_DATA;
+	assert(offset + size <= PSI_DMA_DUMP_DATA_SIZE);
+	for (i = 0; i < size / TCE_PSIZE; i++)
+		tces[offset / TCE_PSIZE + i] = NULL;
+}
+
+static bool tces_clear(void)
+{
+	int i;
+
+	for (i = 0; i < NR_TCES; i++)
+		if (tces[i])
+			return false;
+	return true;
+}
+
+/*
+ * The simulated FSP serves the fetch requests in order, and the host
+ * runs the completion of each one before the FSP looks at the next.
+ */
+struct sim_req {
+	struct fsp_msg *msg;
+	void (*comp)(struct fsp_msg *msg);
+	struct list_node link;
+};
+
+static LIST_HEAD(fsp_queue);
+static uint32_t fsp_max_xfer;		/* Split responses beyond that */
+static uint32_t fsp_fail_offset;	/* Fail the request at that offset */
+static unsigned int fsp_requests, fsp_more_data;
+
+static uint8_t dump_byte(uint32_t id, uint32_t off)
+{
+	return (off ^ (off >> 8) ^ (off >> 16) ^ id) & 0xff;
+}
+
+int fsp_fetch_data_queue(uint8_t flags, uint16_t id, uint32_t sub_id,
+			 uint32_t offset, void *buffer, size_t *length,
+			 void (*comp)(struct fsp_msg *msg))
+{
+	struct sim_req *req = zalloc(sizeof(*req));
+	struct fsp_msg *msg = zalloc(sizeof(*msg));
+
+	msg->data.words[0] = flags << 16 | id;
+	msg->data.words[1] = sub_id;
+	msg->data.words[2] = offset;
+	msg->data.words[4] = (u64)buffer;
+	msg->data.words[5] = *length;
+	req->msg = msg;
+	req->comp = comp;
+	list_add_tail(&fsp_queue, &req->link);
+	fsp_requests++;
+
+	return OPAL_SUCCESS;
+}
+
+/* DMA the requested part of the dump through the TCEs */
+static void fsp_serve(struct sim_req *req)
+{
+	struct fsp_msg *msg = req->msg;
+	uint32_t offset = msg->data.words[2];
+	uint32_t tce = msg->data.words[4];
+	uint32_t len = msg->data.words[5], i;
+	uint8_t status = FSP_STATUS_SUCCESS;
+	uint8_t *p;
+
+	assert(tce >= PSI_DMA_DUMP_DATA);
+	assert(tce + len <= PSI_DMA_DUMP_DATA + PSI_DMA_DUMP_DATA_SIZE);
+	tce -= PSI_DMA_DUMP_DATA;
+
+	if (fsp_max_xfer && len > fsp_max_xfer) {
+		len = fsp_max_xfer;
+		status = FSP_STATUS_MORE_DATA;
+		fsp_more_data++;
+	}
+	if (fsp_fail_offset && offset <= fsp_fail_offset &&
+	    fsp_fail_offset < offset + len) {
+		len = 0;
+		status = FSP_STATUS_INVALID_DATA;
+	}
+
+	for (i = 0; i < len; i++) {
+		p = tces[(tce + i) / TCE_PSIZE];
+		assert(p);
+		p[(tce + i) & TCE_MASK] = dump_byte(msg->data.words[1],
+						    offset + i);
+	}
+
+	msg->resp = zalloc(sizeof(*msg->resp));
+	msg->resp->word1 = status << 8;
+	msg->resp->data.words[1] = offset;
+	msg->resp->data.words[2] = len;
+}
+
+/* Run the FSP until everything was answered */
+static void sim_run(void)
+{
+	struct sim_req *req;
+
+	while ((req = list_pop(&fsp_queue, struct sim_req, link))) {
+		assert(list_empty(&fsp_queue));
+		stamp += tb_hz / 1000;
+		fsp_serve(req);
+		req->comp(req->msg);
+		free(req);
+	}
+}
+
+/* Linux buffers: scattered pages, a few entries per SG list page */
+#define SG_PER_LIST	16
+
+static struct opal_sg_list *make_sglist(uint32_t size)
+{
+	struct opal_sg_list *head = NULL, *sg = NULL, *prev = NULL;
+	uint32_t len, off = 0;
+	int n = SG_PER_LIST;
+
+	while (off < size) {
+		if (n == SG_PER_LIST) {
+			sg = zalloc(16 + SG_PER_LIST * sizeof(struct opal_sg_entry));
+			if (prev)
+				prev->next = cpu_to_be64((u64)sg);
+			else
+				head = sg;
+			prev = sg;
+			n = 0;
+		}
+
+		len = (1 + random() % 64) * TCE_PSIZE;
+		if (len > size - off)
+			len = size - off;
+		sg->entry[n].data = cpu_to_be64((u64)memalign(TCE_PSIZE, len));
+		sg->entry[n].length = cpu_to_be64(len);
+		memset((void *)be64_to_cpu(sg->entry[n].data), 0xee, len);
+		sg->length = cpu_to_be64(16 + ++n * sizeof(struct opal_sg_entry));
+		off += len;
+	}
+	return head;
+}
+
+/* Compare the buffers with the dump, returns how much matched */
+static uint32_t check_sglist(struct opal_sg_list *sg, uint32_t id)
+{
+	uint32_t off = 0, good = 0, i, len;
+	uint8_t *p;
+	int e, n;
+
+	for (; sg; sg = (void *)be64_to_cpu(sg->next)) {
+		n = (be64_to_cpu(sg->length) - 16) / sizeof(struct opal_sg_entry);
+		for (e = 0; e < n; e++) {
+			p = (void *)be64_to_cpu(sg->entry[e].data);
+			len = be64_to_cpu(sg->entry[e].length);
+			for (i = 0; i < len; i++, off++)
+				good += p[i] == dump_byte(id, off);
+		}
+	}
+	return good;
+}
+
+static void free_sglist(struct opal_sg_list *sg)
+{
+	struct opal_sg_list *next;
+	int i, n;
+
+	for (; sg; sg = next) {
+		next = (void *)be64_to_cpu(sg->next);
+		n = (be64_to_cpu(sg->length) - 16) / sizeof(struct opal_sg_entry);
+		for (i = 0; i < n; i++)
+			free((void *)be64_to_cpu(sg->entry[i].data));
+		free(sg);
+	}
+}
+
+static int64_t read_dump(uint8_t type, uint32_t id, uint32_t size,
+			 struct opal_sg_list **list)
+{
+	uint32_t info_id, info_size, info_type;
+
+	assert(add_dump_id_to_list(type, id, size) == OPAL_SUCCESS);
+	assert(dump_state == DUMP_STATE_NOTIFY);
+	assert(fsp_opal_dump_info2(&info_id, &info_size, &info_type) ==
+	       OPAL_SUCCESS);
+	assert(info_id == id && info_size == size && info_type == type);
+
+	*list = make_sglist(size);
+	fsp_requests = fsp_more_data = 0;
+	return fsp_opal_dump_read(id, *list);
+}
+
+static void test_read(uint8_t type, uint32_t size, uint32_t max_xfer)
+{
+	struct opal_sg_list *list;
+	uint32_t id = 0x1000 + type;
+	uint32_t chunk = get_dump_fetch_max_size(type);
+
+	fsp_max_xfer = max_xfer;
+	assert(read_dump(type, id, size, &list) == OPAL_BUSY_EVENT);
+	sim_run();
+
+	assert(check_dump_state() == OPAL_SUCCESS);
+	assert(check_sglist(list, id) == size);
+	assert(tces_clear());
+	if (!max_xfer)
+		assert(fsp_requests == (size + chunk - 1) / chunk);
+	else
+		assert(fsp_more_data);
+
+	/* What was logged matches what the FSP saw */
+	assert(dump_stats.fetched == size);
+	assert(dump_stats.requests == fsp_requests);
+	assert(dump_stats.more_data == fsp_more_data);
+	assert(tb_to_msecs(stamp - dump_stats.start_tb) == fsp_requests);
+
+	assert(fsp_opal_dump_ack(id) == OPAL_SUCCESS);
+	assert(dump_state == DUMP_STATE_NONE);
+	free_sglist(list);
+	fsp_max_xfer = 0;
+}
+
+static void test_error(void)
+{
+	struct opal_sg_list *list;
+	uint32_t size = 20 << 20;
+
+	fsp_fail_offset = 7 << 20;
+	assert(read_dump(DUMP_TYPE_SYS, 0x2000, size, &list) ==
+	       OPAL_BUSY_EVENT);
+	sim_run();
+
+	/* Everything before the bad chunk made it */
+	assert(check_dump_state() == OPAL_PARTIAL);
+	assert(check_sglist(list, 0x2000) >=
+	       (fsp_fail_offset & ~(DUMP_FETCH_SIZE_SYS - 1)));
+	assert(tces_clear());
+
+	assert(fsp_opal_dump_ack(0x2000) == OPAL_SUCCESS);
+	free_sglist(list);
+	fsp_fail_offset = 0;
+}
+
+int main(void)
+{
+	srandom(1);
+	assert(init_dump_free_list() == 0);
+
+	test_read(DUMP_TYPE_SYS, (64 << 20) + 1234, 0);
+	test_read(DUMP_TYPE_FSP, 3 << 20, 0);
+
+	/* Split responses, in every chunk and not only the first one */
+	test_read(DUMP_TYPE_SYS, (10 << 20) + 4096, 0x100000);
+	test_read(DUMP_TYPE_FSP, 12 << 20, 0x180000);
+
+	test_error();
+
+	return 0;
+}
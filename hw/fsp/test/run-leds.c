@@ -0,0 +1,440 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Load the LEDs of a large system the way SPCN hands them over, and
+ * check the hashed lookups and the enclosure roll up counters against
+ * scans of the LED lists, through a random series of LED updates.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <malloc.h>
+#include <assert.h>
+#include <time.h>
+
+#define __TEST__
+
+#define zalloc(bytes) calloc((bytes), 1)
+
+#include "../../../ccan/list/list.c"
+#include "../fsp-leds.c"
+
+/* Single threaded, locks are no-ops */
+void lock_caller(struct lock *l, const char *caller)
+{
+	(void)l;
+	(void)caller;
+}
+
+void unlock(struct lock *l)
+{
+	(void)l;
+}
+
+bool lock_held_by_me(struct lock *l)
+{
+	(void)l;
+	return true;
+}
+
+struct dt_node *dt_root, *opal_node;
+
+void opal_run_pollers(void)
+{
+}
+
+void _prlog(int log_level, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (log_level > PR_NOTICE)
+		return;
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+}
+
+static unsigned int errors_logged;
+
+uint32_t log_simple_error(struct opal_err_info *e_info, const char *fmt, ...)
+{
+	(void)e_info;
+	(void)fmt;
+	errors_logged++;
+	return 0;
+}
+
+/* Only the LED lists are exercised, not the FSP and OPAL plumbing */
+struct fsp_msg *fsp_mkmsg(u32 cmd_sub_mod, u32 add_words, ...)
+{
+	(void)cmd_sub_mod;
+	(void)add_words;
+	return NULL;
+}
+
+int fsp_queue_msg(struct fsp_msg *msg, void (*comp)(struct fsp_msg *msg))
+{
+	(void)msg;
+	(void)comp;
+	return 0;
+}
+
+void fsp_freemsg(struct fsp_msg *msg)
+{
+	(void)msg;
+}
+
+void fsp_tce_map(u32 offset, void *addr, u32 size)
+{
+	(void)offset;
+	(void)addr;
+	(void)size;
+}
+
+void fsp_tce_unmap(u32 offset, u32 size)
+{
+	(void)offset;
+	(void)size;
+}
+
+void *fsp_inbound_buf_from_tce(u32 tce_token)
+{
+	(void)tce_token;
+	return NULL;
+}
+
+bool fsp_present(void)
+{
+	return false;
+}
+
+void fsp_register_client(struct fsp_client *client, u8 msgclass)
+{
+	(void)client;
+	(void)msgclass;
+}
+
+int fsp_get_sys_param(uint32_t param_id, void *buffer, uint32_t length,
+		      void (*async_complete)(uint32_t param_id, int len,
+					     void *data),
+		      void *comp_data)
+{
+	(void)param_id;
+	(void)buffer;
+	(void)length;
+	(void)async_complete;
+	(void)comp_data;
+	return -1;
+}
+
+void sysparam_add_update_notifier(bool (*update_notify)(struct fsp_msg *msg))
+{
+	(void)update_notify;
+}
+
+int _opal_queue_msg(enum opal_msg_type msg_type, void *data,
+		    void (*consumed)(void *data), size_t num_params,
+		    const u64 *params)
+{
+	(void)msg_type;
+	(void)data;
+	(void)consumed;
+	(void)num_params;
+	(void)params;
+	return 0;
+}
+
+void __opal_register(uint64_t token, void *func, unsigned int nargs)
+{
+	(void)token;
+	(void)func;
+	(void)nargs;
+}
+
+struct dt_node *dt_find_by_path(struct dt_node *root, const char *path)
+{
+	(void)root;
+	(void)path;
+	return NULL;
+}
+
+struct dt_node *dt_new(struct dt_node *parent, const char *name)
+{
+	(void)parent;
+	(void)name;
+	return NULL;
+}
+
+bool dt_has_node_property(const struct dt_node *node, const char *name,
+			  const char *val)
+{
+	(void)node;
+	(void)name;
+	(void)val;
+	return false;
+}
+
+const void *dt_prop_get(const struct dt_node *node, const char *prop)
+{
+	(void)node;
+	(void)prop;
+	return NULL;
+}
+
+struct dt_property *__dt_add_property_strings(struct dt_node *node,
+					      const char *name,
+					      int count, ...)
+{
+	(void)node;
+	(void)name;
+	(void)count;
+	return NULL;
+}
+
+/* The LED lists, as the scans of the LED code used to see them */
+static struct fsp_led_data *scan_find(struct list_head *q,
+				      const char *loc_code)
+{
+	struct fsp_led_data *led;
+
+	list_for_each(q, led, link) {
+		if (!strcmp(led->loc_code, loc_code))
+			return led;
+	}
+	return NULL;
+}
+
+static struct fsp_led_data *scan_find_encl(struct list_head *q,
+					   const char *loc_code)
+{
+	struct fsp_led_data *led;
+
+	list_for_each(q, led, link) {
+		if (strstr(led->loc_code, "-"))
+			continue;
+		if (strstr(loc_code, led->loc_code))
+			return led;
+	}
+	return NULL;
+}
+
+static u16 scan_encl_status(struct fsp_led_data *encl_led)
+{
+	struct fsp_led_data *led;
+	u16 status = 0;
+
+	list_for_each(&cec_ledq, led, link) {
+		if (!strstr(led->loc_code, encl_led->loc_code))
+			continue;
+		if (!strcmp(led->loc_code, encl_led->loc_code))
+			continue;
+		status |= led->status & (SPCN_LED_IDENTIFY_MASK |
+					 SPCN_LED_FAULT_MASK);
+	}
+	return status;
+}
+
+#define NR_ENCL		200
+#define NR_PER_ENCL	50
+#define NR_LEDS		(NR_ENCL * (NR_PER_ENCL + 1))
+
+static char loc_codes[NR_LEDS][LOC_CODE_SIZE];
+
+static void make_loc_codes(void)
+{
+	int e, d, i = 0;
+
+	for (e = 0; e < NR_ENCL; e++) {
+		snprintf(loc_codes[i++], LOC_CODE_SIZE, "U78C9.%03d.WZS%04d",
+			 e % 7, e);
+		for (d = 0; d < NR_PER_ENCL; d++)
+			snprintf(loc_codes[i++], LOC_CODE_SIZE,
+				 "U78C9.%03d.WZS%04d-P%d-C%d", e % 7, e,
+				 d / 8 + 1, d % 8);
+	}
+}
+
+/* Hand the LEDs over in SPCN's format, 1KB at a time */
+static void load_leds(void)
+{
+	void *buf;
+	u16 len, status;
+	int i = 0;
+
+	led_buffer = memalign(TCE_PSIZE, PSI_DMA_LED_BUF_SZ);
+	fsp_leds_query_spcn();
+
+	while (i < NR_LEDS) {
+		buf = led_buffer;
+		len = 0;
+		for (; i < NR_LEDS && len < 1024; i++) {
+			size_t lc_len = strlen(loc_codes[i]);
+
+			/* A few descendants come up on */
+			status = (i % 37 == 0) ? SPCN_LED_FAULT_MASK : 0;
+			if (i % 53 == 0)
+				status |= SPCN_LED_IDENTIFY_MASK;
+
+			buf_write(buf, u16, i);
+			buf_write(buf, u8, lc_len);
+			memcpy(buf, loc_codes[i], lc_len);
+			buf += lc_len;
+			buf_write(buf, u16, 0);
+			buf_write(buf, u16, status);
+			len += 2 + 1 + lc_len + 2 + 2;
+		}
+		fsp_process_leds_data(len);
+	}
+	fsp_link_leds_to_encl();
+}
+
+static void check_lookups(void)
+{
+	struct fsp_led_data *led;
+	int i;
+
+	for (i = 0; i < NR_LEDS; i++) {
+		char *lc = loc_codes[i];
+
+		led = fsp_find_cec_led(lc);
+		assert(led && led == scan_find(&cec_ledq, lc));
+		assert(fsp_find_encl_led(lc) == scan_find(&encl_ledq, lc));
+		assert(fsp_find_encl_cec_led(lc) ==
+		       scan_find_encl(&cec_ledq, lc));
+		assert(fsp_find_encl_encl_led(lc) ==
+		       scan_find_encl(&encl_ledq, lc));
+		assert(is_enclosure_led(lc) == !strchr(lc, '-'));
+	}
+
+	/* Unknown codes, and a prefix that isn't an enclosure */
+	assert(!fsp_find_cec_led((char *)"U78C9.001.WZS9999-P1"));
+	assert(!fsp_find_encl_cec_led((char *)"U78C9.001.WZS9999-P1"));
+	assert(!fsp_find_cec_led((char *)"U78C9.001"));
+}
+
+/* The counts of every enclosure match a scan of its descendants */
+static void check_encl_counts(void)
+{
+	struct fsp_led_data *e, *encl, *led;
+	u16 fault, identify;
+
+	list_for_each(&encl_ledq, e, link) {
+		encl = fsp_find_cec_led(e->loc_code);
+		fault = identify = 0;
+		list_for_each(&cec_ledq, led, link) {
+			if (led->encl != encl)
+				continue;
+			assert(strstr(led->loc_code, encl->loc_code));
+			fault += !!(led->status & SPCN_LED_FAULT_MASK);
+			identify += !!(led->status & SPCN_LED_IDENTIFY_MASK);
+		}
+		assert(encl->nr_fault == fault);
+		assert(encl->nr_identify == identify);
+	}
+}
+
+static void test_updates(void)
+{
+	struct fsp_led_data *led, *encl_cec, *encl;
+	unsigned int i, n;
+	u16 state;
+
+	srandom(1);
+	for (n = 0; n < 20000; n++) {
+		i = random() % NR_LEDS;
+		state = 0;
+		if (random() % 3 == 0)
+			state |= SPCN_LED_FAULT_MASK;
+		if (random() % 5 == 0)
+			state |= SPCN_LED_IDENTIFY_MASK;
+
+		update_led_list(loc_codes[i], state,
+				random() % 7 == 0 ? FSP_LED_EXCL_FAULT : 0);
+
+		led = fsp_find_cec_led(loc_codes[i]);
+		encl_cec = fsp_find_encl_cec_led(loc_codes[i]);
+		encl = fsp_find_encl_encl_led(loc_codes[i]);
+		if (led != encl_cec)
+			assert(led->status == state);
+
+		state = scan_encl_status(encl_cec);
+		if (encl_cec->excl_bit & FSP_LED_EXCL_FAULT)
+			state |= SPCN_LED_FAULT_MASK;
+		assert((encl_cec->status & (SPCN_LED_FAULT_MASK |
+					    SPCN_LED_IDENTIFY_MASK)) == state);
+		assert(encl->status == encl_cec->status);
+	}
+	check_encl_counts();
+	assert(!errors_logged);
+}
+
+/* How long the lookups of an update took before and now */
+static void time_lookups(void)
+{
+	struct fsp_led_data *found = NULL;
+	clock_t start, scan, hash;
+	int i, n;
+
+	start = clock();
+	for (n = 0; n < 5; n++)
+		for (i = 0; i < NR_LEDS; i++) {
+			found = scan_find(&cec_ledq, loc_codes[i]);
+			found = scan_find_encl(&cec_ledq, loc_codes[i]);
+			scan_encl_status(found);
+		}
+	scan = clock() - start;
+
+	start = clock();
+	for (n = 0; n < 5; n++)
+		for (i = 0; i < NR_LEDS; i++) {
+			found = fsp_find_cec_led(loc_codes[i]);
+			found = fsp_find_encl_cec_led(loc_codes[i]);
+			compute_encl_status_cec(found);
+		}
+	hash = clock() - start;
+
+	printf("%d LEDs in %d enclosures: %.1f us per update scanning, "
+	       "%.3f us hashed\n", NR_LEDS, NR_ENCL,
+	       (double)scan * 1000000 / CLOCKS_PER_SEC / (5 * NR_LEDS),
+	       (double)hash * 1000000 / CLOCKS_PER_SEC / (5 * NR_LEDS));
+}
+
+int main(void)
+{
+	struct fsp_led_data *led;
+
+	list_head_init(&cec_ledq);
+	list_head_init(&encl_ledq);
+	list_head_init(&spcn_cmdq);
+
+	make_loc_codes();
+	load_leds();
+
+	check_lookups();
+	check_encl_counts();
+	test_updates();
+	time_lookups();
+
+	while ((led = list_pop(&cec_ledq, struct fsp_led_data, link)))
+		free(led);
+	while ((led = list_pop(&encl_ledq, struct fsp_led_data, link)))
+		free(led);
+	free(led_buffer);
+
+	return 0;
+}
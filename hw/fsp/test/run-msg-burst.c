@@ -0,0 +1,444 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replay bursts of FSP messages, as generated by the console, sensors,
+ * LEDs and error logging, through the FSP driver against a simulated
+ * FSP mailbox, and check the per class queueing rules, the message pool
+ * and the class statistics.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <malloc.h>
+#include <assert.h>
+
+#define __TEST__
+#define __IO_H
+
+static uint64_t stamp;
+#define mftb()	(stamp)
+
+#define zalloc(bytes) calloc((bytes), 1)
+
+static uint32_t sim_regs[0x400 / 4];
+
+static inline void smt_lowest(void) { }
+static inline void smt_medium(void) { }
+
+static inline uint32_t in_be32(const volatile void *addr);
+static inline void out_be32(volatile void *addr, uint32_t val);
+static inline uint64_t in_be64(const volatile void *addr)
+{
+	(void)addr;
+	return 0;
+}
+
+#include <skiboot.h>
+#include <lock.h>
+
+/* uint64_t isn't unsigned long long here, don't check the formats */
+static void test_prlog(int log_level, const char *fmt, ...);
+#undef prlog
+#define prlog(l, f, ...) do { test_prlog(l, f, ##__VA_ARGS__); } while(0)
+
+/* Single threaded, locks are no-ops */
+void lock_caller(struct lock *l, const char *caller)
+{
+	(void)l;
+	(void)caller;
+}
+
+bool try_lock_caller(struct lock *l, const char *caller)
+{
+	(void)l;
+	(void)caller;
+	return true;
+}
+
+bool lock_recursive_caller(struct lock *l, const char *caller)
+{
+	(void)l;
+	(void)caller;
+	return false;
+}
+
+void unlock(struct lock *l)
+{
+	(void)l;
+}
+
+bool lock_held_by_me(struct lock *l)
+{
+	(void)l;
+	return true;
+}
+
+#include "../../../ccan/list/list.c"
+#include "../../../core/pool.c"
+#include "../fsp.c"
+
+unsigned long tb_hz = 512000000;
+struct dt_node *dt_root;
+
+static void test_prlog(int log_level, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (log_level > PR_NOTICE)
+		return;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+
+/* Error paths the burst must never hit */
+static unsigned int unexpected_calls;
+
+uint32_t log_simple_error(struct opal_err_info *e_info, const char *fmt, ...)
+{
+	(void)e_info;
+	(void)fmt;
+	unexpected_calls++;
+	return 0;
+}
+
+void trace_add(union trace *trace, u8 type, u16 len)
+{
+	(void)trace;
+	(void)type;
+	(void)len;
+}
+
+void opal_add_poller(void (*poller)(void *data), void *data)
+{
+	(void)poller;
+	(void)data;
+}
+
+void opal_run_pollers(void)
+{
+}
+
+void opal_add_export(const char *name, void *base, uint64_t size)
+{
+	(void)name;
+	(void)base;
+	(void)size;
+}
+
+void time_wait_nopoll(unsigned long duration)
+{
+	stamp += duration;
+}
+
+bool psi_check_link_active(struct psi *psi)
+{
+	(void)psi;
+	return true;
+}
+
+bool psi_poll_fsp_interrupt(struct psi *psi)
+{
+	(void)psi;
+	return true;
+}
+
+void psi_disable_link(struct psi *psi) { (void)psi; unexpected_calls++; }
+void psi_reset_fsp(struct psi *psi) { (void)psi; unexpected_calls++; }
+void psi_enable_fsp_interrupt(struct psi *psi) { (void)psi; }
+void psi_init_for_fsp(struct psi *psi) { (void)psi; }
+void psi_fsp_link_in_use(struct psi *psi) { (void)psi; }
+struct psi *psi_find_link(uint32_t chip_id) { (void)chip_id; return NULL; }
+void fsp_fips_dump_notify(uint32_t dump_id, uint32_t dump_size)
+{
+	(void)dump_id;
+	(void)dump_size;
+}
+
+struct dt_node *dt_find_by_path(struct dt_node *root, const char *path)
+{
+	(void)root;
+	(void)path;
+	return NULL;
+}
+
+struct dt_node *dt_find_compatible_node(struct dt_node *root,
+				       struct dt_node *prev,
+				       const char *compat)
+{
+	(void)root;
+	(void)prev;
+	(void)compat;
+	return NULL;
+}
+
+const struct dt_property *dt_find_property(const struct dt_node *node,
+					   const char *name)
+{
+	(void)node;
+	(void)name;
+	return NULL;
+}
+
+const void *dt_prop_get_def(const struct dt_node *node, const char *prop,
+			    void *def)
+{
+	(void)node;
+	(void)prop;
+	return def;
+}
+
+u32 dt_prop_get_u32(const struct dt_node *node, const char *prop)
+{
+	(void)node;
+	(void)prop;
+	return 0;
+}
+
+/*
+ * Simulated FSP mailbox. The FSP takes a message as soon as the host
+ * posts it (XUP), and answers in FIFO order, one response at a time
+ * through the FSP->host half of the mailbox (HPEND).
+ */
+#define SIM_MAX_PENDING	1024
+
+static struct {
+	u32 w0, w1;
+} sim_pending[SIM_MAX_PENDING];
+static unsigned int sim_head, sim_tail;
+static unsigned int sim_outstanding[FSP_MCLASS_LAST - FSP_MCLASS_FIRST + 1];
+static unsigned int sim_accesses;
+
+#define SIM_REG(r)	sim_regs[(r) / 4]
+
+static void sim_fsp_receive(void)
+{
+	u32 w0 = SIM_REG(FSP_MBX1_HDATA_AREA);
+	u32 w1 = SIM_REG(FSP_MBX1_HDATA_AREA + 4);
+	u8 class = w0 & 0xff;
+
+	/* The host must never have two commands of a class in flight */
+	assert(sim_outstanding[class - FSP_MCLASS_FIRST] == 0);
+	sim_outstanding[class - FSP_MCLASS_FIRST]++;
+
+	sim_pending[sim_tail].w0 = w0;
+	sim_pending[sim_tail].w1 = w1;
+	sim_tail = (sim_tail + 1) % SIM_MAX_PENDING;
+
+	SIM_REG(FSP_MBX1_HCTL_REG) |= FSP_MBX_CTL_XUP;
+}
+
+/* Deliver the oldest response if the FSP->host mailbox is free */
+static bool sim_fsp_respond(void)
+{
+	u32 w0, w1;
+
+	if (sim_head == sim_tail)
+		return false;
+	if (SIM_REG(FSP_MBX1_HCTL_REG) & FSP_MBX_CTL_HPEND)
+		return false;
+
+	w0 = sim_pending[sim_head].w0;
+	w1 = sim_pending[sim_head].w1;
+	sim_head = (sim_head + 1) % SIM_MAX_PENDING;
+	sim_outstanding[(w0 & 0xff) - FSP_MCLASS_FIRST]--;
+
+	SIM_REG(FSP_MBX1_FHDR0_REG) = (8 + 4) << 16;
+	SIM_REG(FSP_MBX1_FDATA_AREA) = w0;
+	SIM_REG(FSP_MBX1_FDATA_AREA + 4) = w1 | 0x80;
+	SIM_REG(FSP_MBX1_FDATA_AREA + 8) = 0;
+	SIM_REG(FSP_MBX1_HCTL_REG) |= FSP_MBX_CTL_HPEND;
+	return true;
+}
+
+static inline uint32_t in_be32(const volatile void *addr)
+{
+	u32 reg = (const volatile char *)addr - (const volatile char *)sim_regs;
+
+	sim_accesses++;
+	if (reg == FSP_HDIR_REG || reg == FSP_DISR_REG)
+		return 0;
+	return SIM_REG(reg);
+}
+
+static inline void out_be32(volatile void *addr, uint32_t val)
+{
+	u32 reg = (volatile char *)addr - (volatile char *)sim_regs;
+
+	sim_accesses++;
+	if (reg != FSP_MBX1_HCTL_REG) {
+		SIM_REG(reg) = val;
+		return;
+	}
+
+	/* Status bits are write-one-to-clear */
+	SIM_REG(reg) &= ~(val & (FSP_MBX_CTL_XUP | FSP_MBX_CTL_HPEND));
+	if (val & FSP_MBX_CTL_SPPEND)
+		sim_fsp_receive();
+}
+
+static struct fsp sim_fsp;
+
+static void sim_init(void)
+{
+	int i;
+
+	for (i = 0; i <= (FSP_MCLASS_LAST - FSP_MCLASS_FIRST); i++) {
+		list_head_init(&fsp_cmdclass[i].msgq);
+		list_head_init(&fsp_cmdclass[i].clientq);
+		list_head_init(&fsp_cmdclass[i].rr_queue);
+	}
+	list_head_init(&fsp_cmdclass_rr.msgq);
+	list_head_init(&fsp_cmdclass_rr.clientq);
+	list_head_init(&fsp_cmdclass_rr.rr_queue);
+
+	sim_fsp.link = &sim_fsp;
+	sim_fsp.state = fsp_mbx_idle;
+	sim_fsp.iopath_count = 1;
+	sim_fsp.active_iopath = 0;
+	sim_fsp.iopath[0].state = fsp_path_active;
+	sim_fsp.iopath[0].fsp_regs = sim_regs;
+	sim_fsp.iopath[0].psi = (struct psi *)&sim_fsp;
+	first_fsp = active_fsp = &sim_fsp;
+
+	assert(!pool_init(&fsp_msg_pool, sizeof(struct fsp_msg),
+			  FSP_MSG_POOL_SIZE, 0));
+	fsp_init_msg_stats();
+}
+
+/* Classes used by the heavy FSP users */
+static const u8 burst_classes[] = {
+	FSP_MCLASS_HMC_VT,	/* console */
+	FSP_MCLASS_SMART_CHIP,	/* sensors */
+	FSP_MCLASS_INDICATOR,	/* LEDs */
+	FSP_MCLASS_ERR_LOG,	/* error log write */
+};
+#define NUM_CLASSES	ARRAY_SIZE(burst_classes)
+
+static unsigned int completed[NUM_CLASSES];
+static unsigned int expected_seq[NUM_CLASSES];
+
+static void burst_complete(struct fsp_msg *msg)
+{
+	unsigned int c = (unsigned long)msg->user_data;
+
+	assert(msg->state == fsp_msg_done);
+	assert(msg->resp->state == fsp_msg_response);
+	assert((msg->resp->word1 & 0xff) == ((msg->word1 & 0xff) | 0x80));
+
+	/* Per class FIFO order is preserved */
+	assert(msg->data.words[0] == expected_seq[c]);
+	expected_seq[c]++;
+	completed[c]++;
+
+	fsp_freemsg(msg);
+}
+
+static void run_burst(unsigned int per_class, unsigned int step_tb)
+{
+	unsigned int c, i, total = 0, done;
+	unsigned int accesses = sim_accesses;
+
+	memset(completed, 0, sizeof(completed));
+	memset(expected_seq, 0, sizeof(expected_seq));
+
+	/* Interleave the classes, as concurrent users would */
+	for (i = 0; i < per_class; i++) {
+		for (c = 0; c < NUM_CLASSES; c++) {
+			struct fsp_msg *msg;
+			u32 cmd = 0x1000000 | burst_classes[c] << 16 | 0x01 << 8;
+
+			msg = fsp_mkmsg(cmd, 1, i);
+			assert(msg);
+			msg->user_data = (void *)(unsigned long)c;
+			assert(fsp_queue_msg(msg, burst_complete) == 0);
+			total++;
+		}
+	}
+
+	/* Let the FSP run until everything came back */
+	do {
+		stamp += step_tb;
+		sim_fsp_respond();
+		fsp_interrupt();
+
+		done = 0;
+		for (c = 0; c < NUM_CLASSES; c++)
+			done += completed[c];
+	} while (done < total);
+
+	for (c = 0; c < NUM_CLASSES; c++) {
+		struct fsp_cmdclass *cmdclass =
+			__fsp_get_cmdclass(burst_classes[c]);
+		struct fsp_cmdclass_stats *stats =
+			fsp_get_cmdclass_stats(cmdclass);
+
+		assert(completed[c] == per_class);
+		assert(list_empty(&cmdclass->msgq));
+		assert(!cmdclass->busy);
+		assert(stats->class == burst_classes[c]);
+		assert(be16_to_cpu(stats->depth) == 0);
+		assert(be16_to_cpu(stats->max_depth) >= per_class);
+		assert(be64_to_cpu(stats->max_lat) >= step_tb);
+
+		printf("class %02x: %u msgs, max depth %u, "
+		       "avg lat %llu tb, max lat %llu tb\n",
+		       stats->class, be32_to_cpu(stats->completed),
+		       be16_to_cpu(stats->max_depth),
+		       (unsigned long long)(be64_to_cpu(stats->total_lat) /
+					    be32_to_cpu(stats->completed)),
+		       (unsigned long long)be64_to_cpu(stats->max_lat));
+	}
+	printf("%u msgs, %u mailbox accesses (%.1f per msg)\n", total,
+	       sim_accesses - accesses,
+	       (double)(sim_accesses - accesses) / total);
+
+	assert(sim_head == sim_tail);
+	assert(fsp_msg_pool.free_count == FSP_MSG_POOL_SIZE);
+}
+
+static struct fsp_msg *msgs[FSP_MSG_POOL_SIZE + 1];
+
+int main(void)
+{
+	int i;
+
+	sim_init();
+
+	/* Messages come from the pool first, then from the heap */
+	for (i = 0; i <= FSP_MSG_POOL_SIZE; i++) {
+		msgs[i] = __fsp_allocmsg();
+		assert(msgs[i]);
+		assert(fsp_msg_from_pool(msgs[i]) == (i < FSP_MSG_POOL_SIZE));
+	}
+	assert(fsp_msg_pool.free_count == 0);
+	for (i = 0; i <= FSP_MSG_POOL_SIZE; i++)
+		__fsp_freemsg(msgs[i]);
+	assert(fsp_msg_pool.free_count == FSP_MSG_POOL_SIZE);
+
+	/* Fits in the pool (each message has a response) */
+	run_burst(16, 100);
+
+	/* Overflows the pool, the heap takes the rest */
+	run_burst(100, 10);
+
+	assert(unexpected_calls == 0);
+	return 0;
+}
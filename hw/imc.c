@@ -19,7 +19,9 @@
 #include <imc.h>
 #include <chip.h>
 #include <libxz/xz.h>
+#include <libfdt/libfdt.h>
 #include <device.h>
+#include <timebase.h>
 #include <p9_stop_api.H>
 
 /*
@@ -222,11 +224,9 @@ static int decompress(void *dst, size_t dst_size, void *src, size_t src_size)
 	if (ret != XZ_STREAM_END) {
 		prerror("failed to decompress subpartition\n");
 		ret = -1;
-		goto err;
-	}
+	} else
+		ret = 0;
 
-	return 0;
-err:
 	/* Clean up memory */
 	xz_dec_end(s);
 	return ret;
@@ -352,19 +352,12 @@ static void imc_dt_exports_prop_add(struct dt_node *dev)
 }
 
 /*
- * Remove the PMU device nodes from the incoming new subtree, if they are not
- * available in the hardware. The availability is described by the
- * control block's imc_chip_avl_vector.
- * Each bit represents a device unit. If the device is available, then
- * the bit is set else its unset.
+ * Fetch the nest units availability vector from the IMC control block
+ * of this chip.
  */
-static void disable_unavailable_units(struct dt_node *dev)
+static uint64_t imc_nest_avl_vector(void)
 {
-	uint64_t avl_vec;
 	struct imc_chip_cb *cb;
-	struct dt_node *target;
-	int i;
-	bool disable_all_nests = false;
 	struct proc_chip *chip;
 
 	/*
@@ -373,33 +366,70 @@ static void disable_unavailable_units(struct dt_node *dev)
 	 * in any of the chip.
 	 */
 	for_each_chip(chip) {
-		cb = get_imc_cb(chip->id);
-		if (!cb) {
-			/*
-			 * At least currently, if one chip isn't functioning,
-			 * none of the IMC Nest units will be functional.
-			 * So while you may *think* this should be per chip,
-			 * it isn't.
-			 */
-			disable_all_nests = true;
-			break;
-		}
+		/*
+		 * At least currently, if one chip isn't functioning,
+		 * none of the IMC Nest units will be functional.
+		 * So while you may *think* this should be per chip,
+		 * it isn't.
+		 */
+		if (!get_imc_cb(chip->id))
+			goto no_nest;
 	}
 
+	cb = get_imc_cb(this_cpu()->chip_id);
+	if (cb)
+		return be64_to_cpu(cb->imc_chip_avl_vector);
+
+no_nest:
+	/* Incase of mambo, just fake it */
+	if (proc_chip_quirks & QUIRK_MAMBO_CALLOUTS)
+		return (0xffULL) << 56;
+
+	return 0; /* Remove only nest imc device nodes */
+}
+
+/*
+ * Check whether the nest unit "name" is available according to
+ * "avl_vec", and supported by the microcode.
+ */
+static bool is_nest_unit_available(const char *name, uint64_t avl_vec)
+{
+	int i;
+
+	/* The microcode does not support debug mode function yet */
+	for (i = 0; i < ARRAY_SIZE(debug_mode_units); i++)
+		if (!strcmp(name, debug_mode_units[i]))
+			return false;
+
+	for (i = 0; i < ARRAY_SIZE(nest_pmus); i++)
+		if (!strcmp(name, nest_pmus[i]))
+			return !!(PPC_BITMASK(i, i) & avl_vec);
+
+	for (i = 0; i < MAX_NEST_COMBINED_UNITS; i++)
+		if (!strcmp(name, cu_node[i].name))
+			return !!((cu_node[i].unit1 | cu_node[i].unit2) &
+				  avl_vec);
+
+	return true;
+}
+
+/*
+ * Remove the PMU device nodes from the incoming new subtree, if they are not
+ * available in the hardware. The availability is described by the
+ * control block's imc_chip_avl_vector.
+ * Each bit represents a device unit. If the device is available, then
+ * the bit is set else its unset.
+ */
+static void disable_unavailable_units(struct dt_node *dev)
+{
+	uint64_t avl_vec;
+	struct dt_node *target;
+	int i;
+
 	/* Add a property to "exports" node in opal_node */
 	imc_dt_exports_prop_add(dev);
 
-	/* Fetch the IMC control block structure */
-	cb = get_imc_cb(this_cpu()->chip_id);
-	if (cb && !disable_all_nests)
-		avl_vec = be64_to_cpu(cb->imc_chip_avl_vector);
-	else {
-		avl_vec = 0; /* Remove only nest imc device nodes */
-
-		/* Incase of mambo, just fake it */
-		if (proc_chip_quirks & QUIRK_MAMBO_CALLOUTS)
-			avl_vec = (0xffULL) << 56;
-	}
+	avl_vec = imc_nest_avl_vector();
 
 	for (i = 0; i < ARRAY_SIZE(nest_pmus); i++) {
 		if (!(PPC_BITMASK(i, i) & avl_vec)) {
@@ -504,6 +534,130 @@ static void imc_dt_update_nest_node(struct dt_node *dev)
 	}
 }
 
+struct imc_catalog_filter {
+	uint64_t avl_vec;
+	uint32_t *events;	/* phandles of the event lists in use */
+	unsigned int nr_events;
+	unsigned int grafted;
+	unsigned int skipped;
+};
+
+/* Should the catalog unit at "offset" be advertised ? */
+static bool imc_catalog_unit_wanted(const void *fdt, int offset,
+				    uint64_t avl_vec)
+{
+	const uint32_t *type;
+	int len;
+
+	type = fdt_getprop(fdt, offset, "type", &len);
+	if (!type || len != sizeof(*type))
+		return false;
+
+	switch (fdt32_to_cpu(*type)) {
+	case IMC_COUNTER_CHIP:
+		return is_nest_unit_available(fdt_get_name(fdt, offset, NULL),
+					      avl_vec);
+	case IMC_COUNTER_CORE:
+	case IMC_COUNTER_THREAD:
+		return true;
+	}
+
+	/* Unknown/Unsupported IMC device type */
+	return false;
+}
+
+/*
+ * Collect the phandles of the event lists referenced by the units we
+ * are going to advertise, so the lists of the other units can be left
+ * out of the device tree as well.
+ */
+static int imc_catalog_scan(const void *fdt, struct imc_catalog_filter *f)
+{
+	unsigned int nr_units = 0;
+	const uint32_t *events;
+	int offset, depth = 0, len;
+
+	for (offset = fdt_next_node(fdt, 0, &depth);
+	     offset >= 0 && depth > 0;
+	     offset = fdt_next_node(fdt, offset, &depth))
+		if (depth == 1)
+			nr_units++;
+
+	f->events = zalloc(sizeof(*f->events) * (nr_units + 1));
+	if (!f->events)
+		return -1;
+
+	depth = 0;
+	for (offset = fdt_next_node(fdt, 0, &depth);
+	     offset >= 0 && depth > 0;
+	     offset = fdt_next_node(fdt, offset, &depth)) {
+		if (depth != 1)
+			continue;
+		if (fdt_node_check_compatible(fdt, offset, "ibm,imc-counters"))
+			continue;
+		if (!imc_catalog_unit_wanted(fdt, offset, f->avl_vec))
+			continue;
+
+		events = fdt_getprop(fdt, offset, "events", &len);
+		if (events && len == sizeof(*events))
+			f->events[f->nr_events++] = fdt32_to_cpu(*events);
+	}
+
+	return 0;
+}
+
+static bool imc_catalog_filter(const void *fdt, int offset, void *data)
+{
+	struct imc_catalog_filter *f = data;
+	uint32_t phandle;
+	unsigned int i;
+
+	if (!fdt_node_check_compatible(fdt, offset, "ibm,imc-counters")) {
+		if (imc_catalog_unit_wanted(fdt, offset, f->avl_vec))
+			goto graft;
+		goto skip;
+	}
+
+	/* Event lists are only needed by the units referencing them */
+	phandle = fdt_get_phandle(fdt, offset);
+	if (!phandle)
+		goto graft;
+	for (i = 0; i < f->nr_events; i++)
+		if (f->events[i] == phandle)
+			goto graft;
+skip:
+	f->skipped++;
+	return false;
+graft:
+	f->grafted++;
+	return true;
+}
+
+/*
+ * Graft the catalog into "dev": the properties of the catalog root,
+ * the supported units that are present and their event lists.
+ */
+static int imc_catalog_expand(struct dt_node *dev, const void *fdt)
+{
+	struct imc_catalog_filter f = { .avl_vec = imc_nest_avl_vector() };
+	int ret;
+
+	if (imc_catalog_scan(fdt, &f)) {
+		prerror("No memory to scan the catalog\n");
+		return -1;
+	}
+
+	ret = dt_expand_node_filtered(dev, fdt, 0, imc_catalog_filter, &f);
+	free(f.events);
+	if (ret < 0)
+		return ret;
+
+	prlog(PR_INFO, "Catalog: %u nodes grafted, %u left out\n",
+	      f.grafted, f.skipped);
+
+	return 0;
+}
+
 /*
  * Load the IMC pnor partition and find the appropriate sub-partition
  * based on the platform's PVR.
@@ -512,8 +666,10 @@ static void imc_dt_update_nest_node(struct dt_node *dev)
  */
 void imc_init(void)
 {
-	void *decompress_buf = NULL;
+	void *decompress_buf = NULL, *catalog;
 	uint32_t pvr = (mfspr(SPR_PVR) & ~(0xf0ff));
+	unsigned long start, decompressed, expanded;
+	uint32_t catalog_size = 0;
 	struct dt_node *dev;
 	int ret;
 
@@ -545,9 +701,11 @@ void imc_init(void)
 	 *
 	 * PNOR -> compressed local buffer (compress_buf)
 	 * compressed local buffer -> decompressed local buf (decompress_buf)
-	 * decompress local buffer -> main device tree
+	 * decompressed local buffer trimmed to its size (decompress_buf)
+	 * supported and available units of decompress_buf -> main device tree
 	 * free compressed local buffer
 	 */
+	start = mftb();
 
 	/*
 	 * Memory for decompression.
@@ -566,20 +724,43 @@ void imc_init(void)
 	if (ret < 0)
 		goto err;
 
+	if (fdt_check_header(decompress_buf)) {
+		prerror("Bad catalog header\n");
+		goto err;
+	}
+
+	/* Give back what the catalog doesn't use of the buffer */
+	catalog_size = fdt_totalsize(decompress_buf);
+	if (catalog_size > MAX_DECOMPRESSED_IMC_DTB_SIZE) {
+		prerror("Bad catalog size %u\n", catalog_size);
+		goto err;
+	}
+	catalog = realloc(decompress_buf, catalog_size);
+	if (catalog)
+		decompress_buf = catalog;
+	decompressed = mftb();
+
 	/* Create a device tree entry for imc counters */
 	dev = dt_new_root("imc-counters");
 	if (!dev)
 		goto err;
 
 	/*
-	 * Attach the new decompress_buf to the imc-counters node.
-	 * dt_expand_node() does sanity checks for fdt_header, piggyback
+	 * Graft the units we advertise to the imc-counters node.
+	 * dt_expand_node_filtered() does sanity checks for fdt_header
 	 */
-	ret = dt_expand_node(dev, decompress_buf, 0);
+	ret = imc_catalog_expand(dev, decompress_buf);
 	if (ret < 0) {
 		dt_free(dev);
 		goto err;
 	}
+	expanded = mftb();
+
+	prlog(PR_INFO, "Catalog: %u bytes (%u saved), decompressed in %lu us, "
+	      "expanded in %lu us\n", catalog_size,
+	      MAX_DECOMPRESSED_IMC_DTB_SIZE - catalog_size,
+	      tb_to_usecs(decompressed - start),
+	      tb_to_usecs(expanded - decompressed));
 
 imc_mambo:
 	/* Check and remove unsupported imc device types */
@@ -623,6 +804,9 @@ imc_mambo:
 		goto err;
 	}
 
+	/* Kept read-only, for the out of band tools */
+	opal_add_export("imc_catalog", decompress_buf, catalog_size);
+
 	free(compress_buf);
 	return;
 err:
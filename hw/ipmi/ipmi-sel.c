@@ -27,6 +27,7 @@
 #include <opal-msg.h>
 #include <debug_descriptor.h>
 #include <occ.h>
+#include <timebase.h>
 
 /* OEM SEL fields */
 #define SEL_OEM_ID_0		0x55
@@ -129,76 +130,64 @@ struct oem_sel {
 
 #define ESEL_HDR_SIZE 7
 
-/* Used for sending PANIC events like abort() path */
-struct ipmi_sel_panic_msg {
-	bool		busy;
-	struct ipmi_msg	*msg;
-	struct lock	lock;
+/* The eSEL message is allocated for the largest request size we take */
+#define ESEL_MAX_REQ_SIZE	0xff
+
+/* How many times an eSEL starts over after losing its reservation */
+#define ESEL_MAX_RESTARTS	3
+
+/*
+ * eSEL uploader. Error logs queue up in pending, and go to the BMC one
+ * after the other through a single message. The PEL is created once,
+ * when its upload starts, and is kept across restarts. The reservation
+ * is kept from one eSEL to the next as long as the BMC accepts it.
+ */
+static struct {
+	struct lock		lock;
+	struct ipmi_msg		*msg;
+	bool			busy;		/* msg is queued or in flight */
+	struct list_head	pending;
+
+	/* The eSEL being uploaded */
+	struct errorlog		*elog;
+	struct errorlog		*panic;		/* A panic commit waits on */
+	uint16_t		reservation_id;
+	uint16_t		record_id;
+	size_t			size;
+	size_t			index;
+	unsigned int		restarts;
+	bool			event_sent;
+
+	unsigned long		coalesced;
+
+	/* SEL record followed by the PEL */
+	char			buf[sizeof(struct sel_record) +
+				    IPMI_MAX_PEL_SIZE];
+} esel = {
+	.lock		= LOCK_UNLOCKED,
+	.pending	= LIST_HEAD_INIT(esel.pending),
 };
-static struct ipmi_sel_panic_msg ipmi_sel_panic_msg;
 
 /* Forward declaration */
 static void ipmi_elog_poll(struct ipmi_msg *msg);
+static void ipmi_elog_error(struct ipmi_msg *msg);
 
 void ipmi_sel_init(void)
 {
 	/* Already done */
-	if (ipmi_sel_panic_msg.msg != NULL)
+	if (esel.msg != NULL)
 		return;
 
-	memset(&ipmi_sel_panic_msg, 0, sizeof(struct ipmi_sel_panic_msg));
-	ipmi_sel_panic_msg.msg = ipmi_mkmsg(IPMI_DEFAULT_INTERFACE,
-					IPMI_RESERVE_SEL, ipmi_elog_poll,
-					NULL, NULL, IPMI_MAX_REQ_SIZE, 2);
-}
-
-/*
- * Allocate IPMI message:
- * For normal event, allocate memory using ipmi_mkmsg and for PANIC
- * event, use pre-allocated buffer.
- */
-static struct ipmi_msg *ipmi_sel_alloc_msg(struct errorlog *elog_buf)
-{
-	struct ipmi_msg *msg = NULL;
-
-	if (elog_buf->event_severity == OPAL_ERROR_PANIC) {
-		/* Called before initialization completes */
-		if (ipmi_sel_panic_msg.msg == NULL) {
-			ipmi_sel_init();	/* Try to allocate IPMI message */
-			if (ipmi_sel_panic_msg.msg == NULL)
-				return NULL;
-		}
-
-		if (ipmi_sel_panic_msg.busy == true)
-			return NULL;
-
-		lock(&ipmi_sel_panic_msg.lock);
-		msg = ipmi_sel_panic_msg.msg;
-		ipmi_sel_panic_msg.busy = true;
-		unlock(&ipmi_sel_panic_msg.lock);
-
-		ipmi_init_msg(msg, IPMI_DEFAULT_INTERFACE, IPMI_RESERVE_SEL,
-				ipmi_elog_poll, elog_buf, IPMI_MAX_REQ_SIZE, 2);
-	} else {
-		msg = ipmi_mkmsg(IPMI_DEFAULT_INTERFACE, IPMI_RESERVE_SEL,
-				ipmi_elog_poll, elog_buf, NULL,
-				IPMI_MAX_REQ_SIZE, 2);
-	}
-
-	return msg;
-}
-
-static void ipmi_sel_free_msg(struct ipmi_msg *msg)
-{
-	if (msg == ipmi_sel_panic_msg.msg) {
-		lock(&ipmi_sel_panic_msg.lock);
-		ipmi_sel_panic_msg.busy = false;
-		unlock(&ipmi_sel_panic_msg.lock);
-	} else {
-		ipmi_free_msg(msg);
-	}
-
-	msg = NULL;
+	/*
+	 * We pass a large request size in to mkmsg so that we have a
+	 * large enough allocation to reuse the message to pass the
+	 * PEL data via a series of partial add commands.
+	 */
+	esel.msg = ipmi_mkmsg(IPMI_DEFAULT_INTERFACE, IPMI_RESERVE_SEL,
+			      ipmi_elog_poll, NULL, NULL,
+			      ESEL_MAX_REQ_SIZE, 2);
+	if (esel.msg)
+		esel.msg->error = ipmi_elog_error;
 }
 
 /* Initialize eSEL record */
@@ -258,172 +247,233 @@ static void ipmi_update_sel_record(uint8_t event_severity, uint16_t esel_record_
 	}
 }
 
-static void ipmi_elog_error(struct ipmi_msg *msg)
+/* Finish the eSEL being uploaded. Called with esel.lock held */
+static void esel_done(bool success)
 {
-	if (msg->cc == IPMI_LOST_ARBITRATION_ERR)
-		/* Retry due to SEL erase */
-		ipmi_queue_msg(msg);
-	else {
-		opal_elog_complete(msg->user_data, false);
-		ipmi_sel_free_msg(msg);
-	}
+	opal_elog_complete(esel.elog, success);
+	if (esel.elog == esel.panic)
+		esel.panic = NULL;
+	esel.elog = NULL;
 }
 
-static void ipmi_log_sel_event_error(struct ipmi_msg *msg)
+/* Take the next error log, and create its PEL */
+static void esel_start(void)
 {
-	if (msg->cc != IPMI_CC_NO_ERROR)
-		prlog(PR_INFO, "SEL: Failed to log SEL event\n");
+	struct errorlog *elog;
+	size_t pel_size;
+
+	while ((elog = list_pop(&esel.pending, struct errorlog, link))) {
+		pel_size = create_pel_log(elog,
+					  esel.buf + sizeof(struct sel_record),
+					  IPMI_MAX_PEL_SIZE);
+		if (pel_size)
+			break;
+		opal_elog_complete(elog, false);
+	}
+	if (!elog)
+		return;
 
-	ipmi_sel_free_msg(msg);
+	ipmi_init_esel_record();
+	memcpy(esel.buf, &sel_record, sizeof(struct sel_record));
+
+	esel.elog = elog;
+	esel.size = pel_size + sizeof(struct sel_record);
+	esel.index = 0;
+	esel.record_id = 0;
+	esel.restarts = 0;
+	esel.event_sent = false;
 }
 
-static void ipmi_log_sel_event_complete(struct ipmi_msg *msg)
+static void esel_fill_chunk(struct ipmi_msg *msg)
 {
-	prlog(PR_INFO, "SEL: New event logged [ID : %x%x]\n", msg->data[1],
-		msg->data[0]);
+	size_t len;
+
+	/* As much as the interface takes, the SEL record included */
+	len = MIN(esel.size - esel.index,
+		  ipmi_max_req_size() - ESEL_HDR_SIZE);
 
-	ipmi_sel_free_msg(msg);
+	ipmi_init_msg(msg, IPMI_DEFAULT_INTERFACE,
+		      bmc_platform->ipmi_oem_partial_add_esel,
+		      ipmi_elog_poll, esel.elog, len + ESEL_HDR_SIZE, 2);
+
+	msg->data[0] = esel.reservation_id & 0xff;
+	msg->data[1] = (esel.reservation_id >> 8) & 0xff;
+	msg->data[2] = esel.record_id & 0xff;
+	msg->data[3] = (esel.record_id >> 8) & 0xff;
+	msg->data[4] = esel.index & 0xff;
+	msg->data[5] = (esel.index >> 8) & 0xff;
+	msg->data[6] = esel.index + len == esel.size;
+	memcpy(&msg->data[ESEL_HDR_SIZE], &esel.buf[esel.index], len);
+
+	esel.index += len;
 }
 
-/* Log SEL event with eSEL record ID */
-static void ipmi_log_sel_event(struct ipmi_msg *msg, uint8_t event_severity,
-				uint16_t esel_record_id)
+/* Point a SEL event at the eSEL that was just added */
+static void esel_fill_event(struct ipmi_msg *msg)
 {
-	/* Fill required SEL event fields */
-	ipmi_update_sel_record(event_severity, esel_record_id);
+	ipmi_update_sel_record(esel.elog->event_severity, esel.record_id);
 
-	/* Fill IPMI message */
 	ipmi_init_msg(msg, IPMI_DEFAULT_INTERFACE, IPMI_ADD_SEL_EVENT,
-		      ipmi_log_sel_event_complete, NULL,
-		      sizeof(struct sel_record), 2);
-
-	/* Copy SEL data */
+		      ipmi_elog_poll, esel.elog, sizeof(struct sel_record), 2);
 	memcpy(msg->data, &sel_record, sizeof(struct sel_record));
 
-	msg->error = ipmi_log_sel_event_error;
-	ipmi_queue_msg_head(msg);
+	esel.event_sent = true;
 }
 
-/* Goes through the required steps to add a complete eSEL:
- *
- *  1. Get a reservation
- *  2. Add eSEL header
- *  3. Partially add data to the SEL
+/*
+ * Fill the message with the next step of the upload, and say whether
+ * it starts an eSEL. Returns false when there's nothing left to send.
+ * Called with esel.lock held.
+ */
+static bool esel_step(struct ipmi_msg *msg, bool *first)
+{
+	for (;;) {
+		if (!esel.elog) {
+			esel_start();
+			if (!esel.elog)
+				return false;
+		}
+
+		*first = !esel.index;
+		if (!esel.reservation_id) {
+			ipmi_init_msg(msg, IPMI_DEFAULT_INTERFACE,
+				      IPMI_RESERVE_SEL, ipmi_elog_poll,
+				      esel.elog, 0, 2);
+			return true;
+		}
+		if (esel.index < esel.size) {
+			esel_fill_chunk(msg);
+			return true;
+		}
+		if (!esel.event_sent) {
+			esel_fill_event(msg);
+			return true;
+		}
+
+		esel_done(true);
+	}
+}
+
+/*
+ * Send the next step of the upload, if any, and drop esel.lock.
  *
  * Because a reservation is needed we need to ensure eSEL's are added
  * as a single transaction as concurrent/interleaved adds would cancel
  * the reservation. We guarantee this by always adding our messages to
  * the head of the transmission queue, blocking any other messages
- * being sent until we have completed sending this message.
+ * being sent until we have completed sending this eSEL. The first
+ * message of an eSEL goes to the back of the queue instead, so that an
+ * error storm doesn't hold up the other IPMI users (the watchdog...).
  *
  * There is still a very small chance that we will accidentally
  * interleave a message if there is another one waiting at the head of
  * the ipmi queue and another cpu calls the ipmi poller before we
- * complete. However this should just cause a resevation cancelled
- * error which we have to deal with anyway (eg. because there may be a
- * SEL erase in progress) so it shouldn't cause any problems.
+ * complete. However this should just cause a reservation cancelled
+ * error, upon which we start the eSEL over.
  */
-static void ipmi_elog_poll(struct ipmi_msg *msg)
+static void esel_send_and_unlock(struct ipmi_msg *msg)
 {
-	static bool first = false;
-	static char pel_buf[IPMI_MAX_PEL_SIZE];
-	static size_t pel_size;
-	static size_t esel_size;
-	static int esel_index = 0;
-	int pel_index;
-	static unsigned int reservation_id = 0;
-	static unsigned int record_id = 0;
-	struct errorlog *elog_buf = (struct errorlog *) msg->user_data;
-	size_t req_size;
+	bool send, first;
+	int rc;
 
-	if (bmc_platform->ipmi_oem_partial_add_esel == 0) {
-		prlog(PR_WARNING, "Dropped eSEL: BMC code is buggy/missing\n");
+	send = esel.busy = esel_step(msg, &first);
+	unlock(&esel.lock);
+	if (!send)
 		return;
+
+	rc = first ? ipmi_queue_msg(msg) : ipmi_queue_msg_head(msg);
+	if (rc) {
+		lock(&esel.lock);
+		esel_done(false);
+		esel.busy = false;
+		unlock(&esel.lock);
 	}
+}
 
-	ipmi_init_esel_record();
+static void ipmi_elog_error(struct ipmi_msg *msg)
+{
+	if (msg->cc == IPMI_LOST_ARBITRATION_ERR) {
+		/* Retry due to SEL erase */
+		ipmi_queue_msg(msg);
+		return;
+	}
+
+	lock(&esel.lock);
+	if (msg->cmd == IPMI_CMD(IPMI_ADD_SEL_EVENT)) {
+		/* The eSEL itself made it */
+		prlog(PR_INFO, "SEL: Failed to log SEL event\n");
+	} else if (msg->cmd == IPMI_CMD(IPMI_RESERVE_SEL)) {
+		esel_done(false);
+	} else {
+		/*
+		 * Someone else got a reservation or the SEL was erased,
+		 * start over with a new one. The PEL is still there.
+		 */
+		esel.reservation_id = 0;
+		if (msg->cc == IPMI_INVALID_RESERVATION_ERR &&
+		    esel.restarts++ < ESEL_MAX_RESTARTS) {
+			esel.index = 0;
+			esel.record_id = 0;
+		} else {
+			esel_done(false);
+		}
+	}
+	esel_send_and_unlock(msg);
+}
+
+static void ipmi_elog_poll(struct ipmi_msg *msg)
+{
+	lock(&esel.lock);
 	if (msg->cmd == IPMI_CMD(IPMI_RESERVE_SEL)) {
-		first = true;
-		reservation_id = msg->data[0];
-		reservation_id |= msg->data[1] << 8;
-		if (!reservation_id) {
+		esel.reservation_id = msg->data[0];
+		esel.reservation_id |= msg->data[1] << 8;
+		if (!esel.reservation_id) {
 			/*
 			 * According to specification we should never
 			 * get here, but just in case we do we cancel
 			 * sending the message.
 			 */
 			prerror("Invalid reservation id");
-			opal_elog_complete(elog_buf, false);
-			ipmi_sel_free_msg(msg);
-			return;
+			esel_done(false);
 		}
-
-		pel_size = create_pel_log(elog_buf, pel_buf, IPMI_MAX_PEL_SIZE);
-		esel_size = pel_size + sizeof(struct sel_record);
-		esel_index = 0;
-		record_id = 0;
-	} else {
-		record_id = msg->data[0];
-		record_id |= msg->data[1] << 8;
-	}
-
-	/* Start or continue the IPMI_PARTIAL_ADD_SEL */
-	if (esel_index >= esel_size) {
-		/*
-		 * We're all done. Invalidate the resevation id to
-		 * ensure we get an error if we cut in on another eSEL
-		 * message.
-		 */
-		reservation_id = 0;
-		esel_index = 0;
-
-		/* Log SEL event and free ipmi message */
-		ipmi_log_sel_event(msg, elog_buf->event_severity, record_id);
-
-		opal_elog_complete(elog_buf, true);
-		return;
-	}
-
-	if ((esel_size - esel_index) <= (IPMI_MAX_REQ_SIZE - ESEL_HDR_SIZE)) {
-		/* Last data to send */
-		msg->data[6] = 1;
-		req_size = esel_size - esel_index + ESEL_HDR_SIZE;
+	} else if (msg->cmd == IPMI_CMD(IPMI_ADD_SEL_EVENT)) {
+		prlog(PR_INFO, "SEL: New event logged [ID : %x%x]\n",
+		      msg->data[1], msg->data[0]);
 	} else {
-		msg->data[6] = 0;
-		req_size = IPMI_MAX_REQ_SIZE;
+		esel.record_id = msg->data[0];
+		esel.record_id |= msg->data[1] << 8;
 	}
+	esel_send_and_unlock(msg);
+}
 
-	ipmi_init_msg(msg, IPMI_DEFAULT_INTERFACE,
-		      bmc_platform->ipmi_oem_partial_add_esel,
-		      ipmi_elog_poll, elog_buf, req_size, 2);
-
-	msg->data[0] = reservation_id & 0xff;
-	msg->data[1] = (reservation_id >> 8) & 0xff;
-	msg->data[2] = record_id & 0xff;
-	msg->data[3] = (record_id >> 8) & 0xff;
-	msg->data[4] = esel_index & 0xff;
-	msg->data[5] = (esel_index >> 8) & 0xff;
-
-	if (first) {
-		first = false;
-		memcpy(&msg->data[ESEL_HDR_SIZE], &sel_record,
-			sizeof(struct sel_record));
-		esel_index = sizeof(struct sel_record);
-		msg->req_size = esel_index + ESEL_HDR_SIZE;
-	} else {
-		pel_index = esel_index - sizeof(struct sel_record);
-		memcpy(&msg->data[ESEL_HDR_SIZE], &pel_buf[pel_index],
-			msg->req_size - ESEL_HDR_SIZE);
-		esel_index += msg->req_size - ESEL_HDR_SIZE;
+/* A log already waiting with the same error, bar the PLID */
+static struct errorlog *esel_find_pending(struct errorlog *elog)
+{
+	struct errorlog *e;
+
+	list_for_each(&esel.pending, e, link) {
+		if (e->component_id == elog->component_id &&
+		    e->error_event_type == elog->error_event_type &&
+		    e->subsystem_id == elog->subsystem_id &&
+		    e->event_severity == elog->event_severity &&
+		    e->event_subtype == elog->event_subtype &&
+		    e->reason_code == elog->reason_code &&
+		    e->user_section_count == elog->user_section_count &&
+		    e->user_section_size == elog->user_section_size &&
+		    !memcmp(e->additional_info, elog->additional_info,
+			    sizeof(e->additional_info)) &&
+		    !memcmp(e->user_data_dump, elog->user_data_dump,
+			    e->user_section_size))
+			return e;
 	}
 
-	ipmi_queue_msg_head(msg);
-	return;
+	return NULL;
 }
 
 int ipmi_elog_commit(struct errorlog *elog_buf)
 {
-	struct ipmi_msg *msg;
+	struct errorlog *dup;
+	bool panic;
 
 	/* Only log events that needs attention */
 	if (elog_buf->event_severity <
@@ -434,23 +484,49 @@ int ipmi_elog_commit(struct errorlog *elog_buf)
 		return 0;
 	}
 
-	/*
-	 * We pass a large request size in to mkmsg so that we have a
-	 * large enough allocation to reuse the message to pass the
-	 * PEL data via a series of partial add commands.
-	 */
-	msg = ipmi_sel_alloc_msg(elog_buf);
-	if (!msg) {
+	if (bmc_platform->ipmi_oem_partial_add_esel == 0) {
+		prlog(PR_WARNING, "Dropped eSEL: BMC code is buggy/missing\n");
 		opal_elog_complete(elog_buf, false);
-		return OPAL_RESOURCE;
+		return 0;
+	}
+
+	/* Called before initialization completes */
+	if (esel.msg == NULL) {
+		ipmi_sel_init();	/* Try to allocate IPMI message */
+		if (esel.msg == NULL) {
+			opal_elog_complete(elog_buf, false);
+			return OPAL_RESOURCE;
+		}
 	}
 
-	msg->error = ipmi_elog_error;
-	msg->req_size = 0;
-	if (elog_buf->event_severity == OPAL_ERROR_PANIC)
-		ipmi_queue_msg_sync(msg);
+	panic = elog_buf->event_severity == OPAL_ERROR_PANIC;
+
+	lock(&esel.lock);
+	dup = panic ? NULL : esel_find_pending(elog_buf);
+	if (dup) {
+		esel.coalesced++;
+		prlog(PR_DEBUG, "SEL: PEL 0x%08x repeats 0x%08x, %lu so far\n",
+		      elog_buf->plid, dup->plid, esel.coalesced);
+		unlock(&esel.lock);
+		opal_elog_complete(elog_buf, true);
+		return 0;
+	}
+
+	/* A panic goes first, and we wait for it to be out */
+	if (panic) {
+		list_add(&esel.pending, &elog_buf->link);
+		esel.panic = elog_buf;
+	} else {
+		list_add_tail(&esel.pending, &elog_buf->link);
+	}
+
+	if (!esel.busy)
+		esel_send_and_unlock(esel.msg);
 	else
-		ipmi_queue_msg(msg);
+		unlock(&esel.lock);
+
+	while (panic && esel.panic == elog_buf)
+		time_wait_ms(100);
 
 	return 0;
 }
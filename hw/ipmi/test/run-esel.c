@@ -0,0 +1,620 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Upload error logs through the eSEL code into a simulated BMC, which
+ * checks the reservations and offsets of the partial adds and keeps
+ * the eSELs it got, and count the IPMI round trips it takes.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <assert.h>
+
+#define __TEST__
+
+#include "../ipmi-sel.c"
+#include "../../../ccan/list/list.c"
+
+/* Single threaded, locks are no-ops */
+void lock_caller(struct lock *l, const char *caller)
+{
+	(void)l;
+	(void)caller;
+}
+
+void unlock(struct lock *l)
+{
+	(void)l;
+}
+
+bool lock_held_by_me(struct lock *l)
+{
+	(void)l;
+	return true;
+}
+
+void _prlog(int log_level, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (log_level > PR_NOTICE)
+		return;
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+}
+
+static const struct bmc_platform sim_bmc_platform = {
+	.name = "sim",
+	.ipmi_oem_partial_add_esel = IPMI_CODE(0x3a, 0xf0),
+};
+const struct bmc_platform *bmc_platform = &sim_bmc_platform;
+
+struct platform platform;
+struct dt_node *dt_root;
+struct debug_descriptor debug_descriptor;
+
+/* The OEM SEL handlers aren't tested here */
+bool flash_reserve(void)
+{
+	return false;
+}
+
+void flash_release(void)
+{
+}
+
+void occ_pnor_set_owner(enum pnor_owner owner)
+{
+	(void)owner;
+}
+
+int _opal_queue_msg(enum opal_msg_type msg_type, void *data,
+		    void (*consumed)(void *data), size_t num_params,
+		    const u64 *params)
+{
+	(void)msg_type;
+	(void)data;
+	(void)consumed;
+	(void)num_params;
+	(void)params;
+	return 0;
+}
+
+struct dt_node *dt_find_by_name(struct dt_node *root, const char *name)
+{
+	(void)root;
+	(void)name;
+	return NULL;
+}
+
+struct dt_node *dt_find_by_name_addr(struct dt_node *parent, const char *name,
+				     uint64_t addr)
+{
+	(void)parent;
+	(void)name;
+	(void)addr;
+	return NULL;
+}
+
+bool dt_has_node_property(const struct dt_node *node, const char *name,
+			  const char *val)
+{
+	(void)node;
+	(void)name;
+	(void)val;
+	return false;
+}
+
+uint32_t dt_get_chip_id(const struct dt_node *node)
+{
+	(void)node;
+	return 0;
+}
+
+void prd_occ_reset(uint32_t proc)
+{
+	(void)proc;
+}
+
+/* The simulated BMC */
+#define SIM_MAX_RECORDS	256
+#define SIM_ESEL_SIZE	(sizeof(struct sel_record) + IPMI_MAX_PEL_SIZE)
+
+struct sim_record {
+	uint16_t	id;
+	bool		event;
+	size_t		size;
+	uint8_t		data[SIM_ESEL_SIZE];
+};
+
+static struct {
+	struct list_head	queue;
+	size_t			max_req_size;
+	uint16_t		reservation_id;
+	uint16_t		next_id;
+
+	/* Partial add in progress */
+	uint16_t		add_id;
+	size_t			add_size;
+	uint8_t			add_data[SIM_ESEL_SIZE];
+
+	unsigned int		nr_records;
+	struct sim_record	records[SIM_MAX_RECORDS];
+
+	/* Cancel the reservation after that many partial adds */
+	int			cancel_after;
+
+	unsigned long		msgs;
+	unsigned long		bytes;
+	unsigned long		reserves;
+	unsigned long		others;
+} sim;
+
+struct ipmi_backend sim_backend;
+struct ipmi_backend *ipmi_backend = &sim_backend;
+
+void ipmi_init_msg(struct ipmi_msg *msg, int interface,
+		   uint32_t code, void (*complete)(struct ipmi_msg *),
+		   void *user_data, size_t req_size, size_t resp_size)
+{
+	assert(interface == IPMI_DEFAULT_INTERFACE);
+
+	msg->backend = ipmi_backend;
+	msg->cmd = IPMI_CMD(code);
+	msg->netfn = IPMI_NETFN(code) << 2;
+	msg->req_size = req_size;
+	msg->resp_size = resp_size;
+	msg->complete = complete;
+	msg->user_data = user_data;
+}
+
+static void sim_free_msg(struct ipmi_msg *msg)
+{
+	free(msg);
+}
+
+struct ipmi_msg *ipmi_mkmsg(int interface, uint32_t code,
+			    void (*complete)(struct ipmi_msg *),
+			    void *user_data, void *req_data, size_t req_size,
+			    size_t resp_size)
+{
+	struct ipmi_msg *msg;
+
+	msg = calloc(1, sizeof(*msg) + (req_size > resp_size ?
+					 req_size : resp_size));
+	msg->data = (uint8_t *)(msg + 1);
+	ipmi_init_msg(msg, interface, code, complete, user_data,
+		      req_size, resp_size);
+	msg->error = sim_free_msg;
+	if (req_data)
+		memcpy(msg->data, req_data, req_size);
+
+	return msg;
+}
+
+struct ipmi_msg *ipmi_mkmsg_simple(uint32_t code, void *req_data,
+				   size_t req_size)
+{
+	return ipmi_mkmsg(IPMI_DEFAULT_INTERFACE, code, sim_free_msg, NULL,
+			  req_data, req_size, 0);
+}
+
+int ipmi_queue_msg(struct ipmi_msg *msg)
+{
+	list_add_tail(&sim.queue, &msg->link);
+	return 0;
+}
+
+int ipmi_queue_msg_head(struct ipmi_msg *msg)
+{
+	list_add(&sim.queue, &msg->link);
+	return 0;
+}
+
+size_t ipmi_max_req_size(void)
+{
+	return sim.max_req_size;
+}
+
+uint8_t ipmi_get_sensor_number(uint8_t sensor_type)
+{
+	return sensor_type + 1;
+}
+
+/* PELs are made of the PLID, so that we can check what the BMC got */
+static unsigned int pels_created;
+
+int create_pel_log(struct errorlog *elog, char *pel_buffer,
+		   size_t pel_buffer_size)
+{
+	size_t i, size = 100 + elog->user_section_size;
+
+	assert(size <= pel_buffer_size);
+	for (i = 0; i < size; i++)
+		pel_buffer[i] = (elog->plid * 7 + i) & 0xff;
+	pels_created++;
+
+	return size;
+}
+
+static unsigned int elogs_ok, elogs_failed;
+
+void opal_elog_complete(struct errorlog *elog, bool success)
+{
+	if (success)
+		elogs_ok++;
+	else
+		elogs_failed++;
+	elog->plid = 0;
+}
+
+static void sim_reply(struct ipmi_msg *msg, uint8_t cc)
+{
+	msg->cc = cc;
+	if (cc)
+		msg->error(msg);
+	else if (msg->complete)
+		msg->complete(msg);
+}
+
+static void sim_partial_add(struct ipmi_msg *msg)
+{
+	uint16_t res = msg->data[0] | msg->data[1] << 8;
+	uint16_t id = msg->data[2] | msg->data[3] << 8;
+	size_t offset = msg->data[4] | msg->data[5] << 8;
+	size_t len = msg->req_size - ESEL_HDR_SIZE;
+	struct sim_record *r;
+
+	if (!res || res != sim.reservation_id) {
+		sim_reply(msg, IPMI_INVALID_RESERVATION_ERR);
+		return;
+	}
+	if (sim.cancel_after > 0 && !--sim.cancel_after) {
+		sim.reservation_id = 0;
+		sim_reply(msg, IPMI_INVALID_RESERVATION_ERR);
+		return;
+	}
+
+	/* A new record starts at offset 0, then it's in order */
+	if (!offset) {
+		assert(!id);
+		sim.add_id = ++sim.next_id;
+		sim.add_size = 0;
+	} else {
+		assert(id == sim.add_id);
+		assert(offset == sim.add_size);
+	}
+	assert(sim.add_size + len <= SIM_ESEL_SIZE);
+	memcpy(&sim.add_data[sim.add_size], &msg->data[ESEL_HDR_SIZE], len);
+	sim.add_size += len;
+
+	if (msg->data[6]) {
+		assert(sim.nr_records < SIM_MAX_RECORDS);
+		r = &sim.records[sim.nr_records++];
+		r->id = sim.add_id;
+		r->size = sim.add_size;
+		memcpy(r->data, sim.add_data, sim.add_size);
+	}
+
+	msg->data[0] = sim.add_id & 0xff;
+	msg->data[1] = sim.add_id >> 8;
+	msg->resp_size = 2;
+	sim_reply(msg, IPMI_CC_NO_ERROR);
+}
+
+static void sim_add_sel_event(struct ipmi_msg *msg)
+{
+	struct sel_record *sel = (struct sel_record *)msg->data;
+	uint16_t id = sel->event_data2 << 8 | sel->event_data3;
+	unsigned int i;
+
+	assert(msg->req_size == sizeof(*sel));
+	assert(sel->record_type == SEL_REC_TYPE_SYS_EVENT);
+	for (i = 0; i < sim.nr_records; i++) {
+		if (sim.records[i].id == id) {
+			assert(!sim.records[i].event);
+			sim.records[i].event = true;
+			break;
+		}
+	}
+	assert(i < sim.nr_records);
+
+	id = ++sim.next_id;
+	msg->data[0] = id & 0xff;
+	msg->data[1] = id >> 8;
+	msg->resp_size = 2;
+	sim_reply(msg, IPMI_CC_NO_ERROR);
+}
+
+/* Answer one message, the BMC only takes one at a time */
+static bool sim_run_one(void)
+{
+	struct ipmi_msg *msg;
+
+	msg = list_pop(&sim.queue, struct ipmi_msg, link);
+	if (!msg)
+		return false;
+
+	assert(msg->req_size <= sim.max_req_size);
+	sim.msgs++;
+	sim.bytes += msg->req_size + 4;
+
+	if (msg->netfn >> 2 == IPMI_NETFN_STORAGE &&
+	    msg->cmd == IPMI_CMD(IPMI_RESERVE_SEL)) {
+		sim.reserves++;
+		sim.reservation_id = ++sim.next_id;
+		msg->data[0] = sim.reservation_id & 0xff;
+		msg->data[1] = sim.reservation_id >> 8;
+		msg->resp_size = 2;
+		sim_reply(msg, IPMI_CC_NO_ERROR);
+	} else if (msg->netfn >> 2 == IPMI_NETFN_STORAGE &&
+		   msg->cmd == IPMI_CMD(IPMI_ADD_SEL_EVENT)) {
+		sim_add_sel_event(msg);
+	} else if (msg->netfn >> 2 == 0x3a && msg->cmd == 0xf0) {
+		sim_partial_add(msg);
+	} else {
+		sim.others++;
+		msg->resp_size = 0;
+		sim_reply(msg, IPMI_CC_NO_ERROR);
+	}
+
+	return true;
+}
+
+static void sim_run(void)
+{
+	while (sim_run_one())
+		;
+}
+
+/* A panic commit waits for its eSEL, let the BMC answer meanwhile */
+void time_wait_ms(unsigned long ms)
+{
+	(void)ms;
+	assert(sim_run_one());
+}
+
+static void sim_reset(size_t max_req_size)
+{
+	memset(&sim, 0, sizeof(sim));
+	list_head_init(&sim.queue);
+	sim.max_req_size = max_req_size;
+	pels_created = elogs_ok = elogs_failed = 0;
+	esel.reservation_id = 0;
+	esel.coalesced = 0;
+}
+
+static struct errorlog *make_elog(uint32_t plid, uint8_t severity,
+				  uint32_t reason, size_t user_size)
+{
+	struct errorlog *elog = calloc(1, sizeof(*elog));
+
+	elog->plid = plid;
+	elog->event_severity = severity;
+	elog->elog_origin = ORG_SAPPHIRE;
+	elog->reason_code = reason;
+	elog->user_section_size = user_size;
+	memset(elog->user_data_dump, reason & 0xff, user_size);
+
+	return elog;
+}
+
+/* Check the BMC got the SEL record and the PEL of @plid as record @i */
+static void check_record(unsigned int i, uint32_t plid, size_t user_size)
+{
+	struct sim_record *r = &sim.records[i];
+	struct sel_record *sel = (struct sel_record *)r->data;
+	size_t j, pel = 100 + user_size;
+
+	assert(r->event);
+	assert(r->size == sizeof(*sel) + pel);
+	assert(sel->record_type == SEL_REC_TYPE_AMI_ESEL);
+	for (j = 0; j < pel; j++)
+		assert(r->data[sizeof(*sel) + j] == ((plid * 7 + j) & 0xff));
+}
+
+/* Round trips of the old uploader: reserve, SEL record, 53B chunks, event */
+static unsigned long old_round_trips(size_t pel_size)
+{
+	size_t chunk = IPMI_MAX_REQ_SIZE - ESEL_HDR_SIZE;
+
+	return 2 + (pel_size + chunk - 1) / chunk + 1;
+}
+
+#define STORM		64
+#define STORM_USER	600
+
+static void test_storm(size_t max_req_size)
+{
+	struct errorlog *elogs[STORM];
+	size_t pel = 100 + STORM_USER, chunk;
+	unsigned long expected;
+	unsigned int i;
+
+	sim_reset(max_req_size);
+
+	/* They all come in before the BMC gets to answer */
+	for (i = 0; i < STORM; i++) {
+		elogs[i] = make_elog(i + 1, OPAL_UNRECOVERABLE_ERR_GENERAL,
+				     0x1000 + i, STORM_USER);
+		assert(ipmi_elog_commit(elogs[i]) == 0);
+	}
+	sim_run();
+
+	assert(elogs_ok == STORM && !elogs_failed);
+	assert(pels_created == STORM);
+	assert(sim.nr_records == STORM);
+	for (i = 0; i < STORM; i++)
+		check_record(i, i + 1, STORM_USER);
+
+	/* One reservation, then the chunks and the event of each eSEL */
+	chunk = max_req_size - ESEL_HDR_SIZE;
+	expected = 1 + STORM * ((sizeof(struct sel_record) + pel +
+				 chunk - 1) / chunk + 1);
+	assert(sim.reserves == 1);
+	assert(sim.msgs == expected);
+
+	printf("%zuB requests: %lu round trips for %u PELs (%.1f each, "
+	       "%lu before), %lu bytes\n", max_req_size, sim.msgs, STORM,
+	       (double)sim.msgs / STORM, STORM * old_round_trips(pel),
+	       sim.bytes);
+
+	for (i = 0; i < STORM; i++)
+		free(elogs[i]);
+}
+
+/* Other IPMI users get their turn between two eSELs */
+static void test_interleave(void)
+{
+	struct errorlog *a, *b;
+	struct ipmi_msg *other;
+
+	sim_reset(IPMI_MAX_REQ_SIZE);
+
+	a = make_elog(1, OPAL_UNRECOVERABLE_ERR_GENERAL, 0x10, 200);
+	b = make_elog(2, OPAL_UNRECOVERABLE_ERR_GENERAL, 0x20, 200);
+	ipmi_elog_commit(a);
+	ipmi_elog_commit(b);
+
+	/* Queued while a is going out, it goes before b starts */
+	sim_run_one();
+	sim_run_one();
+	other = ipmi_mkmsg_simple(IPMI_RESET_WDT, NULL, 0);
+	ipmi_queue_msg(other);
+	while (sim.records[0].event == false)
+		assert(sim_run_one());
+	assert(sim.others == 0);
+	assert(sim_run_one());
+	assert(sim.others == 1);
+	sim_run();
+
+	assert(elogs_ok == 2 && !elogs_failed);
+	check_record(0, 1, 200);
+	check_record(1, 2, 200);
+	free(a);
+	free(b);
+}
+
+/* Repeats of a log that's still waiting are dropped */
+static void test_coalesce(void)
+{
+	struct errorlog *elogs[10], *other;
+	unsigned int i;
+
+	sim_reset(IPMI_MAX_REQ_SIZE);
+
+	for (i = 0; i < 10; i++) {
+		elogs[i] = make_elog(i + 1, OPAL_UNRECOVERABLE_ERR_GENERAL,
+				     0x42, 64);
+		ipmi_elog_commit(elogs[i]);
+	}
+	other = make_elog(11, OPAL_UNRECOVERABLE_ERR_GENERAL, 0x43, 64);
+	ipmi_elog_commit(other);
+	sim_run();
+
+	/* The first was on its way already, the second one waits */
+	assert(esel.coalesced == 8);
+	assert(elogs_ok == 11 && !elogs_failed);
+	assert(sim.nr_records == 3);
+	check_record(0, 1, 64);
+	check_record(1, 2, 64);
+	check_record(2, 11, 64);
+
+	printf("coalesced %lu repeats into %u eSELs\n", esel.coalesced,
+	       sim.nr_records);
+	for (i = 0; i < 10; i++)
+		free(elogs[i]);
+	free(other);
+}
+
+/* Losing the reservation starts the eSEL over, with the same PEL */
+static void test_cancel(void)
+{
+	struct errorlog *a, *b;
+
+	sim_reset(IPMI_MAX_REQ_SIZE);
+	sim.cancel_after = 4;
+
+	a = make_elog(1, OPAL_UNRECOVERABLE_ERR_GENERAL, 0x10, 300);
+	b = make_elog(2, OPAL_UNRECOVERABLE_ERR_GENERAL, 0x20, 300);
+	ipmi_elog_commit(a);
+	ipmi_elog_commit(b);
+	sim_run();
+
+	assert(elogs_ok == 2 && !elogs_failed);
+	assert(pels_created == 2);
+	assert(sim.reserves == 2);
+	assert(sim.nr_records == 2);
+	check_record(0, 1, 300);
+	check_record(1, 2, 300);
+
+	/* A BMC that keeps cancelling gets the log failed, not a loop */
+	sim_reset(IPMI_MAX_REQ_SIZE);
+	a->plid = 3;
+	ipmi_elog_commit(a);
+	while (sim_run_one())
+		sim.reservation_id = 0;
+	assert(elogs_failed == 1 && !elogs_ok);
+	assert(sim.reserves == ESEL_MAX_RESTARTS + 1);
+
+	free(a);
+	free(b);
+}
+
+/* A panic goes ahead of the waiting logs, and is out on return */
+static void test_panic(void)
+{
+	struct errorlog *a, *b, *p;
+
+	sim_reset(IPMI_MAX_REQ_SIZE);
+
+	a = make_elog(1, OPAL_UNRECOVERABLE_ERR_GENERAL, 0x10, 100);
+	b = make_elog(2, OPAL_UNRECOVERABLE_ERR_GENERAL, 0x20, 100);
+	p = make_elog(3, OPAL_ERROR_PANIC, 0x30, 100);
+	ipmi_elog_commit(a);
+	ipmi_elog_commit(b);
+	ipmi_elog_commit(p);
+
+	assert(elogs_ok == 2 && sim.nr_records == 2);
+	check_record(0, 1, 100);
+	check_record(1, 3, 100);
+
+	sim_run();
+	assert(elogs_ok == 3 && !elogs_failed);
+	check_record(2, 2, 100);
+	free(a);
+	free(b);
+	free(p);
+}
+
+int main(void)
+{
+	ipmi_sel_init();
+	assert(esel.msg);
+
+	test_storm(IPMI_MAX_REQ_SIZE);
+	test_storm(252);
+	test_interleave();
+	test_coalesce();
+	test_cancel();
+	test_panic();
+
+	free(esel.msg);
+	return 0;
+}
@@ -68,6 +68,8 @@ static uint32_t uart_base;
 static bool has_irq = false, irq_ok, rx_full, tx_full;
 static uint8_t tx_room;
 static uint8_t cached_ier;
+static unsigned long tx_char_tb;
+static unsigned long tx_drained_tb;
 static void *mmio_uart_base;
 static int uart_console_policy = UART_CONSOLE_OPAL;
 static int lpc_irq = -1;
@@ -113,18 +115,44 @@ static void uart_check_tx_room(void)
 	}
 }
 
+/* Also track when the FIFO should be empty again at the line rate */
+static void uart_send(uint8_t c)
+{
+	unsigned long now = mftb();
+
+	if (tb_compare(now, tx_drained_tb) == TB_AAFTERB)
+		tx_drained_tb = now;
+	tx_drained_tb += tx_char_tb;
+
+	uart_write(REG_THR, c);
+	tx_room--;
+}
+
+/*
+ * Every LSR read is an LPC cycle, as slow as sending a byte, so rather
+ * than polling it back to back we ask once a character went out, which
+ * catches the virtual UARTs that drain faster than their baud rate,
+ * then when the FIFO should have drained at the line rate.
+ */
 static void uart_wait_tx_room(void)
 {
+	unsigned long now = mftb(), end = now + tx_char_tb;
+
+	if (tb_compare(now, tx_drained_tb) != TB_ABEFOREB)
+		end = now;
+
 	while (!tx_room) {
+		smt_lowest();
+		while (tb_compare(mftb(), end) == TB_ABEFOREB &&
+		       !this_cpu()->tb_invalid)
+			barrier();
+		smt_medium();
+
 		uart_check_tx_room();
-		if (!tx_room) {
-			smt_lowest();
-			do {
-				barrier();
-				uart_check_tx_room();
-			} while (!tx_room);
-			smt_medium();
-		}
+
+		end = mftb() + tx_char_tb;
+		if (tb_compare(tx_drained_tb, end) == TB_AAFTERB)
+			end = tx_drained_tb;
 	}
 }
 
@@ -159,7 +187,90 @@ bool uart_enabled(void)
 
 /*
  * Internal console driver (output only)
+ *
+ * The output goes through a ring which uart_con_write() is the only
+ * producer of (console.c never lets two CPUs flush at once), so it is
+ * filled without uart_lock. uart_tx_burst() drains it under the lock,
+ * as much as the FIFO takes at a time.
+ *
+ * Until the interrupt is known to work, and after a crash, writes wait
+ * for the ring to drain like they always did. Once it works, they only
+ * queue, and the THRE interrupt and the poller push the rest out. If
+ * the ring fills up then, the overflow is dropped rather than spun on,
+ * and a note with the count goes out once there's room again. The
+ * in-memory console keeps everything anyway.
  */
+#define TX_RING_SIZE	0x2000
+static uint8_t tx_ring[TX_RING_SIZE];
+static uint32_t tx_prod;
+static uint32_t tx_cons;
+static uint32_t tx_dropped;
+static uint64_t tx_dropped_total;
+
+static uint32_t uart_tx_ring_space(void)
+{
+	return TX_RING_SIZE - 1 -
+		(tx_prod + TX_RING_SIZE - tx_cons) % TX_RING_SIZE;
+}
+
+/* Producer side, no lock */
+static size_t uart_tx_ring_put(const char *buf, size_t len)
+{
+	uint32_t prod = tx_prod;
+	size_t i, space = uart_tx_ring_space();
+
+	if (len > space)
+		len = space;
+	for (i = 0; i < len; i++) {
+		tx_ring[prod] = buf[i];
+		prod = (prod + 1) % TX_RING_SIZE;
+	}
+
+	/* Order the data before the index, see uart_tx_burst() */
+	lwsync();
+	tx_prod = prod;
+
+	return len;
+}
+
+static void uart_tx_note_dropped(void)
+{
+	char note[64];
+	int n;
+
+	if (!tx_dropped)
+		return;
+
+	n = snprintf(note, sizeof(note),
+		     "\n[UART: %u bytes dropped, %llu total]\n",
+		     tx_dropped, (unsigned long long)tx_dropped_total);
+	if (uart_tx_ring_space() < (uint32_t)n)
+		return;
+	uart_tx_ring_put(note, n);
+	tx_dropped = 0;
+}
+
+/* Fill the FIFO from the ring, uart_lock must be held */
+static void uart_tx_burst(void)
+{
+	uint32_t prod = tx_prod;
+
+	if (prod == tx_cons)
+		return;
+
+	/* Read the index before the data, see uart_tx_ring_put() */
+	lwsync();
+
+	if (!tx_room)
+		uart_check_tx_room();
+	while (tx_room && tx_cons != prod) {
+		uart_send(tx_ring[tx_cons]);
+		tx_cons = (tx_cons + 1) % TX_RING_SIZE;
+	}
+}
+
+static int64_t uart_con_flush(void);
+
 static size_t uart_con_write(const char *buf, size_t len)
 {
 	size_t written = 0;
@@ -168,20 +279,34 @@ static size_t uart_con_write(const char *buf, size_t len)
 	if (!lpc_ok() && !mmio_uart_base)
 		return written;
 
-	lock(&uart_lock);
-	while(written < len) {
-		if (tx_room == 0) {
-			uart_wait_tx_room();
-			if (tx_room == 0)
-				goto bail;
-		} else {
-			uart_write(REG_THR, buf[written++]);
-			tx_room--;
+	/* Nothing else is going to drain the ring once we've crashed */
+	if (!irq_ok || bust_locks) {
+		lock(&uart_lock);
+		while (written < len || tx_prod != tx_cons) {
+			written += uart_tx_ring_put(buf + written,
+						    len - written);
+			uart_tx_burst();
+			if (tx_prod != tx_cons)
+				uart_wait_tx_room();
 		}
+		unlock(&uart_lock);
+		return written;
 	}
- bail:
-	unlock(&uart_lock);
-	return written;
+
+	uart_tx_note_dropped();
+	written = uart_tx_ring_put(buf, len);
+	if (written < len) {
+		tx_dropped += len - written;
+		tx_dropped_total += len - written;
+	}
+
+	/* Whoever holds the lock is flushing already */
+	if (try_lock(&uart_lock)) {
+		uart_con_flush();
+		unlock(&uart_lock);
+	}
+
+	return len;
 }
 
 static struct con_ops uart_con_driver = {
@@ -224,6 +349,9 @@ static int64_t uart_con_flush(void)
 	bool tx_was_full = tx_full;
 	uint32_t out_buf_cons_initial = out_buf_cons;
 
+	/* The internal console goes first, it's usually older */
+	uart_tx_burst();
+
 	while(out_buf_prod != out_buf_cons) {
 		if (tx_room == 0) {
 			/*
@@ -237,14 +365,12 @@ static int64_t uart_con_flush(void)
 			else
 				uart_wait_tx_room();
 		}
-		if (tx_room == 0) {
-			tx_full = true;
+		if (tx_room == 0)
 			break;
-		}
-		uart_write(REG_THR, out_buf[out_buf_cons++]);
+		uart_send(out_buf[out_buf_cons++]);
 		out_buf_cons %= OUT_BUF_SIZE;
-		tx_room--;
 	}
+	tx_full = out_buf_prod != out_buf_cons || tx_prod != tx_cons;
 	if (tx_full != tx_was_full)
 		uart_update_ier();
 	if (out_buf_prod != out_buf_cons) {
@@ -536,6 +662,9 @@ static bool uart_init_hw(unsigned int speed, unsigned int clock)
 {
 	unsigned int dll = (clock / 16) / speed;
 
+	/* 8N1 is 10 bits a character */
+	tx_char_tb = tb_hz * 10 / speed;
+
 	/* Clear line control */
 	uart_write(REG_LCR, 0x00);
 
@@ -432,9 +432,19 @@ DEFINE_PROCEDURE(phy_reset, phy_reset_wait, phy_reset_complete);
 /* Procedure 1.2.6 - I/O PHY Tx Impedance Calibration */
 static uint32_t phy_tx_zcal(struct npu2_dev *ndev)
 {
+	struct npu2_dev *owner = ndev->npu->tx_zcal_owner[ndev->index > 2];
+
 	if (ndev->npu->tx_zcal_complete[ndev->index > 2])
 		return PROCEDURE_COMPLETE;
 
+	/* The bricks of a PHY share its calibration. If another brick
+	 * is running it, wait for it to finish rather than restart it */
+	if (owner && owner != ndev && owner->procedure_number == 5 &&
+	    owner->procedure_step > 0 &&
+	    !(owner->procedure_status & PROCEDURE_COMPLETE))
+		return PROCEDURE_INPROGRESS;
+	ndev->npu->tx_zcal_owner[ndev->index > 2] = ndev;
+
 	/* Turn off SW enable and enable zcal state machine */
 	phy_write(ndev, &NPU2_PHY_TX_ZCAL_SWO_EN, 0);
 
@@ -808,22 +818,30 @@ static uint32_t get_procedure_status(struct npu2_dev *dev)
 	uint16_t procedure = dev->procedure_number;
 	uint16_t step = dev->procedure_step;
 	const char *name = npu_procedures[procedure]->name;
+	unsigned long now;
 
 	do {
 		result = npu_procedures[procedure]->steps[step](dev);
 
-		if (result & PROCEDURE_NEXT) {
-			step++;
-			NPU2DEVINF(dev, "Running procedure %s step %d\n", name, step);
+		if (result & (PROCEDURE_NEXT | PROCEDURE_COMPLETE)) {
+			now = mftb();
+			NPU2DEVINF(dev, "Procedure %s step %d took %lu us\n",
+				   name, step,
+				   tb_to_usecs(now - dev->procedure_step_tb));
+			dev->procedure_step_tb = now;
 		}
+		if (result & PROCEDURE_NEXT)
+			step++;
 	} while (result & PROCEDURE_NEXT);
 
 	dev->procedure_step = step;
 
 	if (result & PROCEDURE_COMPLETE)
-		NPU2DEVINF(dev, "Procedure %s complete\n", name);
+		NPU2DEVINF(dev, "Procedure %s complete in %lu us\n", name,
+			   tb_to_usecs(mftb() - dev->procedure_tb));
 	else if (mftb() > dev->procedure_tb + msecs_to_tb(1000)) {
-		NPU2DEVINF(dev, "Procedure %s timed out\n", name);
+		NPU2DEVINF(dev, "Procedure %s timed out in step %d\n",
+			   name, step);
 		result = PROCEDURE_COMPLETE | PROCEDURE_FAILED;
 	}
 
@@ -833,6 +851,16 @@ static uint32_t get_procedure_status(struct npu2_dev *dev)
 	return dev->procedure_status;
 }
 
+static void start_procedure(struct npu2_dev *dev, uint16_t procedure_number)
+{
+	dev->procedure_status = PROCEDURE_INPROGRESS;
+	dev->procedure_number = procedure_number;
+	dev->procedure_step = 0;
+	dev->procedure_data = 0;
+	dev->procedure_tb = mftb();
+	dev->procedure_step_tb = dev->procedure_tb;
+}
+
 static int64_t npu_dev_procedure_read(struct npu2_dev *dev, uint32_t offset,
 				      uint32_t size, uint32_t *data)
 {
@@ -904,11 +932,7 @@ static int64_t npu_dev_procedure_write(struct npu2_dev *dev, uint32_t offset,
 		else
 			NPU2DEVINF(dev, "Starting procedure %s\n", name);
 
-		dev->procedure_status = PROCEDURE_INPROGRESS;
-		dev->procedure_number = data;
-		dev->procedure_step = 0;
-		dev->procedure_data = 0;
-		dev->procedure_tb = mftb();
+		start_procedure(dev, data);
 		break;
 
 	default:
@@ -945,31 +969,12 @@ void npu2_dev_procedure_reset(struct npu2_dev *dev)
 	npu2_clear_link_flag(dev, NPU2_DEV_DL_RESET);
 }
 
-static uint32_t run_procedure(struct npu2_dev *dev, uint16_t procedure_number)
-{
-	struct procedure *proc;
-	const char *name;
-	uint32_t result;
-
-	assert(procedure_number <= ARRAY_SIZE(npu_procedures));
-	proc = npu_procedures[procedure_number];
-	assert(proc);
-
-	name = proc->name;
-	NPU2DEVINF(dev, "Running procedure %s\n", name);
-	dev->procedure_status = PROCEDURE_INPROGRESS;
-	dev->procedure_number = procedure_number;
-	dev->procedure_step = 0;
-	dev->procedure_data = 0;
-	dev->procedure_tb = mftb();
-
-	result = get_procedure_status(dev);
-	while (!(result & PROCEDURE_COMPLETE)) {
-		time_wait_ms(1);
-		result = get_procedure_status(dev);
-	}
-	return result;
-}
+/* The procedures of the OpenCAPI PHY setup, in order */
+static const uint16_t opencapi_phy_setup[] = {
+	4,	/* procedure_phy_reset */
+	5,	/* procedure_phy_tx_zcal */
+	6,	/* procedure_phy_rx_dccal */
+};
 
 void npu2_opencapi_bump_ui_lane(struct npu2_dev *dev)
 {
@@ -1007,11 +1012,61 @@ void npu2_opencapi_bump_ui_lane(struct npu2_dev *dev)
 	}
 }
 
-void npu2_opencapi_phy_setup(struct npu2_dev *dev)
+void npu2_opencapi_phy_setup_start(struct npu2_dev *dev)
 {
-	run_procedure(dev, 4); /* procedure_phy_reset */
-	run_procedure(dev, 5); /* procedure_phy_tx_zcal */
-	run_procedure(dev, 6); /* procedure_phy_rx_dccal */
+	NPU2DEVINF(dev, "Starting PHY setup\n");
+	dev->phy_setup_next = 1;
+	start_procedure(dev, opencapi_phy_setup[0]);
+}
+
+/*
+ * Run the PHY setup of a brick as far as it can go without waiting on
+ * the hardware. Returns true once all of its procedures are complete.
+ * As before, a failed procedure doesn't stop the setup, the link
+ * training that follows reports the failure.
+ */
+bool npu2_opencapi_phy_setup_poll(struct npu2_dev *dev)
+{
+	for (;;) {
+		if (!(dev->procedure_status & PROCEDURE_COMPLETE))
+			get_procedure_status(dev);
+		if (!(dev->procedure_status & PROCEDURE_COMPLETE))
+			return false;
+		if (dev->phy_setup_next == ARRAY_SIZE(opencapi_phy_setup))
+			return true;
+		start_procedure(dev,
+				opencapi_phy_setup[dev->phy_setup_next++]);
+	}
+}
+
+/*
+ * Wait for the PHY setup of all the bricks of an NPU on which it was
+ * started. The bricks move on to their next step as soon as their own
+ * hardware is ready, so this takes as long as the slowest brick rather
+ * than the sum of all of them.
+ */
+void npu2_opencapi_phy_setup_wait(struct npu2 *p)
+{
+	unsigned long start = mftb();
+	struct npu2_dev *dev;
+	uint32_t i;
+	bool done;
+
+	for (;;) {
+		done = true;
+		for (i = 0; i < p->total_devices; i++) {
+			dev = &p->devices[i];
+			if (dev->phy_setup_next &&
+			    !npu2_opencapi_phy_setup_poll(dev))
+				done = false;
+		}
+		if (done)
+			break;
+		time_wait_ms(1);
+	}
+
+	prlog(PR_INFO, "NPU: Chip %d PHY setup took %lu ms\n", p->chip_id,
+	      tb_to_msecs(mftb() - start));
 }
 
 void npu2_opencapi_phy_prbs31(struct npu2_dev *dev)
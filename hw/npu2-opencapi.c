@@ -77,6 +77,7 @@
 #define   OCAPI_SLOT_FRESET_ASSERT_DELAY    (OCAPI_SLOT_FRESET + 3)
 #define   OCAPI_SLOT_FRESET_DEASSERT_DELAY  (OCAPI_SLOT_FRESET + 4)
 #define   OCAPI_SLOT_FRESET_INIT_DELAY      (OCAPI_SLOT_FRESET + 5)
+#define   OCAPI_SLOT_FRESET_PHY_SETUP       (OCAPI_SLOT_FRESET + 6)
 
 #define OCAPI_LINK_TRAINING_RETRIES	2
 #define OCAPI_LINK_TRAINING_TIMEOUT	3000 /* ms */
@@ -1160,7 +1161,16 @@ static int64_t npu2_opencapi_freset(struct pci_slot *slot)
 		}
 		dev->train_need_fence = true;
 		slot->link_retries = OCAPI_LINK_TRAINING_RETRIES;
-		npu2_opencapi_phy_setup(dev);
+		npu2_opencapi_phy_setup_start(dev);
+		pci_slot_set_state(slot, OCAPI_SLOT_FRESET_PHY_SETUP);
+		/* fall-through */
+	case OCAPI_SLOT_FRESET_PHY_SETUP:
+		/*
+		 * Poll rather than wait for the PHY procedures, so the
+		 * other links get on with their own reset meanwhile
+		 */
+		if (!npu2_opencapi_phy_setup_poll(dev))
+			return pci_slot_set_sm_timeout(slot, msecs_to_tb(1));
 		/* fall-through */
 	case OCAPI_SLOT_FRESET_INIT:
 		reset_odl(chip_id, dev);
@@ -1556,21 +1566,30 @@ static int setup_irq(struct npu2 *p)
 	return 0;
 }
 
-static void setup_debug_training_state(struct npu2_dev *dev)
+static void setup_debug_training_state(struct npu2 *n)
 {
-	npu2_opencapi_phy_setup(dev);
+	struct npu2_dev *dev;
+	uint32_t i;
 
-	switch (npu2_ocapi_training_state) {
-	case NPU2_TRAIN_PRBS31:
-		OCAPIINF(dev, "sending PRBS31 pattern per NVRAM setting\n");
-		npu2_opencapi_phy_prbs31(dev);
-		break;
+	npu2_opencapi_phy_setup_wait(n);
 
-	case NPU2_TRAIN_NONE:
-		OCAPIINF(dev, "link not trained per NVRAM setting\n");
-		break;
-	default:
-		assert(false);
+	for (i = 0; i < n->total_devices; i++) {
+		dev = &n->devices[i];
+		if (!dev->phy_setup_next)
+			continue;
+
+		switch (npu2_ocapi_training_state) {
+		case NPU2_TRAIN_PRBS31:
+			OCAPIINF(dev, "sending PRBS31 pattern per NVRAM setting\n");
+			npu2_opencapi_phy_prbs31(dev);
+			break;
+
+		case NPU2_TRAIN_NONE:
+			OCAPIINF(dev, "link not trained per NVRAM setting\n");
+			break;
+		default:
+			assert(false);
+		}
 	}
 }
 
@@ -1667,7 +1686,9 @@ static void npu2_opencapi_setup_device(struct dt_node *dn_link, struct npu2 *n,
 	set_fence_control(n->chip_id, n->xscom_base, dev->index, 0b00);
 
 	if (npu2_ocapi_training_state != NPU2_TRAIN_DEFAULT) {
-		setup_debug_training_state(dev);
+		/* Finished along with the other links in
+		 * setup_debug_training_state() */
+		npu2_opencapi_phy_setup_start(dev);
 	} else {
 		slot = npu2_opencapi_slot_create(&dev->phb_ocapi);
 		if (!slot) {
@@ -1757,6 +1778,9 @@ static void npu2_opencapi_probe(struct dt_node *dn)
 		i++;
 	}
 
+	if (npu2_ocapi_training_state != NPU2_TRAIN_DEFAULT)
+		setup_debug_training_state(n);
+
 	return;
 failed:
 	free(n);
@@ -859,7 +859,7 @@ static void npu2_mcd_init(struct npu2 *p)
 static void npu2_hw_init(struct npu2 *p)
 {
 	uint64_t reg, val;
-	int s, b;
+	int s, b, i;
 
 	npu2_ioda_reset(&p->phb_nvlink, false);
 
@@ -870,6 +870,16 @@ static void npu2_hw_init(struct npu2 *p)
 	val = npu2_read(p, NPU2_XTS_CFG2);
 	npu2_write(p, NPU2_XTS_CFG2, val | NPU2_XTS_CFG2_NO_FLUSH_ENA);
 
+	/*
+	 * Load the XTS table cache, the tables aren't reset and may
+	 * still hold the entries of a previous boot.
+	 */
+	BUILD_ASSERT(ARRAY_SIZE(p->xts_bdf_cache) == NPU2_XTS_BDF_MAP_SIZE);
+	for (i = 0; i < NPU2_XTS_BDF_MAP_SIZE; i++) {
+		p->xts_bdf_cache[i] = npu2_read(p, NPU2_XTS_BDF_MAP + i*8);
+		p->xts_pid_cache[i] = npu2_read(p, NPU2_XTS_PID_MAP + i*0x20);
+	}
+
 	/*
 	 * There are three different ways we configure the MCD and memory map.
 	 * 1) Old way
@@ -2039,21 +2049,19 @@ void probe_npu2(void)
 }
 
 /*
- * Search a table for an entry with matching value under mask. Returns
- * the index and the current value in *value.
+ * Search the XTS BDF map cache for an entry with matching value under
+ * mask. Returns the index and the current value in *value.
  */
-static int npu_table_search(struct npu2 *p, uint64_t table_addr, int stride,
-			    int table_size, uint64_t *value, uint64_t mask)
+static int npu2_xts_bdf_search(struct npu2 *p, uint64_t *value, uint64_t mask)
 {
 	int i;
-	uint64_t val;
 
 	assert(value);
+	assert(lock_held_by_me(&p->lock));
 
-	for (i = 0; i < table_size; i++) {
-		val = npu2_read(p, table_addr + i*stride);
-		if ((val & mask) == *value) {
-			*value = val;
+	for (i = 0; i < ARRAY_SIZE(p->xts_bdf_cache); i++) {
+		if ((p->xts_bdf_cache[i] & mask) == *value) {
+			*value = p->xts_bdf_cache[i];
 			return i;
 		}
 	}
@@ -2061,6 +2069,20 @@ static int npu_table_search(struct npu2 *p, uint64_t table_addr, int stride,
 	return -1;
 }
 
+static void npu2_xts_bdf_write(struct npu2 *p, int id, uint64_t val)
+{
+	NPU2DBG(p, "XTS_BDF_MAP[%03d] = 0x%08llx\n", id, val);
+	p->xts_bdf_cache[id] = val;
+	npu2_write(p, NPU2_XTS_BDF_MAP + id*8, val);
+}
+
+static void npu2_xts_pid_write(struct npu2 *p, int id, uint64_t val)
+{
+	NPU2DBG(p, "XTS_PID_MAP[%03d] = 0x%08llx\n", id, val);
+	p->xts_pid_cache[id] = val;
+	npu2_write(p, NPU2_XTS_PID_MAP + id*0x20, val);
+}
+
 /*
  * Allocate a context ID and initialise the tables with the relevant
  * information. Returns the ID on or error if one couldn't be
@@ -2091,8 +2113,7 @@ static int64_t opal_npu_init_context(uint64_t phb_id, int pasid __unused,
 	p = phb_to_npu2_nvlink(phb);
 	lock(&p->lock);
 	xts_bdf = SETFIELD(NPU2_XTS_BDF_MAP_BDF, 0ul, bdf);
-	if (npu_table_search(p, NPU2_XTS_BDF_MAP, 8, NPU2_XTS_BDF_MAP_SIZE,
-			     &xts_bdf, NPU2_XTS_BDF_MAP_BDF) < 0) {
+	if (npu2_xts_bdf_search(p, &xts_bdf, NPU2_XTS_BDF_MAP_BDF) < 0) {
 		NPU2ERR(p, "LPARID not associated with any GPU\n");
 		id = OPAL_PARAMETER;
 		goto out;
@@ -2125,7 +2146,7 @@ static int64_t opal_npu_init_context(uint64_t phb_id, int pasid __unused,
 	 * Throw an error if the wildcard entry for this bdf is already set
 	 * with different msr bits.
 	 */
-	old_xts_bdf_pid = npu2_read(p, NPU2_XTS_PID_MAP + id*0x20);
+	old_xts_bdf_pid = p->xts_pid_cache[id];
 	if (old_xts_bdf_pid) {
 		if (GETFIELD(NPU2_XTS_PID_MAP_MSR, old_xts_bdf_pid) !=
 		    GETFIELD(NPU2_XTS_PID_MAP_MSR, xts_bdf_pid)) {
@@ -2137,12 +2158,11 @@ static int64_t opal_npu_init_context(uint64_t phb_id, int pasid __unused,
 	}
 
 	/* Write the entry */
-	NPU2DBG(p, "XTS_PID_MAP[%03d] = 0x%08llx\n", id, xts_bdf_pid);
-	npu2_write(p, NPU2_XTS_PID_MAP + id*0x20, xts_bdf_pid);
+	npu2_xts_pid_write(p, id, xts_bdf_pid);
 
 	if (!GETFIELD(NPU2_XTS_BDF_MAP_VALID, xts_bdf)) {
 		xts_bdf = SETFIELD(NPU2_XTS_BDF_MAP_VALID, xts_bdf, 1);
-		npu2_write(p, NPU2_XTS_BDF_MAP + id*8, xts_bdf);
+		npu2_xts_bdf_write(p, id, xts_bdf);
 	}
 
 out:
@@ -2167,8 +2187,7 @@ static int opal_npu_destroy_context(uint64_t phb_id, uint64_t pid __unused,
 
 	/* Need to find lparshort for this bdf */
 	xts_bdf = SETFIELD(NPU2_XTS_BDF_MAP_BDF, 0ul, bdf);
-	if (npu_table_search(p, NPU2_XTS_BDF_MAP, 8, NPU2_XTS_BDF_MAP_SIZE,
-			     &xts_bdf, NPU2_XTS_BDF_MAP_BDF) < 0) {
+	if (npu2_xts_bdf_search(p, &xts_bdf, NPU2_XTS_BDF_MAP_BDF) < 0) {
 		NPU2ERR(p, "LPARID not associated with any GPU\n");
 		rc = OPAL_PARAMETER;
 	}
@@ -2210,13 +2229,11 @@ static int opal_npu_map_lpar(uint64_t phb_id, uint64_t bdf, uint64_t lparid,
 
 	/* Find any existing entries and update them */
 	xts_bdf_lpar = SETFIELD(NPU2_XTS_BDF_MAP_BDF, 0L, bdf);
-	id = npu_table_search(p, NPU2_XTS_BDF_MAP, 8, NPU2_XTS_BDF_MAP_SIZE,
-			      &xts_bdf_lpar, NPU2_XTS_BDF_MAP_BDF);
+	id = npu2_xts_bdf_search(p, &xts_bdf_lpar, NPU2_XTS_BDF_MAP_BDF);
 	if (id < 0) {
 		/* No existing mapping found, find space for a new one */
 		xts_bdf_lpar = 0;
-		id = npu_table_search(p, NPU2_XTS_BDF_MAP, 8, NPU2_XTS_BDF_MAP_SIZE,
-				      &xts_bdf_lpar, -1UL);
+		id = npu2_xts_bdf_search(p, &xts_bdf_lpar, -1UL);
 	}
 
 	if (id < 0) {
@@ -2251,8 +2268,7 @@ static int opal_npu_map_lpar(uint64_t phb_id, uint64_t bdf, uint64_t lparid,
 	xts_bdf_lpar = SETFIELD(NPU2_XTS_BDF_MAP_STACK, xts_bdf_lpar, 0x4 >> (ndev->index / 2));
 	xts_bdf_lpar = SETFIELD(NPU2_XTS_BDF_MAP_BRICK, xts_bdf_lpar, (ndev->index % 2));
 
-	NPU2DBG(p, "XTS_BDF_MAP[%03d] = 0x%08llx\n", id, xts_bdf_lpar);
-	npu2_write(p, NPU2_XTS_BDF_MAP + id*8, xts_bdf_lpar);
+	npu2_xts_bdf_write(p, id, xts_bdf_lpar);
 
 out:
 	unlock(&p->lock);
@@ -22,6 +22,7 @@
 #include <nx.h>
 #include <vas.h>
 #include <opal.h>
+#include <chip-arena.h>
 
 static int nx_cfg_umac_tx_wc(u32 gcid, u64 xcfg)
 {
@@ -134,7 +135,8 @@ int nx_cfg_rx_fifo(struct dt_node *node, const char *compat,
 	u32 lpid = 0xfff; /* All 1's for 12 bits in UMAC notify match reg */
 #define MATCH_ENABLE    1
 
-	fifo = (uint64_t) local_alloc(gcid, RX_FIFO_SIZE, RX_FIFO_SIZE);
+	fifo = (uint64_t)chip_arena_alloc(gcid, "nx-rx-fifo", RX_FIFO_SIZE,
+					 RX_FIFO_SIZE);
 	assert(fifo);
 
 	/*
@@ -114,6 +114,7 @@ static struct str_map {
 };
 
 static u64 occ_sensor_base;
+static int occ_sensor_count;
 
 static inline
 struct occ_sensor_data_header *get_sensor_header_block(int occ_num)
@@ -201,11 +202,18 @@ static u64 read_sensor(struct occ_sensor_record *sensor, int attr)
 	return 0;
 }
 
-static void *select_sensor_buffer(struct occ_sensor_data_header *hb, int id)
+/*
+ * The OCC updates one readings buffer while the other one can be read,
+ * and marks a buffer valid once it is complete. Pick the whole buffer
+ * rather than deciding per sensor, so that all the readings returned
+ * come from the same update. Every record type starts with the gsid and
+ * the timestamp, so the first record of each buffer tells its age.
+ */
+static u8 *select_reading_buffer(struct occ_sensor_data_header *hb, u64 *tb)
 {
 	struct occ_sensor_name *md;
 	u8 *ping, *pong;
-	void *buffer = NULL;
+	u64 tping, tpong;
 
 	if (!hb)
 		return NULL;
@@ -215,6 +223,9 @@ static void *select_sensor_buffer(struct occ_sensor_data_header *hb, int id)
 	ping = (u8 *)((u64)hb + hb->reading_ping_offset);
 	pong = (u8 *)((u64)hb + hb->reading_pong_offset);
 
+	tping = ((struct occ_sensor_record *)(ping + md[0].reading_offset))->timestamp;
+	tpong = ((struct occ_sensor_record *)(pong + md[0].reading_offset))->timestamp;
+
 	/* Check which buffer is valid  and read the data from that.
 	 * Ping Pong	Action
 	 *  0	0	Return with error
@@ -222,32 +233,32 @@ static void *select_sensor_buffer(struct occ_sensor_data_header *hb, int id)
 	 *  1	0	Read Ping
 	 *  1	1	Read the buffer with latest timestamp
 	 */
+	if (*ping && (!*pong || tping > tpong)) {
+		*tb = tping;
+		return ping;
+	}
 
-	if (*ping && *pong) {
-		u64 tping, tpong;
-		u64 ping_buf = (u64)ping + md[id].reading_offset;
-		u64 pong_buf = (u64)pong + md[id].reading_offset;
-
-		tping = ((struct occ_sensor_record *)ping_buf)->timestamp;
-		tpong = ((struct occ_sensor_record *)pong_buf)->timestamp;
-
-		if (tping > tpong)
-			buffer = ping;
-		else
-			buffer = pong;
-	} else if (*ping && !*pong) {
-		buffer = ping;
-	} else if (!*ping && *pong) {
-		buffer = pong;
-	} else if (!*ping && !*pong) {
-		prlog(PR_DEBUG, "OCC: Both ping and pong sensor buffers are invalid\n");
-		return NULL;
+	if (*pong) {
+		*tb = tpong;
+		return pong;
 	}
 
-	assert(buffer);
-	buffer = (void *)((u64)buffer + md[id].reading_offset);
+	prlog(PR_DEBUG, "OCC: Both ping and pong sensor buffers are invalid\n");
+	return NULL;
+}
 
-	return buffer;
+static void *select_sensor_buffer(struct occ_sensor_data_header *hb, int id)
+{
+	struct occ_sensor_name *md;
+	u8 *buffer;
+	u64 tb;
+
+	buffer = select_reading_buffer(hb, &tb);
+	if (!buffer)
+		return NULL;
+
+	md = get_names_block(hb);
+	return buffer + md[id].reading_offset;
 }
 
 int occ_sensor_read(u32 handle, u64 *data)
@@ -290,6 +301,39 @@ int occ_sensor_read(u32 handle, u64 *data)
 	return OPAL_SUCCESS;
 }
 
+/*
+ * opal_occ_sensor_buffer: report which readings buffer of an OCC holds
+ * the latest complete update, as an offset into the "occ_inband_sensors"
+ * export, so that the OS can read all the sensors of that OCC from it
+ * directly instead of going through OPAL_SENSOR_READ for each of them.
+ */
+static int64_t opal_occ_sensor_buffer(u32 occ_num, __be64 *offset,
+				      __be64 *timestamp)
+{
+	struct occ_sensor_data_header *hb;
+	u8 *buffer;
+	u64 tb;
+
+	if (!opal_addr_valid(offset) || !opal_addr_valid(timestamp))
+		return OPAL_PARAMETER;
+
+	if (occ_num >= occ_sensor_count)
+		return OPAL_PARAMETER;
+
+	hb = get_sensor_header_block(occ_num);
+	if (hb->valid != 1)
+		return OPAL_HARDWARE;
+
+	buffer = select_reading_buffer(hb, &tb);
+	if (!buffer)
+		return OPAL_BUSY;
+
+	*offset = cpu_to_be64((u64)buffer - occ_sensor_base);
+	*timestamp = cpu_to_be64(tb);
+
+	return OPAL_SUCCESS;
+}
+
 static bool occ_sensor_sanity(struct occ_sensor_data_header *hb, int chipid)
 {
 	if (hb->valid != 0x01) {
@@ -606,5 +650,8 @@ bool occ_sensors_init(void)
 	dt_add_property_u64s(exports, "occ_inband_sensors", occ_sensor_base,
 			     OCC_SENSOR_DATA_BLOCK_SIZE * occ_num);
 
+	occ_sensor_count = occ_num;
+	opal_register(OPAL_OCC_SENSOR_BUFFER, opal_occ_sensor_buffer, 3);
+
 	return true;
 }
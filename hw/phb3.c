@@ -35,6 +35,7 @@
 #include <fsp.h>
 #include <chip.h>
 #include <chiptod.h>
+#include <chip-arena.h>
 
 /* Enable this to disable error interrupts for debug purposes */
 #undef DISABLE_ERR_INTS
@@ -4387,31 +4388,32 @@ static void phb3_allocate_tables(struct phb3 *p)
 	uint16_t *rte;
 	uint32_t i;
 
-	/* XXX Our current memalign implementation sucks,
-	 *
-	 * It will do the job, however it doesn't support freeing
-	 * the memory and wastes space by always allocating twice
-	 * as much as requested (size + alignment)
-	 */
-	p->tbl_rtt = (uint64_t)local_alloc(p->chip_id, RTT_TABLE_SIZE, RTT_TABLE_SIZE);
+	p->tbl_rtt = (uint64_t)chip_arena_alloc(p->chip_id, "phb3-rtt",
+						RTT_TABLE_SIZE, RTT_TABLE_SIZE);
 	assert(p->tbl_rtt);
 	rte = (uint16_t *)(p->tbl_rtt);
 	for (i = 0; i < RTT_TABLE_ENTRIES; i++, rte++)
 		*rte = PHB3_RESERVED_PE_NUM;
 
-	p->tbl_peltv = (uint64_t)local_alloc(p->chip_id, PELTV_TABLE_SIZE, PELTV_TABLE_SIZE);
+	p->tbl_peltv = (uint64_t)chip_arena_alloc(p->chip_id, "phb3-peltv",
+						  PELTV_TABLE_SIZE,
+						  PELTV_TABLE_SIZE);
 	assert(p->tbl_peltv);
 	memset((void *)p->tbl_peltv, 0, PELTV_TABLE_SIZE);
 
-	p->tbl_pest = (uint64_t)local_alloc(p->chip_id, PEST_TABLE_SIZE, PEST_TABLE_SIZE);
+	p->tbl_pest = (uint64_t)chip_arena_alloc(p->chip_id, "phb3-pest",
+						 PEST_TABLE_SIZE,
+						 PEST_TABLE_SIZE);
 	assert(p->tbl_pest);
 	memset((void *)p->tbl_pest, 0, PEST_TABLE_SIZE);
 
-	p->tbl_ivt = (uint64_t)local_alloc(p->chip_id, IVT_TABLE_SIZE, IVT_TABLE_SIZE);
+	p->tbl_ivt = (uint64_t)chip_arena_alloc(p->chip_id, "phb3-ivt",
+						IVT_TABLE_SIZE, IVT_TABLE_SIZE);
 	assert(p->tbl_ivt);
 	memset((void *)p->tbl_ivt, 0, IVT_TABLE_SIZE);
 
-	p->tbl_rba = (uint64_t)local_alloc(p->chip_id, RBA_TABLE_SIZE, RBA_TABLE_SIZE);
+	p->tbl_rba = (uint64_t)chip_arena_alloc(p->chip_id, "phb3-rba",
+						RBA_TABLE_SIZE, RBA_TABLE_SIZE);
 	assert(p->tbl_rba);
 	memset((void *)p->tbl_rba, 0, RBA_TABLE_SIZE);
 }
@@ -124,6 +124,7 @@
 #include <xscom-p9-regs.h>
 #include <phys-map.h>
 #include <nvram.h>
+#include <chip-arena.h>
 
 /* Enable this to disable error interrupts for debug purposes */
 #define DISABLE_ERR_INTS
@@ -5048,23 +5049,22 @@ static void phb4_allocate_tables(struct phb4 *p)
 	uint16_t *rte;
 	uint32_t i;
 
-	/* XXX Our current memalign implementation sucks,
-	 *
-	 * It will do the job, however it doesn't support freeing
-	 * the memory and wastes space by always allocating twice
-	 * as much as requested (size + alignment)
-	 */
-	p->tbl_rtt = (uint64_t)local_alloc(p->chip_id, RTT_TABLE_SIZE, RTT_TABLE_SIZE);
+	p->tbl_rtt = (uint64_t)chip_arena_alloc(p->chip_id, "phb4-rtt",
+						RTT_TABLE_SIZE, RTT_TABLE_SIZE);
 	assert(p->tbl_rtt);
 	rte = (uint16_t *)(p->tbl_rtt);
 	for (i = 0; i < RTT_TABLE_ENTRIES; i++, rte++)
 		*rte = PHB4_RESERVED_PE_NUM(p);
 
-	p->tbl_peltv = (uint64_t)local_alloc(p->chip_id, p->tbl_peltv_size, p->tbl_peltv_size);
+	p->tbl_peltv = (uint64_t)chip_arena_alloc(p->chip_id, "phb4-peltv",
+						  p->tbl_peltv_size,
+						  p->tbl_peltv_size);
 	assert(p->tbl_peltv);
 	memset((void *)p->tbl_peltv, 0, p->tbl_peltv_size);
 
-	p->tbl_pest = (uint64_t)local_alloc(p->chip_id, p->tbl_pest_size, p->tbl_pest_size);
+	p->tbl_pest = (uint64_t)chip_arena_alloc(p->chip_id, "phb4-pest",
+						 p->tbl_pest_size,
+						 p->tbl_pest_size);
 	assert(p->tbl_pest);
 	memset((void *)p->tbl_pest, 0, p->tbl_pest_size);
 }
@@ -1162,10 +1162,84 @@ static void slw_patch_scans(struct proc_chip *chip, bool le_mode)
 	}
 }
 
+/*
+ * The per chip SLW work is mostly independent between chips (each chip
+ * has its own image / HOMER), so it is run as chip local CPU jobs. The
+ * per core SCOMs within a chip stay in the chip job: XSCOMs are all
+ * serialized by the global XSCOM lock anyway (HW822317), so fanning out
+ * further would only add job overhead.
+ */
+struct slw_chip_job {
+	struct proc_chip	*chip;
+	struct cpu_job		*job;
+	bool			le_mode;
+	bool			image_ok;
+	unsigned long		init_tb;
+	unsigned long		check_tb;
+	unsigned long		late_tb;
+};
+
+static struct slw_chip_job *slw_alloc_chip_jobs(unsigned int *count)
+{
+	struct slw_chip_job *jobs;
+	struct proc_chip *chip;
+	unsigned int i = 0;
+
+	for_each_chip(chip)
+		i++;
+
+	jobs = zalloc(i * sizeof(*jobs));
+	if (!jobs)
+		return NULL;
+
+	i = 0;
+	for_each_chip(chip)
+		jobs[i++].chip = chip;
+	*count = i;
+
+	return jobs;
+}
+
+static void slw_run_chip_jobs(const char *name, void (*func)(void *data),
+			      struct slw_chip_job *jobs, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		jobs[i].job = cpu_queue_job_on_node(jobs[i].chip->id, name,
+						    func, &jobs[i]);
+		if (!jobs[i].job)
+			jobs[i].job = cpu_queue_job(NULL, name, func, &jobs[i]);
+		assert(jobs[i].job);
+	}
+	cpu_process_local_jobs();
+
+	for (i = 0; i < count; i++)
+		cpu_wait_job(jobs[i].job, true);
+}
+
+static void slw_patch_scans_job(void *data)
+{
+	struct slw_chip_job *cj = data;
+
+	slw_patch_scans(cj->chip, cj->le_mode);
+}
+
+static void slw_cleanup_chip_job(void *data)
+{
+	struct slw_chip_job *cj = data;
+
+	slw_cleanup_chip(cj->chip);
+}
+
 int64_t slw_reinit(uint64_t flags)
 {
 	struct proc_chip *chip;
 	struct cpu_thread *cpu;
+	struct slw_chip_job *jobs;
+	unsigned int count;
+	unsigned long start, t_patch, t_winkle;
+	unsigned int i;
 	bool has_waker = false;
 	bool target_le = slw_current_le;
 
@@ -1189,10 +1263,18 @@ int64_t slw_reinit(uint64_t flags)
 				"SLW: Not found on chip %d\n", chip->id);
 			return OPAL_HARDWARE;
 		}
-
-		slw_patch_scans(chip, target_le);
 	}
+
+	jobs = slw_alloc_chip_jobs(&count);
+	if (!jobs)
+		return OPAL_NO_MEM;
+
+	start = mftb();
+	for (i = 0; i < count; i++)
+		jobs[i].le_mode = target_le;
+	slw_run_chip_jobs("slw_patch_scans", slw_patch_scans_job, jobs, count);
 	slw_current_le = target_le;
+	t_patch = mftb();
 
 	/* XXX Save HIDs ? Or do that in head.S ... */
 
@@ -1259,6 +1341,7 @@ int64_t slw_reinit(uint64_t flags)
 	 */
 	if (!has_waker) {
 		prlog(PR_TRACE, "SLW: No candidate waker, giving up !\n");
+		free(jobs);
 		return OPAL_HARDWARE;
 	}
 
@@ -1268,10 +1351,14 @@ int64_t slw_reinit(uint64_t flags)
 	slw_do_rvwinkle(NULL);
 
 	slw_unpatch_reset();
+	t_winkle = mftb();
 
-	for_each_chip(chip)
-		slw_cleanup_chip(chip);
+	slw_run_chip_jobs("slw_cleanup_chip", slw_cleanup_chip_job, jobs, count);
+	free(jobs);
 
+	prlog(PR_DEBUG, "SLW: Reinit patch %lu us, rvwinkle %lu us,"
+	      " cleanup %lu us\n", tb_to_usecs(t_patch - start),
+	      tb_to_usecs(t_winkle - t_patch), tb_to_usecs(mftb() - t_winkle));
 	prlog(PR_TRACE, "SLW Reinit complete !\n");
 
 	return OPAL_SUCCESS;
@@ -1557,32 +1644,75 @@ int64_t opal_slw_set_reg(uint64_t cpu_pir, uint64_t sprn, uint64_t val)
 
 opal_call(OPAL_SLW_SET_REG, opal_slw_set_reg, 3);
 
+static void slw_init_chip_job(void *data)
+{
+	struct slw_chip_job *cj = data;
+	struct proc_chip *chip = cj->chip;
+	unsigned long start = mftb();
+
+	if (proc_gen == proc_gen_p8)
+		slw_init_chip_p8(chip);
+	else
+		slw_init_chip_p9(chip);
+	cj->init_tb = mftb() - start;
+
+	start = mftb();
+	if (proc_gen == proc_gen_p8)
+		cj->image_ok = slw_image_check_p8(chip);
+	else
+		cj->image_ok = slw_image_check_p9(chip);
+	cj->check_tb = mftb() - start;
+
+	/* Only patch an image we found and checked */
+	if (!cj->image_ok)
+		return;
+
+	start = mftb();
+	if (proc_gen == proc_gen_p8)
+		slw_late_init_p8(chip);
+	else
+		slw_late_init_p9(chip);
+	cj->late_tb = mftb() - start;
+}
+
 void slw_init(void)
 {
-	struct proc_chip *chip;
+	struct slw_chip_job *jobs;
+	unsigned int i, count;
+	unsigned long start;
 
 	if (proc_chip_quirks & QUIRK_MAMBO_CALLOUTS) {
 		wakeup_engine_state = WAKEUP_ENGINE_NOT_PRESENT;
 		add_cpu_idle_state_properties();
 		return;
 	}
-	if (proc_gen == proc_gen_p8) {
-		for_each_chip(chip) {
-			slw_init_chip_p8(chip);
-			if(slw_image_check_p8(chip))
-				wakeup_engine_state = WAKEUP_ENGINE_PRESENT;
-			if (wakeup_engine_state == WAKEUP_ENGINE_PRESENT)
-				slw_late_init_p8(chip);
-		}
-		p8_sbe_init_timer();
-	} else if (proc_gen == proc_gen_p9) {
-		for_each_chip(chip) {
-			slw_init_chip_p9(chip);
-			if(slw_image_check_p9(chip))
-				wakeup_engine_state = WAKEUP_ENGINE_PRESENT;
-			if (wakeup_engine_state == WAKEUP_ENGINE_PRESENT)
-				slw_late_init_p9(chip);
-		}
+	if (proc_gen != proc_gen_p8 && proc_gen != proc_gen_p9) {
+		add_cpu_idle_state_properties();
+		return;
+	}
+
+	jobs = slw_alloc_chip_jobs(&count);
+	assert(jobs);
+
+	start = mftb();
+	slw_run_chip_jobs("slw_init_chip", slw_init_chip_job, jobs, count);
+
+	/* The wakeup engine is usable if any chip has a good image */
+	for (i = 0; i < count; i++) {
+		prlog(PR_DEBUG, "SLW: Chip %x init %lu us, image check %lu us,"
+		      " late init %lu us\n", jobs[i].chip->id,
+		      tb_to_usecs(jobs[i].init_tb),
+		      tb_to_usecs(jobs[i].check_tb),
+		      tb_to_usecs(jobs[i].late_tb));
+		if (jobs[i].image_ok)
+			wakeup_engine_state = WAKEUP_ENGINE_PRESENT;
 	}
+	prlog(PR_INFO, "SLW: Initialized %u chip(s) in %lu us\n", count,
+	      tb_to_usecs(mftb() - start));
+	free(jobs);
+
+	if (proc_gen == proc_gen_p8)
+		p8_sbe_init_timer();
+
 	add_cpu_idle_state_properties();
 }
@@ -0,0 +1,469 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Push console output through the LPC UART driver into a simulated
+ * 16550 which drains its FIFO at the baud rate, and count the LPC
+ * accesses it takes, with and without the THRE interrupt.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#define __TEST__
+#define __IO_H
+#define __CPU_H
+
+/* Simulated time, in timebase ticks */
+static uint64_t stamp;
+
+/* Spinning on the timebase takes some time too */
+static inline uint64_t sim_mftb(void)
+{
+	return stamp += 16;
+}
+#define mftb()	sim_mftb()
+
+#define zalloc(bytes) calloc((bytes), 1)
+
+static inline void smt_lowest(void) { }
+static inline void smt_medium(void) { }
+static inline void lwsync(void) { }
+
+static inline uint8_t in_8(const volatile uint8_t *addr)
+{
+	(void)addr;
+	abort();
+}
+
+static inline void out_8(volatile uint8_t *addr, uint8_t val)
+{
+	(void)addr;
+	(void)val;
+	abort();
+}
+
+struct cpu_thread {
+	bool	tb_invalid;
+};
+static struct cpu_thread sim_cpu;
+#define this_cpu()	(&sim_cpu)
+
+#include <skiboot.h>
+#include <lock.h>
+
+static void test_prlog(int log_level, const char *fmt, ...);
+#undef prlog
+#define prlog(l, f, ...) do { test_prlog(l, f, ##__VA_ARGS__); } while(0)
+
+/* Single threaded, locks are no-ops */
+void lock_caller(struct lock *l, const char *caller)
+{
+	(void)l;
+	(void)caller;
+}
+
+bool try_lock_caller(struct lock *l, const char *caller)
+{
+	(void)l;
+	(void)caller;
+	return true;
+}
+
+void unlock(struct lock *l)
+{
+	(void)l;
+}
+
+bool lock_held_by_me(struct lock *l)
+{
+	(void)l;
+	return true;
+}
+
+bool bust_locks;
+unsigned long tb_hz = 512000000;
+struct dt_node *dt_root, *dt_chosen;
+
+#include "../lpc-uart.c"
+
+#define CLOCK		1843200
+#define SPEED		115200
+/* An LPC IO cycle takes about a microsecond */
+#define LPC_ACCESS_TB	512
+
+/*
+ * The simulated UART sends a character every sim_char_tb, its FIFO is
+ * empty from sim_busy_until on
+ */
+static uint64_t sim_char_tb;
+static uint64_t sim_busy_until;
+static uint8_t sim_lcr, sim_ier;
+static unsigned long sim_accesses;
+static char sim_out[0x40000];
+static size_t sim_out_len;
+
+static unsigned int sim_fifo(void)
+{
+	if (sim_busy_until <= stamp)
+		return 0;
+	return (sim_busy_until - stamp + sim_char_tb - 1) / sim_char_tb;
+}
+
+int64_t lpc_write(enum OpalLPCAddressType addr_type, uint32_t addr,
+		  uint32_t data, uint32_t sz)
+{
+	assert(addr_type == OPAL_LPC_IO && sz == 1);
+	stamp += LPC_ACCESS_TB;
+	sim_accesses++;
+
+	if (addr - uart_base == REG_THR && !(sim_lcr & LCR_DLAB)) {
+		/* The driver must never overrun the FIFO */
+		assert(sim_fifo() < 16);
+		if (sim_busy_until < stamp)
+			sim_busy_until = stamp;
+		sim_busy_until += sim_char_tb;
+		assert(sim_out_len < sizeof(sim_out));
+		sim_out[sim_out_len++] = data;
+	} else if (addr - uart_base == REG_LCR) {
+		sim_lcr = data;
+	} else if (addr - uart_base == REG_IER && !(sim_lcr & LCR_DLAB)) {
+		sim_ier = data;
+	}
+	return OPAL_SUCCESS;
+}
+
+int64_t lpc_read(enum OpalLPCAddressType addr_type, uint32_t addr,
+		 uint32_t *data, uint32_t sz)
+{
+	assert(addr_type == OPAL_LPC_IO && sz == 1);
+	stamp += LPC_ACCESS_TB;
+	sim_accesses++;
+
+	switch (addr - uart_base) {
+	case REG_LSR:
+		*data = sim_fifo() ? 0 : LSR_THRE | LSR_TEMT;
+		break;
+	case REG_IER:
+		*data = sim_ier;
+		break;
+	default:
+		*data = 0;
+	}
+	return OPAL_SUCCESS;
+}
+
+bool lpc_ok(void)
+{
+	return true;
+}
+
+bool lpc_present(void)
+{
+	return true;
+}
+
+void lpc_used_by_console(void)
+{
+}
+
+void lpc_register_client(uint32_t chip_id, const struct lpc_client *clt,
+			 uint32_t policy)
+{
+	(void)chip_id;
+	(void)clt;
+	(void)policy;
+}
+
+static void test_prlog(int log_level, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (log_level > PR_NOTICE)
+		return;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+
+uint32_t log_simple_error(struct opal_err_info *e_info, const char *fmt, ...)
+{
+	(void)e_info;
+	(void)fmt;
+	return 0;
+}
+
+void trace_add(union trace *trace, u8 type, u16 len)
+{
+	(void)trace;
+	(void)type;
+	(void)len;
+}
+
+void opal_add_poller(void (*poller)(void *data), void *data)
+{
+	(void)poller;
+	(void)data;
+}
+
+void opal_update_pending_evt(uint64_t evt_mask, uint64_t evt_values)
+{
+	(void)evt_mask;
+	(void)evt_values;
+}
+
+struct dt_node *add_opal_console_node(int index, const char *type,
+				      uint32_t write_buffer_size)
+{
+	(void)index;
+	(void)type;
+	(void)write_buffer_size;
+	return NULL;
+}
+
+void set_console(struct con_ops *driver)
+{
+	(void)driver;
+}
+
+const char *nvram_query(const char *key)
+{
+	(void)key;
+	return NULL;
+}
+
+struct dt_property *__dt_add_property_strings(struct dt_node *node,
+					      const char *name,
+					      int count, ...)
+{
+	(void)node;
+	(void)name;
+	(void)count;
+	return NULL;
+}
+
+struct dt_property *dt_add_property_string(struct dt_node *node,
+					   const char *name,
+					   const char *value)
+{
+	(void)node;
+	(void)name;
+	(void)value;
+	return NULL;
+}
+
+char *dt_get_path(const struct dt_node *node)
+{
+	(void)node;
+	return NULL;
+}
+
+u32 dt_get_chip_id(const struct dt_node *node)
+{
+	(void)node;
+	return 0;
+}
+
+struct dt_node *dt_find_compatible_node(struct dt_node *root,
+					struct dt_node *prev,
+					const char *compat)
+{
+	(void)root;
+	(void)prev;
+	(void)compat;
+	return NULL;
+}
+
+u64 dt_translate_address(const struct dt_node *node, unsigned int index,
+			 u64 *out_size)
+{
+	(void)node;
+	(void)index;
+	(void)out_size;
+	return 0;
+}
+
+u32 dt_prop_get_u32(const struct dt_node *node, const char *prop)
+{
+	(void)node;
+	(void)prop;
+	return 0;
+}
+
+const void *dt_prop_get_def(const struct dt_node *node, const char *prop,
+			    void *def)
+{
+	(void)node;
+	(void)prop;
+	return def;
+}
+
+const struct dt_property *dt_find_property(const struct dt_node *node,
+					   const char *name)
+{
+	(void)node;
+	(void)name;
+	return NULL;
+}
+
+u32 dt_property_get_cell(const struct dt_property *prop, u32 index)
+{
+	(void)prop;
+	(void)index;
+	return 0;
+}
+
+static char input[0x20000];
+
+static void fill_input(void)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(input); i++)
+		input[i] = (i % 79) == 78 ? '\n' : ' ' + (i * 7) % 90;
+}
+
+/* Let the simulated time go by, taking the THRE interrupts */
+static void run_irqs(uint64_t until)
+{
+	while (stamp < until) {
+		stamp += tx_char_tb;
+		if ((cached_ier & IER_THRE) && !sim_fifo())
+			uart_irq(0, 0);
+	}
+}
+
+static void reset_sim(void)
+{
+	sim_out_len = 0;
+	sim_accesses = 0;
+	sim_busy_until = stamp;
+}
+
+static double bytes_per_access(void)
+{
+	return (double)sim_out_len / sim_accesses;
+}
+
+static void write_sync(void)
+{
+	size_t i, len, chunk = 500;
+
+	for (i = 0; i < sizeof(input); i += chunk) {
+		len = sizeof(input) - i < chunk ? sizeof(input) - i : chunk;
+		assert(uart_con_write(input + i, len) == len);
+		assert(tx_prod == tx_cons);
+	}
+	assert(sim_out_len == sizeof(input));
+	assert(!memcmp(sim_out, input, sizeof(input)));
+}
+
+int main(void)
+{
+	unsigned long accesses;
+	uint64_t start;
+	double rate;
+	size_t len;
+
+	fill_input();
+	uart_base = 0x3f8;
+	assert(uart_init_hw(SPEED, CLOCK));
+	assert(tx_char_tb == tb_hz * 10 / SPEED);
+	sim_char_tb = tx_char_tb;
+
+	/* Synchronous, before the interrupt works: everything goes out */
+	reset_sim();
+	start = stamp;
+	write_sync();
+	rate = (double)sim_out_len * tx_char_tb / (stamp - start);
+	printf("sync: %zu bytes, %lu LPC accesses, %.2f bytes/access, "
+	       "%.1f%% of the line rate\n", sim_out_len, sim_accesses,
+	       bytes_per_access(), 100 * rate);
+
+	/* About two LSR reads a FIFO, and the line kept busy */
+	assert(bytes_per_access() > 0.85);
+	assert(rate > 0.95);
+
+	/* A virtual UART draining faster than its baud rate isn't held back */
+	sim_char_tb = LPC_ACCESS_TB / 2;
+	reset_sim();
+	start = stamp;
+	write_sync();
+	rate = (double)sim_out_len * tx_char_tb / (stamp - start);
+	printf("fast sync: %zu bytes, %lu LPC accesses, %.2f bytes/access, "
+	       "%.1f%% of the line rate\n", sim_out_len, sim_accesses,
+	       bytes_per_access(), 100 * rate);
+	assert(rate > 10);
+	sim_char_tb = tx_char_tb;
+
+	/* With the THRE interrupt, writes only queue and fill the FIFO */
+	in_buf = zalloc(IN_BUF_SIZE);
+	out_buf = zalloc(OUT_BUF_SIZE);
+	has_irq = irq_ok = true;
+	uart_update_ier();
+	run_irqs(stamp + 16 * tx_char_tb);
+	reset_sim();
+
+	accesses = sim_accesses;
+	assert(uart_con_write(input, 4000) == 4000);
+	/* An LSR read, a FIFO worth of THR and the IER update */
+	assert(sim_accesses - accesses <= 18);
+	assert(cached_ier & IER_THRE);
+	run_irqs(stamp + 4000 * tx_char_tb * 2);
+	assert(!(cached_ier & IER_THRE));
+	assert(sim_out_len == 4000);
+	assert(!memcmp(sim_out, input, 4000));
+	printf("irq: %zu bytes, %lu LPC accesses, %.2f bytes/access\n",
+	       sim_out_len, sim_accesses, bytes_per_access());
+	assert(bytes_per_access() > 0.7);
+
+	/* Overflow: what doesn't fit is dropped and accounted for */
+	reset_sim();
+	assert(uart_con_write(input, sizeof(input)) == sizeof(input));
+	assert(tx_dropped == sizeof(input) - (TX_RING_SIZE - 1));
+	assert(tx_dropped_total == tx_dropped);
+	run_irqs(stamp + TX_RING_SIZE * tx_char_tb * 2);
+	assert(sim_out_len == TX_RING_SIZE - 1);
+	assert(!memcmp(sim_out, input, sim_out_len));
+
+	/* The next write says so first */
+	reset_sim();
+	assert(uart_con_write("hello\n", 6) == 6);
+	assert(!tx_dropped);
+	run_irqs(stamp + 100 * tx_char_tb);
+	sim_out[sim_out_len] = '\0';
+	assert(strstr(sim_out, "bytes dropped"));
+	assert(!strcmp(sim_out + sim_out_len - 6, "hello\n"));
+
+	/* The OPAL console shares the FIFO, the internal console first */
+	reset_sim();
+	len = 300;
+	assert(uart_opal_write(0, (int64_t *)&len, (const uint8_t *)input)
+	       == OPAL_SUCCESS);
+	assert(len == 300);
+	assert(uart_con_write(input + 300, 300) == 300);
+	run_irqs(stamp + 1000 * tx_char_tb);
+	assert(sim_out_len == 600);
+
+	free(in_buf);
+	free(out_buf);
+	return 0;
+}
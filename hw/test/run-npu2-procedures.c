@@ -0,0 +1,417 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Run the PHY setup procedures of six bricks against two simulated
+ * OBUS PHYs whose calibrations take a different time on every brick,
+ * and check that the bricks are set up together, that each PHY is
+ * calibrated once, and that a brick which never finishes times out
+ * without holding up the others.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#define __TEST__
+#define __IO_H
+
+/* Simulated time, in timebase ticks */
+static unsigned long stamp;
+#define mftb()	(stamp)
+
+static inline void smt_lowest(void) { }
+static inline void smt_medium(void) { }
+
+#include <skiboot.h>
+
+/* The firmware's uint64_t is long long, the host's isn't */
+static void test_prlog(int log_level, const char *fmt, ...);
+#undef prlog
+#define prlog(l, f, ...) do { test_prlog(l, f, ##__VA_ARGS__); } while(0)
+
+#include "../npu2-hw-procedures.c"
+
+unsigned long tb_hz = 512000000;
+
+static void test_prlog(int log_level, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (log_level > PR_NOTICE)
+		return;
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+}
+
+void time_wait_ms(unsigned long ms)
+{
+	stamp += msecs_to_tb(ms);
+}
+
+/* The NPU MMIO registers the procedures touch aren't simulated */
+uint64_t npu2_read(struct npu2 *p, uint64_t reg)
+{
+	(void)p;
+	(void)reg;
+	return 0;
+}
+
+void npu2_write(struct npu2 *p, uint64_t reg, uint64_t val)
+{
+	(void)p;
+	(void)reg;
+	(void)val;
+}
+
+void npu2_write_mask(struct npu2 *p, uint64_t reg, uint64_t val,
+		     uint64_t mask)
+{
+	(void)p;
+	(void)reg;
+	(void)val;
+	(void)mask;
+}
+
+void npu2_write_mask_4b(struct npu2 *p, uint64_t reg, uint32_t val,
+			uint32_t mask)
+{
+	(void)p;
+	(void)reg;
+	(void)val;
+	(void)mask;
+}
+
+uint32_t npu2_read_4b(struct npu2 *p, uint64_t reg)
+{
+	(void)p;
+	(void)reg;
+	return 0;
+}
+
+void npu2_write_4b(struct npu2 *p, uint64_t reg, uint32_t val)
+{
+	(void)p;
+	(void)reg;
+	(void)val;
+}
+
+void npu2_set_link_flag(struct npu2_dev *ndev, uint8_t flag)
+{
+	(void)ndev;
+	(void)flag;
+}
+
+void npu2_clear_link_flag(struct npu2_dev *ndev, uint8_t flag)
+{
+	(void)ndev;
+	(void)flag;
+}
+
+#define NR_BRICKS	6
+#define NR_LANES	(NPU2_MAX_PHY_LANE + 1)
+#define NEVER		(~0ul)
+
+/* The per PHY registers are addressed as lane 31 */
+#define PHY_LANE	31
+
+/*
+ * Each OBUS PHY has 24 lanes, 8 per brick. The calibrations complete
+ * some time after they are started, per lane and per PHY.
+ */
+struct sim_phy {
+	uint64_t	base;
+	uint64_t	regs[0x400][PHY_LANE + 1];
+	unsigned long	busy_until[NR_LANES];
+	unsigned long	dccal_done[NR_LANES];
+	unsigned long	init_done[NR_LANES];
+	unsigned long	zcal_done;
+	int		zcal_reqs;
+};
+
+static struct sim_phy phys[2];
+static uint64_t iovalid;
+
+/* How long the waits of each brick take, in ms */
+static unsigned long busy_ms[NR_BRICKS];
+static unsigned long dccal_ms[NR_BRICKS];
+static unsigned long zcal_ms = 6;
+
+static struct npu2 npu;
+static struct npu2_dev devs[NR_BRICKS];
+
+static struct sim_phy *sim_decode(uint64_t addr, int *offset, int *lane)
+{
+	int i;
+
+	*offset = (addr >> 42) & 0x3ff;
+	*lane = GETFIELD(PPC_BITMASK(27, 31), addr);
+	addr = SETFIELD(PPC_BITMASK(27, 31), addr, 0);
+	addr &= ~(0x3ffull << 42);
+	for (i = 0; i < 2; i++)
+		if (addr == phys[i].base)
+			return &phys[i];
+	return NULL;
+}
+
+int _xscom_read(uint32_t partid, uint64_t addr, uint64_t *val, bool take_lock)
+{
+	struct sim_phy *phy;
+	int offset, lane;
+
+	(void)partid;
+	(void)take_lock;
+	phy = sim_decode(addr, &offset, &lane);
+	assert(phy);
+
+	*val = phy->regs[offset][lane];
+	if (offset == 0x0ca) {
+		if (stamp < phy->busy_until[lane])
+			*val |= PPC_BIT(50);
+		if (stamp >= phy->dccal_done[lane])
+			*val |= PPC_BIT(49);
+		if (stamp >= phy->init_done[lane])
+			*val |= PPC_BIT(48);
+	}
+	if (offset == 0x3c1 && stamp >= phy->zcal_done)
+		*val |= PPC_BIT(50);
+	return 0;
+}
+
+int _xscom_write(uint32_t partid, uint64_t addr, uint64_t val, bool take_lock)
+{
+	struct sim_phy *phy;
+	int offset, lane, brick;
+	uint64_t old;
+
+	(void)partid;
+	(void)take_lock;
+	phy = sim_decode(addr, &offset, &lane);
+	assert(phy);
+	brick = (phy - phys) * 3 + lane / 8;
+
+	old = phy->regs[offset][lane];
+	phy->regs[offset][lane] = val;
+
+	switch (offset) {
+	case 0x0c8:
+		/* Stopping a lane keeps it busy for a while */
+		if ((old & PPC_BIT(48)) && !(val & PPC_BIT(48)))
+			phy->busy_until[lane] = stamp +
+				msecs_to_tb(busy_ms[brick]);
+		if (!(old & PPC_BIT(49)) && (val & PPC_BIT(49)))
+			phy->dccal_done[lane] = dccal_ms[brick] == NEVER ?
+				NEVER : stamp + msecs_to_tb(dccal_ms[brick]);
+		if (!(val & PPC_BIT(48)))
+			phy->init_done[lane] = NEVER;
+		else if (!(old & PPC_BIT(48)))
+			phy->init_done[lane] = stamp + msecs_to_tb(1);
+		break;
+	case 0x3c1:
+		/* The done and error bits are read only */
+		phy->regs[offset][lane] &= ~(PPC_BIT(50) | PPC_BIT(51));
+		if (!(old & PPC_BIT(49)) && (val & PPC_BIT(49))) {
+			phy->zcal_reqs++;
+			phy->zcal_done = stamp + msecs_to_tb(zcal_ms);
+		}
+		break;
+	}
+	return 0;
+}
+
+int xscom_write_mask(uint32_t partid, uint64_t addr, uint64_t val,
+		     uint64_t mask)
+{
+	(void)partid;
+	assert((addr & 0xff) == 0x9);
+	iovalid = (iovalid & ~mask) | (val & mask);
+	return 0;
+}
+
+static void sim_reset(void)
+{
+	int i, lane;
+
+	memset(phys, 0, sizeof(phys));
+	memset(&npu, 0, sizeof(npu));
+	memset(devs, 0, sizeof(devs));
+	iovalid = 0;
+
+	phys[0].base = 0x8000000009010c3full;
+	phys[1].base = 0x800000000c010c3full;
+	for (i = 0; i < 2; i++) {
+		phys[i].zcal_done = NEVER;
+		for (lane = 0; lane < NR_LANES; lane++) {
+			phys[i].dccal_done[lane] = NEVER;
+			phys[i].init_done[lane] = NEVER;
+			phys[i].regs[0x0c8][lane] = PPC_BIT(48);
+		}
+		/* Nominal impedance, in 8R units */
+		phys[i].regs[0x3c3][PHY_LANE] = SETFIELD(PPC_BITMASK(48, 56),
+							 0ull, 200);
+		phys[i].regs[0x3c5][PHY_LANE] = SETFIELD(PPC_BITMASK(48, 56),
+							 0ull, 200);
+	}
+
+	npu.devices = devs;
+	npu.total_devices = NR_BRICKS;
+	for (i = 0; i < NR_BRICKS; i++) {
+		devs[i].type = NPU2_DEV_TYPE_OPENCAPI;
+		devs[i].npu = &npu;
+		devs[i].index = i;
+		devs[i].pl_xscom_base = phys[i / 3].base;
+		devs[i].lane_mask = 0xff0000 >> ((i % 3) * 8);
+		devs[i].link_speed = 25000000000ull;
+		busy_ms[i] = 1 + i;
+		dccal_ms[i] = 3 + 4 * i;
+	}
+}
+
+/* Check the PHY of a brick was set up all the way */
+static void check_brick(struct npu2_dev *dev)
+{
+	struct sim_phy *phy = &phys[dev->index / 3];
+	int lane;
+
+	assert(dev->procedure_number == 6);
+	assert(dev->procedure_status == PROCEDURE_COMPLETE);
+	assert(iovalid & PPC_BIT(6 + obus_brick_index(dev)));
+	FOR_EACH_LANE(dev, lane) {
+		assert(!(phy->regs[0x0c8][lane] & PPC_BIT(49)));
+		assert(phy->regs[0x105][lane] & PPC_BIT(53));
+	}
+}
+
+/* How long the setup of a single brick takes on its own */
+static unsigned long time_one(int i)
+{
+	unsigned long start;
+
+	sim_reset();
+	start = stamp;
+	npu2_opencapi_phy_setup_start(&devs[i]);
+	while (!npu2_opencapi_phy_setup_poll(&devs[i]))
+		time_wait_ms(1);
+	check_brick(&devs[i]);
+	return stamp - start;
+}
+
+static void test_together(void)
+{
+	unsigned long start, sum = 0, slowest = 0, t;
+	int i;
+
+	for (i = 0; i < NR_BRICKS; i++) {
+		t = time_one(i);
+		sum += t;
+		slowest = MAX(slowest, t);
+	}
+
+	sim_reset();
+	start = stamp;
+	for (i = 0; i < NR_BRICKS; i++)
+		npu2_opencapi_phy_setup_start(&devs[i]);
+	npu2_opencapi_phy_setup_wait(&npu);
+	t = stamp - start;
+
+	for (i = 0; i < NR_BRICKS; i++)
+		check_brick(&devs[i]);
+
+	/* Each PHY was calibrated once, for all of its bricks */
+	assert(phys[0].zcal_reqs == 1 && phys[1].zcal_reqs == 1);
+	assert(npu.tx_zcal_complete[0] && npu.tx_zcal_complete[1]);
+
+	/*
+	 * No longer than the slowest brick, give or take the polling. It
+	 * can be shorter, as the bricks share the calibration of a PHY.
+	 */
+	assert(t <= slowest + msecs_to_tb(2));
+	printf("PHY setup of %d bricks: %lu ms one after the other, "
+	       "%lu ms together\n", NR_BRICKS, tb_to_msecs(sum),
+	       tb_to_msecs(t));
+}
+
+/* A brick that never calibrates times out, the others carry on */
+static void test_timeout(void)
+{
+	int i;
+
+	sim_reset();
+	dccal_ms[4] = NEVER;
+	for (i = 0; i < NR_BRICKS; i++)
+		npu2_opencapi_phy_setup_start(&devs[i]);
+	npu2_opencapi_phy_setup_wait(&npu);
+
+	for (i = 0; i < NR_BRICKS; i++) {
+		if (i == 4)
+			continue;
+		check_brick(&devs[i]);
+	}
+	assert(devs[4].procedure_number == 6);
+	assert(devs[4].procedure_status ==
+	       (PROCEDURE_COMPLETE | PROCEDURE_FAILED));
+	assert(stamp >= msecs_to_tb(1000));
+}
+
+/*
+ * Through the config space, the way the OS drives the procedures: a
+ * brick starting the calibration of a PHY already being calibrated by
+ * another waits for it rather than restart it.
+ */
+static uint32_t read_status(struct npu2_dev *dev)
+{
+	uint32_t status;
+
+	assert(npu_dev_procedure_read(dev, 0, 4, &status) == OPAL_SUCCESS);
+	return status;
+}
+
+static void test_config_space(void)
+{
+	uint32_t status;
+
+	sim_reset();
+	assert(npu_dev_procedure_write(&devs[0], 4, 4, 5) == OPAL_SUCCESS);
+	assert(read_status(&devs[0]) == PROCEDURE_INPROGRESS);
+	assert(npu_dev_procedure_write(&devs[1], 4, 4, 5) == OPAL_SUCCESS);
+	assert(read_status(&devs[1]) == PROCEDURE_INPROGRESS);
+	assert(phys[0].zcal_reqs == 1);
+
+	time_wait_ms(zcal_ms);
+	/* Until the owner of the calibration is done, so are the others */
+	assert(read_status(&devs[1]) == PROCEDURE_INPROGRESS);
+	assert(read_status(&devs[0]) == PROCEDURE_COMPLETE);
+	assert(read_status(&devs[1]) == PROCEDURE_COMPLETE);
+	assert(phys[0].zcal_reqs == 1);
+
+	/* Unknown procedures are refused */
+	assert(npu_dev_procedure_write(&devs[2], 4, 4, 2) == OPAL_SUCCESS);
+	status = read_status(&devs[2]);
+	assert(status == (PROCEDURE_COMPLETE | PROCEDURE_UNSUPPORTED));
+}
+
+int main(void)
+{
+	test_together();
+	test_timeout();
+	test_config_space();
+
+	return 0;
+}
@@ -19,6 +19,7 @@
 #include <xscom.h>
 #include <io.h>
 #include <vas.h>
+#include <chip-arena.h>
 
 #define vas_err(__fmt,...)	prlog(PR_ERR,"VAS: " __fmt, ##__VA_ARGS__)
 
@@ -348,7 +349,7 @@ static int alloc_init_wcbs(struct proc_chip *chip)
 
 	/* align to the backing store size */
 	size = (size_t)VAS_WCBS_SIZE;
-	wcbs = (uint64_t)local_alloc(chip->id, size, size);
+	wcbs = (uint64_t)chip_arena_alloc(chip->id, "vas-wcbs", size, size);
 	if (!wcbs) {
 		vas_err("Unable to allocate memory for backing store\n");
 		return -ENOMEM;
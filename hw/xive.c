@@ -23,6 +23,7 @@
 #include <timebase.h>
 #include <bitmap.h>
 #include <buddy.h>
+#include <chip-arena.h>
 #include <phys-map.h>
 #include <p9_stop_api.H>
 
@@ -996,7 +997,8 @@ static uint32_t xive_alloc_eq_set(struct xive *x, bool alloc_indirect __unused)
 		if (alloc_indirect) {
 			/* Allocate/provision indirect page during boot only */
 			xive_vdbg(x, "Indirect empty, provisioning from local pool\n");
-			page = local_alloc(x->chip_id, 0x10000, 0x10000);
+			page = chip_arena_alloc(x->chip_id, "xive-eq-page",
+						0x10000, 0x10000);
 			if (!page) {
 				xive_dbg(x, "provisioning failed !\n");
 				return XIVE_ALLOC_NO_MEM;
@@ -1852,7 +1854,7 @@ static bool xive_prealloc_tables(struct xive *x)
 	uint64_t al __unused;
 
 	/* ESB/SBE has 4 entries per byte */
-	x->sbe_base = local_alloc(x->chip_id, SBE_SIZE, SBE_SIZE);
+	x->sbe_base = chip_arena_alloc(x->chip_id, "xive-sbe", SBE_SIZE, SBE_SIZE);
 	if (!x->sbe_base) {
 		xive_err(x, "Failed to allocate SBE\n");
 		return false;
@@ -1862,7 +1864,7 @@ static bool xive_prealloc_tables(struct xive *x)
 	xive_dbg(x, "SBE at %p size 0x%x\n", x->sbe_base, IVT_SIZE);
 
 	/* EAS/IVT entries are 8 bytes */
-	x->ivt_base = local_alloc(x->chip_id, IVT_SIZE, IVT_SIZE);
+	x->ivt_base = chip_arena_alloc(x->chip_id, "xive-ivt", IVT_SIZE, IVT_SIZE);
 	if (!x->ivt_base) {
 		xive_err(x, "Failed to allocate IVT\n");
 		return false;
@@ -1878,7 +1880,7 @@ static bool xive_prealloc_tables(struct xive *x)
 	 * HW requirements)
 	 */
 	al = (IND_EQ_TABLE_SIZE + 0xffff) & ~0xffffull;
-	x->eq_ind_base = local_alloc(x->chip_id, al, al);
+	x->eq_ind_base = chip_arena_alloc(x->chip_id, "xive-eq-ind", al, al);
 	if (!x->eq_ind_base) {
 		xive_err(x, "Failed to allocate EQ indirect table\n");
 		return false;
@@ -1891,7 +1893,7 @@ static bool xive_prealloc_tables(struct xive *x)
 	 * HW requirements)
 	 */
 	al = (IND_VP_TABLE_SIZE + 0xffff) & ~0xffffull;
-	x->vp_ind_base = local_alloc(x->chip_id, al, al);
+	x->vp_ind_base = chip_arena_alloc(x->chip_id, "xive-vp-ind", al, al);
 	if (!x->vp_ind_base) {
 		xive_err(x, "Failed to allocate VP indirect table\n");
 		return false;
@@ -1920,7 +1922,8 @@ static bool xive_prealloc_tables(struct xive *x)
 		u64 vsd;
 
 		/* Indirect entries have a VSD format */
-		page = local_alloc(x->chip_id, 0x10000, 0x10000);
+		page = chip_arena_alloc(x->chip_id, "xive-vp-page",
+					0x10000, 0x10000);
 		if (!page) {
 			xive_err(x, "Failed to allocate VP page\n");
 			return false;
@@ -1938,13 +1941,13 @@ static bool xive_prealloc_tables(struct xive *x)
 #else /* USE_INDIRECT */
 
 	/* Allocate direct EQ and VP tables */
-	x->eq_base = local_alloc(x->chip_id, EQT_SIZE, EQT_SIZE);
+	x->eq_base = chip_arena_alloc(x->chip_id, "xive-eqt", EQT_SIZE, EQT_SIZE);
 	if (!x->eq_base) {
 		xive_err(x, "Failed to allocate EQ table\n");
 		return false;
 	}
 	memset(x->eq_base, 0, EQT_SIZE);
-	x->vp_base = local_alloc(x->chip_id, VPT_SIZE, VPT_SIZE);
+	x->vp_base = chip_arena_alloc(x->chip_id, "xive-vpt", VPT_SIZE, VPT_SIZE);
 	if (!x->vp_base) {
 		xive_err(x, "Failed to allocate VP table\n");
 		return false;
@@ -1956,7 +1959,8 @@ static bool xive_prealloc_tables(struct xive *x)
 #endif /* USE_INDIRECT */
 
 	/* Allocate the queue overflow pages */
-	x->q_ovf = local_alloc(x->chip_id, VC_QUEUE_OVF_COUNT * 0x10000, 0x10000);
+	x->q_ovf = chip_arena_alloc(x->chip_id, "xive-q-ovf",
+				    VC_QUEUE_OVF_COUNT * 0x10000, 0x10000);
 	if (!x->q_ovf) {
 		xive_err(x, "Failed to allocate queue overflow\n");
 		return false;
@@ -3287,7 +3291,7 @@ static void xive_provision_cpu(struct xive_cpu_state *xs, struct cpu_thread *c)
 	/* Provision one of the queues. Allocate the memory on the
 	 * chip where the CPU resides
 	 */
-	p = local_alloc(c->chip_id, 0x10000, 0x10000);
+	p = chip_arena_alloc(c->chip_id, "xive-cpu-eq", 0x10000, 0x10000);
 	if (!p) {
 		xive_err(x, "Failed to allocate EQ backing store\n");
 		assert(false);
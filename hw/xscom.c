@@ -704,6 +704,29 @@ int xscom_write_mask(uint32_t partid, uint64_t pcb_addr, uint64_t val, uint64_t
 	return xscom_write(partid, pcb_addr, val);
 }
 
+/*
+ * Read a list of registers of one processor chip under a single
+ * acquisition of the XSCOM lock (not for Centaurs, which do their own
+ * locking). All the reads are attempted, the first error is
+ * returned.
+ */
+int xscom_read_list(uint32_t partid, const uint64_t *pcb_addrs,
+		    uint64_t *vals, unsigned int count)
+{
+	unsigned int i;
+	int rc, first_rc = OPAL_SUCCESS;
+
+	lock(&xscom_lock);
+	for (i = 0; i < count; i++) {
+		rc = _xscom_read(partid, pcb_addrs[i], &vals[i], false);
+		if (rc && first_rc == OPAL_SUCCESS)
+			first_rc = rc;
+	}
+	unlock(&xscom_lock);
+
+	return first_rc;
+}
+
 int xscom_readme(uint64_t pcb_addr, uint64_t *val)
 {
 	return xscom_read(this_cpu()->chip_id, pcb_addr, val);
@@ -0,0 +1,74 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BOOT_PHASE_H
+#define __BOOT_PHASE_H
+
+#include <types.h>
+
+/*
+ * Boot phase timings, exported to the OS as "boot_phases" in
+ * /ibm,opal/firmware/exports. The area is a header followed by
+ * max_records records, of which the first nr_records are valid. It
+ * is big endian. See doc/boot-phases.rst and external/boot-phases.
+ */
+#define BOOT_PHASE_MAGIC	0x42505446	/* "BPTF" */
+#define BOOT_PHASE_VERSION	1
+#define BOOT_PHASE_MAX_RECORDS	1024
+#define BOOT_PHASE_NAME_LEN	24
+
+struct boot_phase_header {
+	__be32	magic;
+	__be16	version;
+	__be16	record_size;
+	__be32	nr_records;
+	__be32	max_records;
+	__be32	dropped;	/* Records lost once the area was full */
+	__be32	reserved;
+	__be64	tb_hz;
+};
+
+#define BOOT_PHASE_JOB		0x0001	/* A CPU job rather than a phase */
+
+struct boot_phase_record {
+	__be64	start_tb;
+	__be64	end_tb;		/* 0 if the phase never ended */
+	__be32	pir;
+	__be16	depth;		/* Nesting level on that CPU */
+	__be16	flags;
+	char	name[BOOT_PHASE_NAME_LEN];
+};
+
+/*
+ * Start a named phase on the current CPU, nested in the phases already
+ * open on it. Returns a handle for boot_phase_end(), negative if the
+ * phase isn't recorded (area full, or boot is over).
+ */
+extern int boot_phase_begin(const char *name, u16 flags);
+extern void boot_phase_end(int handle);
+
+/*
+ * Sequential top level phases of the boot CPU: ends the previous one
+ * started by boot_phase() and starts the next one. boot_phase_done()
+ * ends the last one and stops recording.
+ */
+extern void boot_phase(const char *name);
+extern void boot_phase_done(void);
+
+/* Export the records to the OS */
+extern void boot_phase_init(void);
+
+#endif /* __BOOT_PHASE_H */
@@ -0,0 +1,53 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CHIP_ARENA_H
+#define __CHIP_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mem_region-malloc.h>
+
+/*
+ * Per-chip arenas for the tables the hardware walks (XIVE, PHB, VAS,
+ * NX...). Tables are packed in chunks of the chip's own memory, without
+ * the allocator headers and alignment holes local_alloc() leaves
+ * between them, and a table never crosses a page of its class: 64K for
+ * tables up to 64K, 2M up to 2M and 1G above. Where each table landed
+ * is logged by chip_arena_finish().
+ *
+ * Tables are never freed, and @name must be a constant string.
+ */
+#define CHIP_ARENA_PAGE_64K	0x10000ull
+#define CHIP_ARENA_PAGE_2M	0x200000ull
+#define CHIP_ARENA_PAGE_1G	0x40000000ull
+
+/* Chunks are carved out of the chip's memory this much at a time */
+#define CHIP_ARENA_CHUNK_SIZE	(8 * CHIP_ARENA_PAGE_2M)
+
+void *__chip_arena_alloc(uint32_t chip_id, const char *name, size_t size,
+			 size_t align, const char *location) __warn_unused_result;
+#define chip_arena_alloc(chip_id, name, size, align)	\
+	__chip_arena_alloc((chip_id), (name), (size), (align), __location__)
+
+/*
+ * Give the unused end of the chunks back before the memory is released
+ * to the OS, and log where the tables are. Later allocations get
+ * chunks of their own size.
+ */
+void chip_arena_finish(void);
+
+#endif /* __CHIP_ARENA_H */
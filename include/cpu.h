@@ -43,6 +43,7 @@ enum cpu_thread_state {
 
 struct cpu_job;
 struct xive_cpu_state;
+struct irq_source;
 
 struct cpu_thread {
 	/*
@@ -74,6 +75,9 @@ struct cpu_thread {
 	uint32_t			hbrt_spec_wakeup; /* primary only */
 	uint64_t			save_l2_fir_action1;
 	uint64_t			current_token;
+	/* OPAL call profiling, see core/opal-profile.c */
+	struct opal_profile_cpu		*opal_profile;
+	uint64_t			opal_call_tb;
 #ifdef STACK_CHECK_ENABLED
 	int64_t				stack_bot_mark;
 	uint64_t			stack_bot_pc;
@@ -86,6 +90,8 @@ struct cpu_thread {
 	struct list_head		job_queue;
 	uint32_t			job_count;
 	bool				job_has_no_return;
+	/* Boot phases open on this CPU, see boot_phase_begin() */
+	uint16_t			boot_phase_depth;
 	/*
 	 * Per-core mask tracking for threads in HMI handler and
 	 * a cleanup done bit.
@@ -94,15 +100,24 @@ struct cpu_thread {
 	 * The member 'core_hmi_state' is primary only.
 	 * The 'core_hmi_state_ptr' member from all secondry cpus will point
 	 * to 'core_hmi_state' member in primary cpu.
+	 *
+	 * 'core_hmi_release' is the last rendez-vous the primary (leader)
+	 * released the threads from.
 	 */
 	uint32_t			core_hmi_state; /* primary only */
 	uint32_t			*core_hmi_state_ptr;
+	uint32_t			core_hmi_release; /* primary only */
 	bool				tb_invalid;
 	bool				tb_resynced;
 
 	/* For use by XICS emulation on XIVE */
 	struct xive_cpu_state		*xstate;
 
+	/* Lockless IRQ source lookup, see irq_find_source() */
+	bool				in_irq_lookup;
+	struct irq_source		*irq_cache;
+	uint64_t			irq_cache_gen;
+
 	/*
 	 * For direct controls scoms, including special wakeup.
 	 */
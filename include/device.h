@@ -217,6 +217,11 @@ void dt_free(struct dt_node *node);
 /* Parse an initial fdt */
 void dt_expand(const void *fdt);
 int dt_expand_node(struct dt_node *node, const void *fdt, int fdt_node) __warn_unused_result;
+int dt_expand_node_filtered(struct dt_node *node, const void *fdt,
+			    int fdt_node,
+			    bool (*filter)(const void *fdt, int offset,
+					   void *data),
+			    void *data) __warn_unused_result;
 
 /* Simplified accessors */
 u64 dt_prop_get_u64(const struct dt_node *node, const char *prop);
@@ -63,6 +63,14 @@ struct fsp_led_data {
 	u16			status;			/* Status */
 	u16			excl_bit;		/* Exclusive LED bit */
 	struct list_node	link;
+	struct list_node	hash_link;		/* Location code hash */
+
+	/* Enclosure LED in the CEC list, for the descendants */
+	struct fsp_led_data	*encl;
+
+	/* Descendants with fault/identify on, for the enclosures */
+	u16			nr_fault;
+	u16			nr_identify;
 };
 
 /* FSP location code request */
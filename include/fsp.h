@@ -628,10 +628,31 @@ struct fsp_msg {
 	/* Response will be filed by driver when response received */
 	struct fsp_msg		*resp;
 
+	/* Timebase when queued, for the command class statistics */
+	u64			queued_tb;
+
 	/* Internal queuing */
 	struct list_node	link;
 };
 
+/*
+ * Per command class statistics, exported to the OS as "fsp_msg_stats"
+ * (an array of these, one per class, big endian, see
+ * doc/fsp-msg-stats.rst). Latencies are in timebase ticks from
+ * fsp_queue_msg() to completion.
+ */
+struct fsp_cmdclass_stats {
+	u8			class;
+	u8			reserved;
+	__be16			depth;		/* messages queued right now */
+	__be16			max_depth;
+	__be16			reserved2;
+	__be32			completed;
+	__be32			reserved3;
+	__be64			total_lat;
+	__be64			max_lat;
+};
+
 /* This checks if a message is still "in progress" in the FSP driver */
 static inline bool fsp_msg_busy(struct fsp_msg *msg)
 {
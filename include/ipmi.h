@@ -130,6 +130,7 @@
 #define IPMI_NODE_BUSY_ERR		0xc0
 #define IPMI_INVALID_COMMAND_ERR	0xc1
 #define IPMI_TIMEOUT_ERR		0xc3
+#define IPMI_INVALID_RESERVATION_ERR	0xc5
 #define IPMI_ERR_MSG_TRUNCATED		0xc6
 #define IPMI_REQ_LEN_INVALID_ERR	0xc7
 #define IPMI_REQ_LEN_EXCEEDED_ERR	0xc8
@@ -181,6 +182,9 @@ struct ipmi_backend {
 	int (*queue_msg)(struct ipmi_msg *);
 	int (*queue_msg_head)(struct ipmi_msg *);
 	int (*dequeue_msg)(struct ipmi_msg *);
+
+	/* Largest request the BMC takes, if it told us (optional) */
+	size_t (*max_req_size)(void);
 };
 
 extern struct ipmi_backend *ipmi_backend;
@@ -192,6 +196,9 @@ bool ipmi_present(void);
 
 void ipmi_free_msg(struct ipmi_msg *msg);
 
+/* Largest request data the interface can send, IPMI_MAX_REQ_SIZE or more */
+size_t ipmi_max_req_size(void);
+
 struct ipmi_msg *ipmi_mkmsg_simple(uint32_t code, void *req_data, size_t req_size);
 struct ipmi_msg *ipmi_mkmsg(int interface, uint32_t code,
 			    void (*complete)(struct ipmi_msg *),
@@ -40,4 +40,7 @@ void *__local_alloc(unsigned int chip, size_t size, size_t align,
 #define local_alloc(chip_id, size, align)	\
 	__local_alloc((chip_id), (size), (align), __location__)
 
+void __local_shrink(void *p, size_t len, const char *location);
+#define local_shrink(p, len)	__local_shrink((p), (len), __location__)
+
 #endif /* __MEM_REGION_MALLOC_H */
@@ -67,6 +67,7 @@ bool mem_check_all(void);
 void mem_region_release_unused(void);
 void start_mem_region_clear_unused(void);
 void wait_mem_region_clear_unused(void);
+void mem_clean_ranges_reset(void);
 int64_t mem_dump_free(void);
 void mem_dump_allocs(void);
 
@@ -84,4 +85,7 @@ struct mem_region *find_mem_region(const char *name);
 
 bool mem_range_is_reserved(uint64_t start, uint64_t size);
 
+/* Chip whose memory holds @p, or -1 if it isn't chip memory */
+int mem_chip_id(const void *p);
+
 #endif /* __MEMORY_REGION */
@@ -128,8 +128,12 @@ struct npu2_dev {
 	uint16_t		procedure_step;
 	uint64_t		procedure_data;
 	unsigned long		procedure_tb;
+	unsigned long		procedure_step_tb;
 	uint32_t		procedure_status;
 
+	/* Next procedure of the OpenCAPI PHY setup */
+	uint8_t			phy_setup_next;
+
 	/* NVLink */
 	struct npu2_dev_nvlink	nvlink;
 
@@ -159,6 +163,12 @@ struct npu2 {
 	uint64_t	bdf2pe_cache[36];
 	uint64_t	tve_cache[16];
 	bool		tx_zcal_complete[2];
+	struct npu2_dev	*tx_zcal_owner[2];
+
+	/* XTS BDF map cache, and of the wildcard PID map entry of each
+	 * LPARSHORT, the only ones we use. Protected by lock. */
+	uint64_t	xts_bdf_cache[16];
+	uint64_t	xts_pid_cache[16];
 
 	/* Used to protect global MMIO space, in particular the XTS
 	 * tables. */
@@ -208,7 +218,9 @@ void npu2_set_link_flag(struct npu2_dev *ndev, uint8_t flag);
 void npu2_clear_link_flag(struct npu2_dev *ndev, uint8_t flag);
 uint32_t reset_ntl(struct npu2_dev *ndev);
 extern int nv_zcal_nominal;
-void npu2_opencapi_phy_setup(struct npu2_dev *dev);
+void npu2_opencapi_phy_setup_start(struct npu2_dev *dev);
+bool npu2_opencapi_phy_setup_poll(struct npu2_dev *dev);
+void npu2_opencapi_phy_setup_wait(struct npu2 *p);
 void npu2_opencapi_phy_prbs31(struct npu2_dev *dev);
 void npu2_opencapi_bump_ui_lane(struct npu2_dev *dev);
 int64_t npu2_freeze_status(struct phb *phb __unused,
@@ -55,6 +55,7 @@ extern void opal_update_pending_evt(uint64_t evt_mask, uint64_t evt_values);
 __be64 opal_dynamic_event_alloc(void);
 void opal_dynamic_event_free(__be64 event);
 extern void add_opal_node(void);
+extern void opal_add_export(const char *name, void *base, uint64_t size);
 
 #define opal_register(token, func, nargs)				\
 	__opal_register((token) + 0*sizeof(func(__test_args##nargs)),	\
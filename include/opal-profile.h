@@ -0,0 +1,89 @@
+/* Copyright 2018 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __OPAL_PROFILE_H
+#define __OPAL_PROFILE_H
+
+#include <types.h>
+
+/*
+ * OPAL call profile, enabled with the "opal-profile" NVRAM option and
+ * exported to the OS as "opal_call_profile" in
+ * /ibm,opal/firmware/exports. The area is a header followed by one
+ * block per CPU, cpu_size bytes apart, each holding the per token
+ * call statistics of that CPU then its ring of wait samples. It is big
+ * endian. See doc/opal-profile.rst and external/opal-profile.
+ */
+#define OPAL_PROFILE_MAGIC	0x4f50524f	/* "OPRO" */
+#define OPAL_PROFILE_VERSION	1
+#define OPAL_PROFILE_SAMPLES	128
+#define OPAL_PROFILE_BT_DEPTH	6
+
+#define OPAL_PROFILE_CALLS	0x1
+#define OPAL_PROFILE_WAITS	0x2
+
+struct opal_profile_header {
+	__be32	magic;
+	__be16	version;
+	__be16	mode;		/* OPAL_PROFILE_CALLS | OPAL_PROFILE_WAITS */
+	__be32	nr_cpus;
+	__be32	nr_tokens;
+	__be32	nr_samples;	/* Ring size, 0 without OPAL_PROFILE_WAITS */
+	__be32	cpu_offset;	/* Of the first CPU block */
+	__be32	cpu_size;
+	__be32	reserved;
+	__be64	tb_hz;
+	__be64	skiboot_base;	/* To match PCs with skiboot.map */
+};
+
+struct opal_call_stat {
+	__be64	count;
+	__be64	total_tb;
+	__be64	max_tb;
+};
+
+/* One wait of an OPAL call, with the backtrace of the waiter */
+struct opal_profile_sample {
+	__be64	tb;
+	__be64	wait_tb;
+	__be64	token;
+	__be64	pc[OPAL_PROFILE_BT_DEPTH];
+};
+
+struct opal_profile_cpu {
+	__be32	pir;
+	__be32	sample_count;	/* Ever taken, the ring index is count % size */
+	struct opal_call_stat calls[];
+	/* Followed by the samples */
+};
+
+struct cpu_thread;
+
+extern bool opal_profile_waits;
+
+extern void opal_profile_init(void);
+extern void opal_profile_entry(struct cpu_thread *cpu);
+extern void opal_profile_exit(struct cpu_thread *cpu, uint64_t token);
+extern void __opal_profile_wait(unsigned long duration);
+
+/* Called from the time_wait() family, before waiting */
+static inline void opal_profile_wait(unsigned long duration)
+{
+	if (opal_profile_waits)
+		__opal_profile_wait(duration);
+}
+
+#endif /* __OPAL_PROFILE_H */
@@ -180,6 +180,9 @@ extern size_t snprintf_symbol(char *buf, size_t len, uint64_t addr);
 extern void direct_controls_init(void);
 extern int64_t opal_signal_system_reset(int cpu_nr);
 
+/* HMI handling */
+extern void hmi_init(void);
+
 /* Fast reboot support */
 extern void disable_fast_reboot(const char *reason);
 extern void fast_reboot(void);
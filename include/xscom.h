@@ -239,6 +239,8 @@ static inline int xscom_write(uint32_t partid, uint64_t pcb_addr, uint64_t val)
 	return _xscom_write(partid, pcb_addr, val, true);
 }
 extern int xscom_write_mask(uint32_t partid, uint64_t pcb_addr, uint64_t val, uint64_t mask);
+extern int xscom_read_list(uint32_t partid, const uint64_t *pcb_addrs,
+			   uint64_t *vals, unsigned int count);
 
 /* This chip SCOM access */
 extern int xscom_readme(uint64_t pcb_addr, uint64_t *val);
@@ -29,6 +29,10 @@ print_str_fill(char **buffer, size_t bufsize, char *sizec,
 	size_t i, sizei, len;
 	char *bstart = *buffer;
 
+	/* No field width, nothing to fill */
+	if (!*sizec)
+		return 1;
+
 	sizei = strtoul(sizec, NULL, 10);
 	len = strlen(str);
 	if (sizei > len) {
@@ -46,9 +50,9 @@ static int
 print_str(char **buffer, size_t bufsize, const char *str)
 {
 	char *bstart = *buffer;
-	size_t i;
+	size_t i, len = strlen(str);
 
-	for (i = 0; (i < strlen(str)) && ((*buffer - bstart) < bufsize); i++) {
+	for (i = 0; (i < len) && ((*buffer - bstart) < bufsize); i++) {
 		**buffer = str[i];
 		*buffer += 1;
 	}
@@ -60,9 +64,19 @@ print_intlen(unsigned long value, unsigned short int base)
 {
 	int i = 0;
 
-	while (value > 0) {
-		value /= base;
-		i++;
+	/* Spell the common bases out so the compiler avoids divides */
+	switch (base) {
+	case 16:
+		for (; value > 0; value >>= 4)
+			i++;
+		break;
+	case 10:
+		for (; value > 0; value /= 10)
+			i++;
+		break;
+	default:
+		for (; value > 0; value /= base)
+			i++;
 	}
 	if (i == 0)
 		i = 1;
@@ -73,27 +87,40 @@ static int
 print_itoa(char **buffer, size_t bufsize, unsigned long value,
 					unsigned short base, bool upper)
 {
-	const char zeichen[] = {'0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f'};
-	char c;
-	int i, len;
+	const char *zeichen = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	char digits[sizeof(value) * 8];	/* enough down to base 2 */
+	int i, len = 0;
 
 	if(base <= 2 || base > 16)
 		return 0;
 
-	len = i = print_intlen(value, base);
+	/* Least significant digit first */
+	switch (base) {
+	case 16:
+		do {
+			digits[len++] = zeichen[value & 0xf];
+			value >>= 4;
+		} while (value);
+		break;
+	case 10:
+		do {
+			digits[len++] = zeichen[value % 10];
+			value /= 10;
+		} while (value);
+		break;
+	default:
+		do {
+			digits[len++] = zeichen[value % base];
+			value /= base;
+		} while (value);
+	}
 
 	/* Don't print to buffer if bufsize is not enough. */
 	if (len > bufsize)
 		return 0;
 
-	do {
-		c = zeichen[value % base];
-		if (upper)
-			c = toupper(c);
-
-		(*buffer)[--i] = c;
-		value /= base;
-	} while(value);
+	for (i = 0; i < len; i++)
+		(*buffer)[i] = digits[len - 1 - i];
 
 	*buffer += len;
 
@@ -109,6 +136,10 @@ print_fill(char **buffer, size_t bufsize, char *sizec, unsigned long size,
 	int i, sizei, len;
 	char *bstart = *buffer;
 
+	/* No field width, nothing to fill */
+	if (!*sizec)
+		return 0;
+
 	sizei = strtoul(sizec, NULL, 10);
  	len = print_intlen(size, base) + optlen;
 	if (sizei > len) {
@@ -12,12 +12,37 @@
 
 #include "string.h"
 
+#define LONG_MASK	(sizeof(long) - 1)
+#define ONES		(~0UL / 0xff)
+#define HIGHS		(ONES << 7)
+/* Non zero if one of the bytes of x is zero */
+#define HAS_ZERO(x)	(((x) - ONES) & ~(x) & HIGHS)
 
 void *
 memchr(const void *ptr, int c, size_t n)
 {
 	unsigned char ch = (unsigned char)c;
 	const unsigned char *p = ptr;
+	unsigned long pattern, v;
+
+	if (n >= 2 * sizeof(long)) {
+		while ((unsigned long)p & LONG_MASK) {
+			if (*p == ch)
+				return (void *)p;
+			p += 1;
+			n--;
+		}
+
+		/* Skip the words that don't have the byte */
+		pattern = ONES * ch;
+		while (n >= sizeof(long)) {
+			v = *(const unsigned long *)p ^ pattern;
+			if (HAS_ZERO(v))
+				break;
+			p += sizeof(long);
+			n -= sizeof(long);
+		}
+	}
 
 	while (n-- > 0) {
 		if (*p == ch)
@@ -12,6 +12,7 @@
 
 #include "string.h"
 
+#define LONG_MASK	(sizeof(long) - 1)
 
 int
 memcmp(const void *ptr1, const void *ptr2, size_t n)
@@ -19,6 +20,28 @@ memcmp(const void *ptr1, const void *ptr2, size_t n)
 	const unsigned char *p1 = ptr1;
 	const unsigned char *p2 = ptr2;
 
+	/*
+	 * Skip the identical words, the byte loop below then finds the
+	 * first difference, whatever the endianness.
+	 */
+	if (n >= 2 * sizeof(long) &&
+	    !(((unsigned long)p1 ^ (unsigned long)p2) & LONG_MASK)) {
+		while ((unsigned long)p1 & LONG_MASK) {
+			if (*p1 != *p2)
+				return (*p1 - *p2);
+			p1 += 1;
+			p2 += 1;
+			n--;
+		}
+
+		while (n >= sizeof(long) &&
+		       *(const unsigned long *)p1 == *(const unsigned long *)p2) {
+			p1 += sizeof(long);
+			p2 += sizeof(long);
+			n -= sizeof(long);
+		}
+	}
+
 	while (n-- > 0) {
 		if (*p1 != *p2)
 			return (*p1 - *p2);
@@ -12,13 +12,58 @@
 
 #include "string.h"
 
+#define LONG_MASK	(sizeof(long) - 1)
+
 void *
 memcpy(void *dest, const void *src, size_t n)
 {
 	char *cdest;
 	const char *csrc = src;
+	unsigned long *ldest;
+	const unsigned long *lsrc;
 
 	cdest = dest;
+
+	/* Copy words when both buffers can be aligned at the same time */
+	if (n >= 2 * sizeof(long) &&
+	    !(((unsigned long)cdest ^ (unsigned long)csrc) & LONG_MASK)) {
+		while ((unsigned long)cdest & LONG_MASK) {
+			*cdest++ = *csrc++;
+			n--;
+		}
+
+		ldest = (unsigned long *)cdest;
+		lsrc = (const unsigned long *)csrc;
+
+		/* Load 8 words before storing them, half a cache line */
+		while (n >= 8 * sizeof(long)) {
+			unsigned long a = lsrc[0], b = lsrc[1];
+			unsigned long c = lsrc[2], d = lsrc[3];
+			unsigned long e = lsrc[4], f = lsrc[5];
+			unsigned long g = lsrc[6], h = lsrc[7];
+
+			ldest[0] = a;
+			ldest[1] = b;
+			ldest[2] = c;
+			ldest[3] = d;
+			ldest[4] = e;
+			ldest[5] = f;
+			ldest[6] = g;
+			ldest[7] = h;
+			ldest += 8;
+			lsrc += 8;
+			n -= 8 * sizeof(long);
+		}
+
+		while (n >= sizeof(long)) {
+			*ldest++ = *lsrc++;
+			n -= sizeof(long);
+		}
+
+		cdest = (char *)ldest;
+		csrc = (const char *)lsrc;
+	}
+
 	while (n-- > 0) {
 		*cdest++ = *csrc++;
 	}
@@ -12,30 +12,62 @@
 
 #include "string.h"
 
+#define LONG_MASK	(sizeof(long) - 1)
 
 void *
 memmove(void *dest, const void *src, size_t n)
 {
 	char *cdest;
 	const char *csrc;
-	int i;
-
-	/* Do the buffers overlap in a bad way? */
-	if (src < dest && src + n >= dest) {
-		/* Copy from end to start */
-		cdest = dest + n - 1;
-		csrc = src + n - 1;
-		for (i = 0; i < n; i++) {
-			*cdest-- = *csrc--;
+	unsigned long *ldest;
+	const unsigned long *lsrc;
+
+	/*
+	 * If the buffers don't overlap in a bad way, a forward copy is
+	 * fine. memcpy() copies forward and loads each block before
+	 * storing it.
+	 */
+	if (!(src < dest && src + n > dest))
+		return memcpy(dest, src, n);
+
+	/* Copy from end to start */
+	cdest = dest + n;
+	csrc = src + n;
+
+	if (n >= 2 * sizeof(long) &&
+	    !(((unsigned long)cdest ^ (unsigned long)csrc) & LONG_MASK)) {
+		while ((unsigned long)cdest & LONG_MASK) {
+			*--cdest = *--csrc;
+			n--;
 		}
-	}
-	else {
-		/* Normal copy is possible */
-		cdest = dest;
-		csrc = src;
-		for (i = 0; i < n; i++) {
-			*cdest++ = *csrc++;
+
+		ldest = (unsigned long *)cdest;
+		lsrc = (const unsigned long *)csrc;
+
+		while (n >= 4 * sizeof(long)) {
+			unsigned long a = lsrc[-1], b = lsrc[-2];
+			unsigned long c = lsrc[-3], d = lsrc[-4];
+
+			ldest[-1] = a;
+			ldest[-2] = b;
+			ldest[-3] = c;
+			ldest[-4] = d;
+			ldest -= 4;
+			lsrc -= 4;
+			n -= 4 * sizeof(long);
+		}
+
+		while (n >= sizeof(long)) {
+			*--ldest = *--lsrc;
+			n -= sizeof(long);
 		}
+
+		cdest = (char *)ldest;
+		csrc = (const char *)lsrc;
+	}
+
+	while (n-- > 0) {
+		*--cdest = *--csrc;
 	}
 
 	return dest;
@@ -13,12 +13,14 @@
 #include "string.h"
 
 #define CACHE_LINE_SIZE 128
+#define LONG_MASK	(sizeof(long) - 1)
 
 void *
 memset(void *dest, int c, size_t size)
 {
 	unsigned char *d = (unsigned char *)dest;
 	unsigned long big_c = 0;
+	unsigned long *ld;
 
 #if defined(__powerpc__) || defined(__powerpc64__)
 	if (size > CACHE_LINE_SIZE && c==0) {
@@ -34,16 +36,31 @@ memset(void *dest, int c, size_t size)
 	}
 #endif
 
-	if (c) {
-		big_c = c;
-		big_c |= (big_c << 8) | big_c;
-		big_c |= (big_c << 16) | big_c;
-		big_c |= (big_c << 32) | big_c;
-	}
-	while (size >= 8 && c == 0) {
-		*((unsigned long *)d) = big_c;
-		d+=8;
-		size-=8;
+	if (size >= 2 * sizeof(long)) {
+		big_c = (unsigned char)c;
+		big_c |= big_c << 8;
+		big_c |= big_c << 16;
+		big_c |= big_c << 32;
+
+		while ((unsigned long)d & LONG_MASK) {
+			*d++ = (unsigned char)c;
+			size--;
+		}
+
+		ld = (unsigned long *)d;
+		while (size >= 4 * sizeof(long)) {
+			ld[0] = big_c;
+			ld[1] = big_c;
+			ld[2] = big_c;
+			ld[3] = big_c;
+			ld += 4;
+			size -= 4 * sizeof(long);
+		}
+		while (size >= sizeof(long)) {
+			*ld++ = big_c;
+			size -= sizeof(long);
+		}
+		d = (unsigned char *)ld;
 	}
 
 	while (size-- > 0) {
@@ -51,6 +51,11 @@ int test_strchr(const char *s, int c, char *expected);
 int test_strcasecmp(const char *s1, const char *s2, int expected);
 int test_strncasecmp(const char *s1, const char *s2, size_t n, int expected);
 int test_memmove(void *dest, const void *src, size_t n, const void *r, const void *expected, size_t expected_n);
+void *skiboot_memcpy(void *dest, const void *src, size_t n);
+void *skiboot_memmove(void *dest, const void *src, size_t n);
+void *skiboot_memset(void *dest, int c, size_t n);
+int skiboot_memcmp(const void *ptr1, const void *ptr2, size_t n);
+void *skiboot_memchr(const void *ptr, int c, size_t n);
 
 int test_memset(char* buf, int c, size_t s)
 {
@@ -101,3 +106,29 @@ int test_memmove(void *dest, const void *src, size_t n, const void *r, const voi
 		return -1;
 	return(memcmp(r, expected, expected_n) == 0);
 }
+
+/* Raw access to the skiboot versions, checked against the host libc */
+void *skiboot_memcpy(void *dest, const void *src, size_t n)
+{
+	return memcpy(dest, src, n);
+}
+
+void *skiboot_memmove(void *dest, const void *src, size_t n)
+{
+	return memmove(dest, src, n);
+}
+
+void *skiboot_memset(void *dest, int c, size_t n)
+{
+	return memset(dest, c, n);
+}
+
+int skiboot_memcmp(const void *ptr1, const void *ptr2, size_t n)
+{
+	return memcmp(ptr1, ptr2, n);
+}
+
+void *skiboot_memchr(const void *ptr, int c, size_t n)
+{
+	return memchr(ptr, c, n);
+}
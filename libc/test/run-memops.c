@@ -20,6 +20,7 @@
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 int test_memset(char* buf, int c, size_t s);
 int test_memchr(const void *ptr, int c, size_t n, void* expected);
@@ -29,6 +30,192 @@ int test_strchr(const char *s, int c, char *expected);
 int test_strcasecmp(const char *s1, const char *s2, int expected);
 int test_strncasecmp(const char *s1, const char *s2, size_t n, int expected);
 int test_memmove(void *dest, const void *src, size_t n, const void *r, const void *expected, size_t expected_n);
+void *skiboot_memcpy(void *dest, const void *src, size_t n);
+void *skiboot_memmove(void *dest, const void *src, size_t n);
+void *skiboot_memset(void *dest, int c, size_t n);
+int skiboot_memcmp(const void *ptr1, const void *ptr2, size_t n);
+void *skiboot_memchr(const void *ptr, int c, size_t n);
+
+/* Offsets and lengths covered by the alignment tests */
+#define ALIGN_MAX	(2 * sizeof(long))
+#define LEN_MAX		300
+#define AREA		(2 * ALIGN_MAX + LEN_MAX + 64)
+
+static void fill(unsigned char *p, size_t n, unsigned int seed)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		p[i] = (unsigned char)(seed + i * 7 + (i >> 8));
+}
+
+static int sign(int v)
+{
+	return (v > 0) - (v < 0);
+}
+
+static void test_memcpy_align(void)
+{
+	static unsigned char src[AREA], dst[AREA], ref[AREA];
+	size_t s, d, n;
+
+	fill(src, AREA, 1);
+	for (s = 0; s < ALIGN_MAX; s++)
+	for (d = 0; d < ALIGN_MAX; d++)
+	for (n = 0; n <= LEN_MAX; n++) {
+		memset(dst, 0xaa, AREA);
+		memset(ref, 0xaa, AREA);
+		memcpy(ref + d, src + s, n);
+		assert(skiboot_memcpy(dst + d, src + s, n) == dst + d);
+		/* Also checks nothing was written out of bounds */
+		assert(memcmp(dst, ref, AREA) == 0);
+	}
+}
+
+static void test_memmove_align(void)
+{
+	static unsigned char buf[AREA], ref[AREA];
+	size_t s, d, n;
+
+	/* Overlapping both ways, and not overlapping */
+	for (s = 0; s < 2 * ALIGN_MAX; s++)
+	for (d = 0; d < 2 * ALIGN_MAX; d++)
+	for (n = 0; n <= LEN_MAX; n++) {
+		fill(buf, AREA, s + d);
+		fill(ref, AREA, s + d);
+		memmove(ref + d, ref + s, n);
+		assert(skiboot_memmove(buf + d, buf + s, n) == buf + d);
+		assert(memcmp(buf, ref, AREA) == 0);
+	}
+}
+
+static void test_memset_align(void)
+{
+	static unsigned char buf[AREA], ref[AREA];
+	int values[] = { 0, 0x42, 0xff, 0x180 };
+	size_t d, n, v;
+
+	for (v = 0; v < sizeof(values) / sizeof(values[0]); v++)
+	for (d = 0; d < ALIGN_MAX; d++)
+	for (n = 0; n <= LEN_MAX; n++) {
+		fill(buf, AREA, 3);
+		fill(ref, AREA, 3);
+		memset(ref + d, values[v], n);
+		assert(skiboot_memset(buf + d, values[v], n) == buf + d);
+		assert(memcmp(buf, ref, AREA) == 0);
+	}
+}
+
+static void test_memcmp_align(void)
+{
+	static unsigned char a[AREA], b[AREA];
+	size_t s, d, n, diff;
+
+	for (s = 0; s < ALIGN_MAX; s++)
+	for (d = 0; d < ALIGN_MAX; d++)
+	for (n = 0; n <= LEN_MAX; n += 7) {
+		fill(a + s, n, 5);
+		fill(b + d, n, 5);
+		assert(skiboot_memcmp(a + s, b + d, n) == 0);
+
+		/* Differences all over the buffer, in both directions */
+		for (diff = 0; diff < n; diff += 3) {
+			b[d + diff]++;
+			assert(sign(skiboot_memcmp(a + s, b + d, n)) ==
+			       sign(memcmp(a + s, b + d, n)));
+			assert(sign(skiboot_memcmp(b + d, a + s, n)) ==
+			       sign(memcmp(b + d, a + s, n)));
+			b[d + diff]--;
+		}
+	}
+}
+
+static void test_memchr_align(void)
+{
+	static unsigned char buf[AREA];
+	size_t d, n, pos;
+
+	for (d = 0; d < ALIGN_MAX; d++)
+	for (n = 0; n <= LEN_MAX; n++) {
+		memset(buf, 0x11, AREA);
+		assert(skiboot_memchr(buf + d, 0x80, n) == NULL);
+
+		/* The byte past the end must not be found */
+		buf[d + n] = 0x80;
+		assert(skiboot_memchr(buf + d, 0x80, n) == NULL);
+
+		for (pos = 0; pos < n; pos += 3) {
+			buf[d + pos] = 0x80;
+			assert(skiboot_memchr(buf + d, 0x80, n) == buf + d + pos);
+			/* Only the first match counts */
+			buf[d + n - 1] = 0x80;
+			assert(skiboot_memchr(buf + d, 0x80, n) == buf + d + pos);
+			buf[d + n - 1] = 0x11;
+			buf[d + pos] = 0x11;
+		}
+	}
+}
+
+static double mb_per_sec(size_t bytes, struct timespec *start,
+			 struct timespec *end)
+{
+	double secs = (end->tv_sec - start->tv_sec) +
+		(end->tv_nsec - start->tv_nsec) / 1e9;
+
+	return secs > 0 ? bytes / secs / (1024 * 1024) : 0;
+}
+
+/* Rough throughput figures of the skiboot versions, on the host */
+static void bench_memops(void)
+{
+	size_t size = 1024 * 1024, total = 0;
+	struct timespec start, end;
+	char *a, *b;
+	int i, loops = 16;
+
+	a = malloc(size);
+	b = malloc(size);
+	assert(a && b);
+	memset(a, 0x5a, size);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < loops; i++, total += size)
+		skiboot_memcpy(b, a, size);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("memcpy:  %8.1f MB/s\n", mb_per_sec(total, &start, &end));
+
+	total = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < loops; i++, total += size - 1)
+		skiboot_memmove(b + 1, b, size - 1);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("memmove: %8.1f MB/s\n", mb_per_sec(total, &start, &end));
+
+	total = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < loops; i++, total += size)
+		skiboot_memset(b, 0x42, size);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("memset:  %8.1f MB/s\n", mb_per_sec(total, &start, &end));
+
+	memcpy(b, a, size);
+	total = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < loops; i++, total += size)
+		assert(skiboot_memcmp(a, b, size) == 0);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("memcmp:  %8.1f MB/s\n", mb_per_sec(total, &start, &end));
+
+	total = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < loops; i++, total += size)
+		assert(skiboot_memchr(a, 0, size) == NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("memchr:  %8.1f MB/s\n", mb_per_sec(total, &start, &end));
+
+	free(a);
+	free(b);
+}
 
 int main(void)
 {
@@ -98,5 +285,13 @@ int main(void)
 	free(buf);
 	free(buf2);
 
+	test_memcpy_align();
+	test_memmove_align();
+	test_memset_align();
+	test_memcmp_align();
+	test_memchr_align();
+
+	bench_memops();
+
 	return 0;
 }